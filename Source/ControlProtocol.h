@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Layout of the shared-memory segment a GrooveSeq instance exposes to local
+// controllers, such as a stage rig's companion app. Kept free of JUCE so a
+// client can include it on its own.
+//
+// Each instance creates the POSIX shared-memory object /grooveseq-N, N being
+// the first free number from 1 to kMaxInstances. The segment holds:
+//
+// - state: the pattern, playhead and bank, republished by the plugin about 30
+//   times a second under a sequence counter. A reader copies it and retries
+//   while the counter is odd or changed during the copy.
+// - commands: a single-producer, single-consumer ring. The client fills the
+//   slot at writeIndex and then advances writeIndex; the plugin applies
+//   commands on its message thread and advances readIndex. Only one client
+//   should write at a time.
+namespace ControlProtocol
+{
+constexpr std::uint32_t kMagic = 0x47535143; // "GSQC"
+constexpr std::uint32_t kVersion = 1;
+constexpr int kMaxInstances = 64;
+
+constexpr int kPads = 16;
+constexpr int kSteps = 32;
+constexpr std::uint32_t kRingSize = 64; // a power of two
+constexpr int kMaxNameBytes = 64;
+constexpr int kMaxPathBytes = 1024;
+
+// Velocities are sent to 1/255 and micro-timing offsets to 1/254 of a step.
+constexpr float kVelocitySteps = 255.0f;
+constexpr float kOffsetSteps = 254.0f;
+
+inline std::string segmentName(int instance)
+{
+    return "/grooveseq-" + std::to_string(instance);
+}
+
+enum class CommandType : std::uint32_t
+{
+    setStep = 1,   // pad, step, value: 0 off, 1 on
+    selectPattern, // value: bank pattern index
+    loadSample     // pad, path
+};
+
+struct Command
+{
+    CommandType type = CommandType::setStep;
+    std::int32_t pad = 0;
+    std::int32_t step = 0;
+    std::int32_t value = 0;
+    char path[kMaxPathBytes] = {}; // UTF-8, null-terminated
+};
+
+struct State
+{
+    std::int32_t currentStep = -1; // -1 until the transport has run
+    float bpm = 120.0f;
+    std::int32_t bankSize = 0;
+    std::int32_t selectedBankPattern = -1;
+    std::uint32_t active[kPads] = {}; // bit n is step n
+    std::uint8_t velocity[kPads][kSteps] = {};
+    std::int8_t offset[kPads][kSteps] = {};
+    char padNames[kPads][kMaxNameBytes] = {}; // UTF-8, empty for an empty pad
+};
+
+struct Segment
+{
+    // Written last when the plugin creates the segment, so a client that
+    // sees kMagic sees the rest initialised.
+    std::atomic<std::uint32_t> magic { 0 };
+    std::uint32_t version = kVersion;
+    std::int32_t ownerPid = 0;
+
+    std::atomic<std::uint32_t> stateSequence { 0 }; // odd while state is written
+    State state;
+
+    std::atomic<std::uint32_t> writeIndex { 0 };
+    std::atomic<std::uint32_t> readIndex { 0 };
+    Command commands[kRingSize];
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the segment is shared between processes");
+static_assert(std::is_standard_layout<Segment>::value, "the segment is shared between processes");
+static_assert((kRingSize & (kRingSize - 1)) == 0, "ring indices wrap with a mask");
+} // namespace ControlProtocol
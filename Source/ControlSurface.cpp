@@ -0,0 +1,133 @@
+#include "ControlSurface.h"
+
+#include <cstring>
+#include <new>
+
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+ #define GROOVESEQ_CONTROL_SURFACE 1
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <signal.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#else
+ #define GROOVESEQ_CONTROL_SURFACE 0
+#endif
+
+ControlSurface::ControlSurface()
+{
+    for (int number = 1; number <= ControlProtocol::kMaxInstances; ++number)
+        if (open(number))
+            return;
+}
+
+ControlSurface::~ControlSurface()
+{
+#if GROOVESEQ_CONTROL_SURFACE
+    if (segment == nullptr)
+        return;
+
+    segment->~Segment();
+    munmap(segment, sizeof(ControlProtocol::Segment));
+    shm_unlink(ControlProtocol::segmentName(instance).c_str());
+#endif
+}
+
+bool ControlSurface::open(int number)
+{
+#if GROOVESEQ_CONTROL_SURFACE
+    const auto name = ControlProtocol::segmentName(number);
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST)
+    {
+        // Taken, unless its owner died without unlinking it.
+        int stale = shm_open(name.c_str(), O_RDONLY, 0);
+        if (stale < 0)
+            return false;
+
+        bool ownerGone = false;
+        struct stat info {};
+        const bool fullSize = fstat(stale, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ControlProtocol::Segment);
+        auto* mapped = fullSize ? mmap(nullptr, sizeof(ControlProtocol::Segment), PROT_READ, MAP_SHARED, stale, 0) : MAP_FAILED;
+        if (mapped != MAP_FAILED)
+        {
+            const auto* existing = static_cast<const ControlProtocol::Segment*>(mapped);
+            ownerGone = existing->magic.load(std::memory_order_acquire) == ControlProtocol::kMagic
+                        && kill(existing->ownerPid, 0) != 0 && errno == ESRCH;
+            munmap(mapped, sizeof(ControlProtocol::Segment));
+        }
+
+        close(stale);
+        if (!ownerGone)
+            return false;
+
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+
+    if (fd < 0)
+        return false;
+
+    void* mapped = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(sizeof(ControlProtocol::Segment))) == 0)
+        mapped = mmap(nullptr, sizeof(ControlProtocol::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (mapped == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    segment = new (mapped) ControlProtocol::Segment();
+    segment->ownerPid = static_cast<std::int32_t>(getpid());
+    segment->magic.store(ControlProtocol::kMagic, std::memory_order_release);
+    instance = number;
+    return true;
+#else
+    juce::ignoreUnused(number);
+    return false;
+#endif
+}
+
+void ControlSurface::publish(const ControlProtocol::State& state)
+{
+    if (segment == nullptr)
+        return;
+
+    // Seqlock: readers retry while the count is odd or moved during their copy.
+    const auto sequence = segment->stateSequence.load(std::memory_order_relaxed);
+    segment->stateSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&segment->state, &state, sizeof(ControlProtocol::State));
+
+    segment->stateSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void ControlSurface::drain(const CommandHandler& handler)
+{
+    if (segment == nullptr)
+        return;
+
+    auto read = segment->readIndex.load(std::memory_order_relaxed);
+    const auto write = segment->writeIndex.load(std::memory_order_acquire);
+
+    // A client that ran past a full ring has overwritten commands still
+    // queued; skip to the ones that are intact.
+    if (write - read > ControlProtocol::kRingSize)
+        read = write - ControlProtocol::kRingSize;
+
+    ControlProtocol::Command command;
+    for (; read != write; ++read)
+    {
+        std::memcpy(&command, &segment->commands[read & (ControlProtocol::kRingSize - 1)], sizeof(ControlProtocol::Command));
+        command.path[ControlProtocol::kMaxPathBytes - 1] = '\0';
+        handler(command);
+    }
+
+    segment->readIndex.store(read, std::memory_order_release);
+}
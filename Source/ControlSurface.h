@@ -0,0 +1,42 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <functional>
+
+#include "ControlProtocol.h"
+
+// The plugin's end of the shared-memory control segment described in
+// ControlProtocol.h. Both calls belong on the message thread, so controller
+// commands go through the same editing methods as the UI and never reach
+// the audio thread.
+//
+// POSIX only; elsewhere the surface never opens and both calls do nothing.
+class ControlSurface
+{
+public:
+    using CommandHandler = std::function<void(const ControlProtocol::Command&)>;
+
+    // Creates the first free /grooveseq-N segment. Segments left behind by
+    // a process that has exited are reclaimed.
+    ControlSurface();
+    ~ControlSurface();
+
+    bool isOpen() const noexcept { return segment != nullptr; }
+    // N in the segment name, 0 when not open.
+    int getInstanceNumber() const noexcept { return instance; }
+
+    void publish(const ControlProtocol::State& state);
+
+    // Hands every queued command to handler, oldest first. A command's path
+    // is always null-terminated, whatever the client wrote.
+    void drain(const CommandHandler& handler);
+
+private:
+    bool open(int number);
+
+    ControlProtocol::Segment* segment = nullptr;
+    int instance = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControlSurface)
+};
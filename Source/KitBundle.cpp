@@ -0,0 +1,246 @@
+#include "KitBundle.h"
+
+namespace
+{
+constexpr int kKitMagic = 0x4753514b; // "GSQK"
+constexpr int kKitVersion = 3;
+constexpr int kOneShotVersion = 2;
+constexpr int kSingleLayerVersion = 1;
+constexpr int kMaxLoopSteps = 2 * Sequencer::kSteps; // the longest estimateLoopSteps() picks
+constexpr int kMaxLayers = 128;
+
+// magic, version, metadata size
+constexpr size_t kHeaderBytes = 16;
+
+// Payloads start on page boundaries so each maps onto whole pages.
+constexpr size_t kPayloadAlignment = 4096;
+
+size_t alignUp(size_t value)
+{
+    return (value + kPayloadAlignment - 1) / kPayloadAlignment * kPayloadAlignment;
+}
+
+void writePattern(juce::OutputStream& out, const Sequencer::Pattern& pattern)
+{
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        for (int step = 0; step < Sequencer::kSteps; ++step)
+        {
+            out.writeBool(pattern.active[pad][step]);
+            out.writeFloat(pattern.velocity[pad][step]);
+            out.writeFloat(pattern.offset[pad][step]);
+        }
+    }
+}
+
+void readPattern(juce::InputStream& in, Sequencer::Pattern& pattern)
+{
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        for (int step = 0; step < Sequencer::kSteps; ++step)
+        {
+            pattern.active[pad][step] = in.readBool();
+            pattern.velocity[pad][step] = juce::jlimit(0.0f, 1.0f, in.readFloat());
+            pattern.offset[pad][step] = juce::jlimit(-0.5f, 0.5f, in.readFloat());
+        }
+    }
+}
+} // namespace
+
+namespace KitBundle
+{
+bool write(const Kit& kit, const juce::File& file)
+{
+    // Payload offsets are stored relative to the first payload, which starts
+    // on the page after the metadata, so the metadata doesn't depend on its
+    // own size.
+    juce::MemoryOutputStream metadata;
+    size_t payloadBytes = 0;
+
+    metadata.writeInt(static_cast<int>(kit.samples.size()));
+    for (const auto& sample : kit.samples)
+    {
+        metadata.writeInt(sample->getNumChannels());
+        metadata.writeInt(sample->getNumFrames());
+        metadata.writeDouble(sample->getSampleRate());
+        metadata.writeInt(static_cast<int>(sample->getFormat()));
+        metadata.writeInt64(static_cast<juce::int64>(payloadBytes));
+
+        payloadBytes = alignUp(payloadBytes + sample->getMemoryBytes());
+    }
+
+    metadata.writeInt(static_cast<int>(kit.pads.size()));
+    for (const auto& pad : kit.pads)
+    {
+        metadata.writeInt(pad.index);
+        metadata.writeString(pad.name);
+        metadata.writeString(pad.sourceFile.getFullPathName());
+        metadata.writeInt(static_cast<int>(pad.cycle));
+        metadata.writeInt(static_cast<int>(pad.layers.size()));
+        for (const auto& layer : pad.layers)
+        {
+            metadata.writeInt(layer.sample);
+            metadata.writeInt(layer.region.getStart());
+            metadata.writeInt(layer.region.getEnd());
+            metadata.writeInt(layer.topVelocity);
+        }
+        metadata.writeFloat(pad.adsr.attack);
+        metadata.writeFloat(pad.adsr.decay);
+        metadata.writeFloat(pad.adsr.sustain);
+        metadata.writeFloat(pad.adsr.release);
+        metadata.writeInt(pad.polyphony);
+        metadata.writeInt(pad.chokeGroup);
+        metadata.writeInt(static_cast<int>(pad.role));
+        metadata.writeInt(pad.loopSteps);
+    }
+
+    writePattern(metadata, kit.pattern);
+    metadata.writeInt(static_cast<int>(kit.bank.size()));
+    for (const auto& pattern : kit.bank)
+        writePattern(metadata, pattern);
+
+    metadata.writeInt(kit.selectedBankPattern);
+
+    juce::TemporaryFile temp(file);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return false;
+
+        out.writeInt(kKitMagic);
+        out.writeInt(kKitVersion);
+        out.writeInt64(static_cast<juce::int64>(metadata.getDataSize()));
+        out << metadata;
+
+        for (const auto& sample : kit.samples)
+        {
+            out.writeRepeatedByte(0, alignUp(static_cast<size_t>(out.getPosition())) - static_cast<size_t>(out.getPosition()));
+            if (!out.write(sample->getRawBytes(), sample->getMemoryBytes()))
+                return false;
+        }
+
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool read(const juce::File& file, Kit& kit)
+{
+    auto mapping = std::make_shared<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly, false);
+    if (mapping->getData() == nullptr || mapping->getSize() < kHeaderBytes)
+        return false;
+
+    juce::MemoryInputStream in(mapping->getData(), mapping->getSize(), false);
+    if (in.readInt() != kKitMagic)
+        return false;
+
+    const int version = in.readInt();
+    if (version != kKitVersion && version != kOneShotVersion && version != kSingleLayerVersion)
+        return false;
+
+    const auto metadataBytes = in.readInt64();
+    if (metadataBytes < 0 || static_cast<size_t>(metadataBytes) > mapping->getSize() - kHeaderBytes)
+        return false;
+
+    const auto payloadStart = alignUp(kHeaderBytes + static_cast<size_t>(metadataBytes));
+    std::shared_ptr<const juce::MemoryMappedFile> sharedMapping = std::move(mapping);
+
+    Kit result;
+
+    const int numSamples = in.readInt();
+    for (int i = 0; i < numSamples && !in.isExhausted(); ++i)
+    {
+        const int channels = in.readInt();
+        const int frames = in.readInt();
+        const double rate = in.readDouble();
+        const int format = in.readInt();
+        const auto offset = in.readInt64();
+
+        if (offset < 0 || (format != static_cast<int>(SampleData::Format::float32)
+                           && format != static_cast<int>(SampleData::Format::int16)))
+            return false;
+
+        auto sample = SampleData::fromMappedFile(sharedMapping,
+                                                 payloadStart + static_cast<size_t>(offset),
+                                                 channels,
+                                                 frames,
+                                                 rate,
+                                                 static_cast<SampleData::Format>(format));
+        if (sample == nullptr)
+            return false;
+
+        result.samples.push_back(std::move(sample));
+    }
+
+    const int numPads = in.readInt();
+    for (int i = 0; i < numPads && !in.isExhausted(); ++i)
+    {
+        Pad pad;
+        pad.index = in.readInt();
+        pad.name = in.readString();
+        pad.sourceFile = juce::File::createFileWithoutCheckingPath(in.readString());
+
+        const bool layered = version != kSingleLayerVersion;
+        if (layered)
+            pad.cycle = in.readInt() == static_cast<int>(PadSound::Cycle::random) ? PadSound::Cycle::random
+                                                                                  : PadSound::Cycle::roundRobin;
+
+        const int numLayers = layered ? in.readInt() : 1;
+        if (numLayers < 1 || numLayers > kMaxLayers)
+            return false;
+
+        for (int l = 0; l < numLayers; ++l)
+        {
+            Layer layer;
+            layer.sample = in.readInt();
+            const int regionStart = in.readInt();
+            const int regionEnd = in.readInt();
+            layer.region = { regionStart, regionEnd };
+            layer.topVelocity = layered ? juce::jlimit(0, 127, in.readInt()) : 127;
+
+            if (layer.sample < 0 || layer.sample >= static_cast<int>(result.samples.size()))
+                return false;
+
+            const int frames = result.samples[static_cast<size_t>(layer.sample)]->getNumFrames();
+            if (layer.region.getStart() < 0 || layer.region.getEnd() > frames)
+                return false;
+
+            pad.layers.push_back(layer);
+        }
+
+        pad.adsr.attack = in.readFloat();
+        pad.adsr.decay = in.readFloat();
+        pad.adsr.sustain = in.readFloat();
+        pad.adsr.release = in.readFloat();
+        pad.polyphony = in.readInt();
+        pad.chokeGroup = in.readInt();
+        pad.role = static_cast<Sequencer::Role>(juce::jlimit(0, static_cast<int>(Sequencer::Role::other), in.readInt()));
+        pad.loopSteps = version == kKitVersion ? juce::jlimit(0, kMaxLoopSteps, in.readInt()) : 0;
+
+        if (pad.index < 0 || pad.index >= Sequencer::kPads)
+            return false;
+
+        result.pads.push_back(std::move(pad));
+    }
+
+    readPattern(in, result.pattern);
+
+    const int bankSize = in.readInt();
+    for (int i = 0; i < bankSize && !in.isExhausted(); ++i)
+    {
+        result.bank.emplace_back();
+        readPattern(in, result.bank.back());
+    }
+
+    result.selectedBankPattern = juce::jlimit(-1, static_cast<int>(result.bank.size()) - 1, in.readInt());
+
+    if (in.getPosition() > static_cast<juce::int64>(kHeaderBytes) + metadataBytes)
+        return false;
+
+    kit = std::move(result);
+    return true;
+}
+} // namespace KitBundle
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <memory>
+#include <vector>
+
+#include "PadSampler.h"
+#include "Sequencer.h"
+
+// Single-file .gsqkit bundles: pad settings, the pattern and pattern bank,
+// and every pad's decoded audio. The audio is stored exactly as SampleData
+// keeps it in memory, each sample starting on a page boundary, so loading
+// maps the file and plays from it with no decode step. Instances that open
+// the same bundle share its pages through the OS page cache.
+namespace KitBundle
+{
+constexpr const char* kFileExtension = ".gsqkit";
+
+struct Layer
+{
+    int sample = 0; // into Kit::samples
+    juce::Range<int> region;
+    int topVelocity = 127;
+};
+
+struct Pad
+{
+    int index = 0;
+    juce::String name;
+    juce::File sourceFile; // the audio the pad was loaded from, for its waveform
+    std::vector<Layer> layers;
+    PadSound::Cycle cycle = PadSound::Cycle::roundRobin;
+    juce::ADSR::Parameters adsr;
+    int polyphony = 1;
+    int chokeGroup = 0;
+    Sequencer::Role role = Sequencer::Role::other;
+    int loopSteps = 0; // 0 for a one-shot
+};
+
+struct Kit
+{
+    std::vector<Pad> pads; // loaded pads only
+    std::vector<std::shared_ptr<const SampleData>> samples;
+    Sequencer::Pattern pattern;
+    std::vector<Sequencer::Pattern> bank;
+    int selectedBankPattern = -1;
+};
+
+// Writes through a temporary file, so a bundle that is open elsewhere is
+// swapped rather than overwritten in place.
+bool write(const Kit& kit, const juce::File& file);
+
+// Maps file read-only; the returned samples point into the mapping. Reads
+// bundles from before velocity layers as one layer per pad, and bundles from
+// before loop pads as one-shots.
+bool read(const juce::File& file, Kit& kit);
+} // namespace KitBundle
@@ -0,0 +1,260 @@
+#include "LoopStretcher.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// Long enough to hold a few periods of a kick's fundamental, short enough
+// that hits don't smear; windows overlap by half.
+constexpr double kWindowSeconds = 0.04;
+// How far a window may move from its nominal position to line up with the last.
+constexpr double kToleranceSeconds = 0.01;
+// The search runs on a 4x decimated mono guide and is refined at full rate.
+constexpr int kDecimation = 4;
+// Windows between checks for a newer request.
+constexpr int kAbandonCheckWindows = 32;
+// Below this the window sum is treated as no coverage.
+constexpr float kMinWindowSum = 1.0e-3f;
+
+float dot(const float* a, const float* b, int count) noexcept
+{
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+// Start in [low, high] whose window best continues the one at target.
+int bestMatch(const std::vector<float>& mono,
+              const std::vector<float>& coarse,
+              int target,
+              int low,
+              int high,
+              int windowFrames) noexcept
+{
+    const int coarseWindow = windowFrames / kDecimation;
+    const float* coarseTarget = coarse.data() + target / kDecimation;
+
+    int best = low;
+    float bestScore = std::numeric_limits<float>::lowest();
+    for (int c = low / kDecimation; c <= high / kDecimation; ++c)
+    {
+        const float score = dot(coarse.data() + c, coarseTarget, coarseWindow);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = c * kDecimation;
+        }
+    }
+
+    const int from = juce::jmax(low, best - kDecimation);
+    const int to = juce::jmin(high, best + kDecimation);
+    best = from;
+    bestScore = std::numeric_limits<float>::lowest();
+    for (int position = from; position <= to; ++position)
+    {
+        const float score = dot(mono.data() + position, mono.data() + target, windowFrames);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = position;
+        }
+    }
+
+    return best;
+}
+} // namespace
+
+LoopStretcher::LoopStretcher()
+    : juce::Thread("GrooveSeq loop stretcher")
+{
+}
+
+LoopStretcher::~LoopStretcher()
+{
+    stopThread(4000);
+}
+
+void LoopStretcher::stretch(int pad, juce::ReferenceCountedObjectPtr<PadSound> sound, double bpm, Callback onDone)
+{
+    if (pad < 0 || pad >= Sequencer::kPads || sound == nullptr)
+        return;
+
+    {
+        const std::lock_guard<std::mutex> lock(requestMutex);
+        pending[static_cast<size_t>(pad)] = { std::move(sound), bpm, std::move(onDone) };
+        ++generations[static_cast<size_t>(pad)];
+    }
+
+    if (!isThreadRunning())
+        startThread(juce::Thread::Priority::low);
+    else
+        notify();
+}
+
+bool LoopStretcher::shouldAbandon(int pad, juce::uint32 generation) const
+{
+    return threadShouldExit() || generations[static_cast<size_t>(pad)].load() != generation;
+}
+
+void LoopStretcher::run()
+{
+    while (!threadShouldExit())
+    {
+        int pad = -1;
+        Request request;
+        juce::uint32 generation = 0;
+        {
+            const std::lock_guard<std::mutex> lock(requestMutex);
+            for (size_t p = 0; p < pending.size() && pad < 0; ++p)
+            {
+                if (pending[p].sound == nullptr)
+                    continue;
+
+                pad = static_cast<int>(p);
+                request = std::move(pending[p]);
+                pending[p] = {};
+                generation = generations[p].load();
+            }
+        }
+
+        if (pad < 0)
+        {
+            wait(-1);
+            continue;
+        }
+
+        auto result = std::make_shared<PadSound::Stretch>();
+        result->bpm = request.bpm;
+
+        // Dropped when a newer request for the pad arrived while rendering;
+        // that one is already queued.
+        if (!render(pad, generation, request, *result) || shouldAbandon(pad, generation) || !request.onDone)
+            continue;
+
+        juce::WeakReference<LoopStretcher> weakThis(this);
+        juce::MessageManager::callAsync([weakThis,
+                                         pad,
+                                         onDone = std::move(request.onDone),
+                                         sound = std::move(request.sound),
+                                         stretched = std::shared_ptr<const PadSound::Stretch>(std::move(result))]
+        {
+            if (weakThis != nullptr)
+                onDone(pad, sound, stretched);
+        });
+    }
+}
+
+bool LoopStretcher::render(int pad, juce::uint32 generation, const Request& request, PadSound::Stretch& result)
+{
+    const int loopSteps = request.sound->getLoopSteps();
+    if (loopSteps <= 0 || request.bpm <= 0.0)
+        return false;
+
+    for (const auto& layer : request.sound->getLayers())
+    {
+        const int targetFrames = juce::roundToInt(loopSteps * 15.0 / request.bpm * layer.data->getSampleRate());
+
+        std::shared_ptr<const SampleData> stretched;
+        if (!stretchLayer(pad, generation, layer, targetFrames, stretched))
+            return false;
+
+        result.layers.push_back(std::move(stretched));
+    }
+
+    return true;
+}
+
+bool LoopStretcher::stretchLayer(int pad,
+                                 juce::uint32 generation,
+                                 const PadSound::Layer& layer,
+                                 int targetFrames,
+                                 std::shared_ptr<const SampleData>& result)
+{
+    const auto& source = *layer.data;
+    const int inputFrames = layer.region.getLength();
+    const int channels = source.getNumChannels();
+    const double rate = source.getSampleRate();
+    if (inputFrames <= 0 || targetFrames <= 0)
+        return false;
+
+    const int windowFrames = juce::jmax(2 * kDecimation, juce::roundToInt(kWindowSeconds * rate) / (2 * kDecimation) * (2 * kDecimation));
+    const int hop = windowFrames / 2;
+    const int tolerance = juce::roundToInt(kToleranceSeconds * rate);
+    const double analysisHop = hop * static_cast<double>(inputFrames) / targetFrames;
+
+    // Zero padded, so windows running past the end of the region read silence.
+    const int paddedFrames = inputFrames + 2 * (windowFrames + tolerance);
+    juce::AudioBuffer<float> input(channels, paddedFrames);
+    input.clear();
+
+    // The budget may move the source to disk meanwhile; don't read freed heap.
+    const auto storage = source.retainStorage();
+    std::vector<float> mono(static_cast<size_t>(paddedFrames), 0.0f);
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        source.decode(ch, layer.region.getStart(), inputFrames, input.getWritePointer(ch));
+        juce::FloatVectorOperations::addWithMultiply(mono.data(), input.getReadPointer(ch), 1.0f / channels, inputFrames);
+    }
+
+    std::vector<float> coarse(static_cast<size_t>(paddedFrames / kDecimation), 0.0f);
+    for (size_t i = 0; i < coarse.size(); ++i)
+    {
+        for (int k = 0; k < kDecimation; ++k)
+            coarse[i] += mono[i * kDecimation + static_cast<size_t>(k)];
+    }
+
+    // Hann, offset half a frame so neighbouring windows sum to exactly one.
+    std::vector<float> window(static_cast<size_t>(windowFrames));
+    for (int n = 0; n < windowFrames; ++n)
+        window[static_cast<size_t>(n)] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * juce::MathConstants<double>::pi * (n + 0.5) / windowFrames));
+
+    juce::AudioBuffer<float> output(channels, targetFrames + windowFrames);
+    output.clear();
+    std::vector<float> windowSum(static_cast<size_t>(targetFrames + windowFrames), 0.0f);
+
+    // Every channel takes its windows from the same places, so the stereo
+    // image holds together.
+    int previous = 0;
+    for (int frame = 0, outputStart = 0; outputStart < targetFrames; ++frame, outputStart += hop)
+    {
+        if (frame % kAbandonCheckWindows == 0 && shouldAbandon(pad, generation))
+            return false;
+
+        int position = 0;
+        if (frame > 0)
+        {
+            const int nominal = juce::roundToInt(frame * analysisHop);
+            const int low = juce::jlimit(0, inputFrames, nominal - tolerance);
+            const int high = juce::jlimit(0, inputFrames, nominal + tolerance);
+            position = bestMatch(mono, coarse, previous + hop, low, high, windowFrames);
+        }
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            const float* in = input.getReadPointer(ch, position);
+            float* out = output.getWritePointer(ch, outputStart);
+            for (int n = 0; n < windowFrames; ++n)
+                out[n] += in[n] * window[static_cast<size_t>(n)];
+        }
+
+        juce::FloatVectorOperations::add(windowSum.data() + outputStart, window.data(), windowFrames);
+        previous = position;
+    }
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        float* out = output.getWritePointer(ch);
+        for (int i = 0; i < targetFrames; ++i)
+        {
+            if (windowSum[static_cast<size_t>(i)] > kMinWindowSum)
+                out[i] /= windowSum[static_cast<size_t>(i)];
+        }
+    }
+
+    result = SampleData::fromBuffer(output, targetFrames, rate, source.getFormat());
+    return result != nullptr;
+}
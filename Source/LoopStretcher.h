@@ -0,0 +1,57 @@
+#pragma once
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "PadSampler.h"
+#include "Sequencer.h"
+
+// Renders loop pads time-stretched to a tempo on a background thread, so the
+// audio thread only ever reads the result. Stretching is WSOLA: ~40 ms
+// windows are overlap-added at a fixed output hop, each taken from where it
+// best continues the previous one, which keeps pitch and transients intact
+// for ratios well beyond what varispeed gets away with.
+class LoopStretcher : private juce::Thread
+{
+public:
+    using Callback = std::function<void(int pad,
+                                        const juce::ReferenceCountedObjectPtr<PadSound>& source,
+                                        std::shared_ptr<const PadSound::Stretch> stretch)>;
+
+    LoopStretcher();
+    ~LoopStretcher() override;
+
+    // Starts rendering every layer of sound over its loop steps at bpm,
+    // replacing any render of pad that hasn't finished. onDone is called on
+    // the message thread with the sound the stretch was made from.
+    void stretch(int pad, juce::ReferenceCountedObjectPtr<PadSound> sound, double bpm, Callback onDone);
+
+private:
+    struct Request
+    {
+        juce::ReferenceCountedObjectPtr<PadSound> sound;
+        double bpm = 120.0;
+        Callback onDone;
+    };
+
+    void run() override;
+    bool render(int pad, juce::uint32 generation, const Request& request, PadSound::Stretch& result);
+    bool stretchLayer(int pad,
+                      juce::uint32 generation,
+                      const PadSound::Layer& layer,
+                      int targetFrames,
+                      std::shared_ptr<const SampleData>& result);
+    bool shouldAbandon(int pad, juce::uint32 generation) const;
+
+    std::mutex requestMutex;
+    std::array<Request, Sequencer::kPads> pending; // under requestMutex
+    // Bumped by every request, so a render can tell it has been replaced.
+    std::array<std::atomic<juce::uint32>, Sequencer::kPads> generations{};
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(LoopStretcher)
+};
@@ -0,0 +1,193 @@
+#include "LoopTranscriber.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "SampleAnalysis.h"
+
+namespace
+{
+constexpr double kMaxLoopSeconds = 60.0;
+constexpr int kChunkFrames = 32768;
+
+// Finer than the detector's default so hits keep ~3 ms of timing at 44.1 kHz.
+constexpr int kOnsetHopSize = 128;
+
+// Band split: kick fundamentals, snare body and crack, hat sizzle.
+constexpr double kKickCutoffHz = 150.0;
+constexpr double kSnareCentreHz = 1200.0;
+constexpr double kSnareQ = 0.8;
+constexpr double kHatCutoffHz = 7000.0;
+
+// A snare's noise also reaches the hat band; hat onsets this close to a snare are dropped.
+constexpr double kMaskSeconds = 0.02;
+
+// Hits this far below the loudest one in their band get the minimum velocity.
+constexpr float kVelocityRangeDb = 24.0f;
+constexpr float kMinVelocity = 0.2f;
+
+struct Band
+{
+    Sequencer::Role role;
+    juce::IIRCoefficients coefficients;
+};
+} // namespace
+
+LoopTranscriber::LoopTranscriber()
+    : juce::Thread("GrooveSeq loop transcriber")
+{
+    formatManager.registerBasicFormats();
+}
+
+LoopTranscriber::~LoopTranscriber()
+{
+    stopThread(4000);
+}
+
+void LoopTranscriber::transcribe(const juce::File& file, double bpm, Callback onDone)
+{
+    {
+        const std::lock_guard<std::mutex> lock(requestMutex);
+        pending = { file, bpm, std::move(onDone) };
+    }
+
+    progress = 0.0f;
+    requestPending = true;
+
+    if (!isThreadRunning())
+        startThread(juce::Thread::Priority::normal);
+    else
+        notify();
+}
+
+void LoopTranscriber::run()
+{
+    while (!threadShouldExit())
+    {
+        if (!requestPending.exchange(false))
+        {
+            wait(-1);
+            continue;
+        }
+
+        Request request;
+        {
+            const std::lock_guard<std::mutex> lock(requestMutex);
+            request = std::move(pending);
+        }
+
+        Result result;
+        const bool finished = analyse(request, result);
+
+        // A newer drop replaced this one; its progress is already running.
+        if (requestPending.load())
+            continue;
+
+        progress = -1.0f;
+
+        if (finished && request.onDone)
+        {
+            juce::WeakReference<LoopTranscriber> weakThis(this);
+            juce::MessageManager::callAsync([weakThis, onDone = std::move(request.onDone), result = std::move(result)]
+            {
+                if (weakThis != nullptr)
+                    onDone(result);
+            });
+        }
+    }
+}
+
+bool LoopTranscriber::analyse(const Request& request, Result& result)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(request.file));
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0)
+        return false;
+
+    const double sampleRate = reader->sampleRate;
+    const auto numFrames = juce::jmin(reader->lengthInSamples,
+                                      static_cast<juce::int64>(kMaxLoopSeconds * sampleRate));
+    const int channels = juce::jlimit(1, 2, static_cast<int>(reader->numChannels));
+
+    const std::array<Band, 3> bands {{
+        { Sequencer::Role::kick, juce::IIRCoefficients::makeLowPass(sampleRate, kKickCutoffHz) },
+        { Sequencer::Role::snare, juce::IIRCoefficients::makeBandPass(sampleRate, kSnareCentreHz, kSnareQ) },
+        { Sequencer::Role::closedHat, juce::IIRCoefficients::makeHighPass(sampleRate, kHatCutoffHz) },
+    }};
+
+    std::array<juce::IIRFilter, 3> filters;
+    std::vector<SampleAnalysis::OnsetDetector> detectors;
+    for (size_t b = 0; b < bands.size(); ++b)
+    {
+        filters[b].setCoefficients(bands[b].coefficients);
+        detectors.emplace_back(sampleRate, kOnsetHopSize);
+    }
+
+    juce::AudioBuffer<float> chunk(channels, kChunkFrames);
+    juce::AudioBuffer<float> filtered(static_cast<int>(bands.size()), kChunkFrames);
+
+    for (juce::int64 position = 0; position < numFrames; position += kChunkFrames)
+    {
+        if (shouldAbandon())
+            return false;
+
+        const int count = static_cast<int>(juce::jmin<juce::int64>(kChunkFrames, numFrames - position));
+        reader->read(&chunk, 0, count, position, true, true);
+
+        if (channels > 1)
+        {
+            chunk.applyGain(0, count, 0.5f);
+            chunk.addFrom(0, 0, chunk, 1, 0, count);
+        }
+
+        for (size_t b = 0; b < bands.size(); ++b)
+        {
+            const int ch = static_cast<int>(b);
+            filtered.copyFrom(ch, 0, chunk, 0, 0, count);
+            filters[b].processSamples(filtered.getWritePointer(ch), count);
+            detectors[b].process(filtered.getReadPointer(ch), count);
+        }
+
+        progress = static_cast<float>(static_cast<double>(position + count) / static_cast<double>(numFrames));
+    }
+
+    result.loopSteps = Sequencer::estimateLoopSteps(static_cast<double>(numFrames) / sampleRate, request.bpm);
+
+    const auto& snareOnsets = detectors[1].getOnsets();
+    const auto maskSamples = static_cast<juce::int64>(kMaskSeconds * sampleRate);
+
+    auto maskedBySnare = [&snareOnsets, maskSamples](juce::int64 onset)
+    {
+        const auto next = std::lower_bound(snareOnsets.begin(), snareOnsets.end(), onset - maskSamples);
+        return next != snareOnsets.end() && *next <= onset + maskSamples;
+    };
+
+    for (size_t b = 0; b < bands.size(); ++b)
+    {
+        const auto& onsets = detectors[b].getOnsets();
+        const auto& levels = detectors[b].getLevels();
+        if (onsets.empty())
+            continue;
+
+        const float loudest = *std::max_element(levels.begin(), levels.end());
+
+        for (size_t i = 0; i < onsets.size(); ++i)
+        {
+            if (bands[b].role == Sequencer::Role::closedHat && maskedBySnare(onsets[i]))
+                continue;
+
+            const double position = static_cast<double>(onsets[i]) / static_cast<double>(numFrames)
+                * static_cast<double>(result.loopSteps);
+            const double nearest = std::round(position);
+
+            Hit hit;
+            hit.role = bands[b].role;
+            hit.step = static_cast<int>(nearest) % result.loopSteps;
+            hit.offset = static_cast<float>(position - nearest);
+            hit.velocity = juce::jlimit(kMinVelocity, 1.0f, 1.0f + (levels[i] - loudest) / kVelocityRangeDb);
+            result.hits.push_back(hit);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "Sequencer.h"
+
+// Turns a drum loop into pattern hits on a background thread. The loop is
+// split into low, mid and high bands; onsets in each become kick, snare and
+// hat hits, placed on the 16th grid with their distance from it kept as
+// micro-timing and their level as velocity.
+class LoopTranscriber : private juce::Thread
+{
+public:
+    struct Hit
+    {
+        Sequencer::Role role = Sequencer::Role::kick;
+        int step = 0;        // within the loop, 0..loopSteps-1
+        float offset = 0.0f; // from the grid, in steps
+        float velocity = Sequencer::kDefaultVelocity;
+    };
+
+    struct Result
+    {
+        int loopSteps = 0;
+        std::vector<Hit> hits;
+    };
+
+    using Callback = std::function<void(const Result&)>;
+
+    LoopTranscriber();
+    ~LoopTranscriber() override;
+
+    // Starts transcribing file, abandoning any transcription still running.
+    // bpm is used to guess how many 16ths the loop spans. onDone is called
+    // on the message thread.
+    void transcribe(const juce::File& file, double bpm, Callback onDone);
+
+    // 0..1 while a transcription is running, -1 otherwise.
+    float getProgress() const noexcept { return progress.load(std::memory_order_relaxed); }
+
+private:
+    struct Request
+    {
+        juce::File file;
+        double bpm = 120.0;
+        Callback onDone;
+    };
+
+    void run() override;
+    bool analyse(const Request& request, Result& result);
+    bool shouldAbandon() const { return threadShouldExit() || requestPending.load(); }
+
+    juce::AudioFormatManager formatManager;
+
+    std::mutex requestMutex;
+    Request pending;
+    std::atomic<bool> requestPending { false };
+    std::atomic<float> progress { -1.0f };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(LoopTranscriber)
+};
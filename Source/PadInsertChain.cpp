@@ -0,0 +1,192 @@
+#include "PadInsertChain.h"
+
+#include <cmath>
+
+namespace
+{
+constexpr float kTransientRangeDb = 12.0f;
+constexpr float kDbToNeper = 0.11512925f; // ln(10) / 20
+constexpr float kEnvelopeFloor = 1.0e-6f;
+// The drive fades in from dry over this much, so it starts from unity gain.
+constexpr float kDriveFadeDb = 6.0f;
+
+float coefficientForTime(double seconds, double sampleRate)
+{
+    return static_cast<float>(std::exp(-1.0 / (seconds * sampleRate)));
+}
+} // namespace
+
+PadInsertChain::PadInsertChain()
+    : oversampling(2, 1, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, false)
+    , highQualityOversampling(2, 3, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, false)
+{
+    oversampling.setUsingIntegerLatency(true);
+    highQualityOversampling.setUsingIntegerLatency(true);
+}
+
+void PadInsertChain::prepare(double newSampleRate, int maxBlockSize)
+{
+    sampleRate = newSampleRate;
+
+    const juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(maxBlockSize), 2 };
+    filter.prepare(spec);
+    oversampling.initProcessing(static_cast<size_t>(maxBlockSize));
+    highQualityOversampling.initProcessing(static_cast<size_t>(maxBlockSize));
+
+    latencySamples = juce::roundToInt(juce::jmax(oversampling.getLatencyInSamples(),
+                                                 highQualityOversampling.getLatencyInSamples()));
+    alignment.setMaximumDelayInSamples(juce::jmax(1, latencySamples));
+    alignment.prepare(spec);
+
+    tailSamples = static_cast<int>(kTailSeconds * sampleRate);
+    fastAttackCoeff = coefficientForTime(0.0005, sampleRate);
+    slowAttackCoeff = coefficientForTime(0.02, sampleRate);
+    releaseCoeff = coefficientForTime(0.1, sampleRate);
+
+    reset();
+}
+
+void PadInsertChain::reset()
+{
+    resetEffects();
+    alignment.reset();
+    wasActive = false;
+    tailSamplesRemaining = 0;
+}
+
+void PadInsertChain::resetEffects()
+{
+    filter.reset();
+    oversampling.reset();
+    highQualityOversampling.reset();
+    lastDriveActive = false;
+    fastEnvelope = 0.0f;
+    slowEnvelope = 0.0f;
+}
+
+bool PadInsertChain::filterIsNeutral(const Settings& settings) noexcept
+{
+    switch (settings.filterType)
+    {
+        case FilterType::lowPass:  return settings.cutoffHz >= kMaxCutoffHz;
+        case FilterType::highPass: return settings.cutoffHz <= kMinCutoffHz;
+        case FilterType::bandPass: return false;
+    }
+
+    return true;
+}
+
+void PadInsertChain::process(juce::AudioBuffer<float>& buffer, int numSamples, const Settings& settings, bool hasInput)
+{
+    const bool filterActive = !filterIsNeutral(settings);
+    const bool driveActive = settings.driveDb > 0.0f;
+    const bool transientActive = std::abs(settings.attack) > 0.001f || std::abs(settings.sustain) > 0.001f;
+    const bool effectsActive = filterActive || driveActive || transientActive;
+
+    // Coming back from bypass: start from clean state rather than whatever
+    // the filters held when they were last used.
+    if (effectsActive && !wasActive)
+        resetEffects();
+
+    wasActive = effectsActive;
+
+    // A bypassed chain only has the alignment delay to play out.
+    if (hasInput)
+        tailSamplesRemaining = effectsActive ? tailSamples : latencySamples;
+
+    juce::dsp::AudioBlock<float> block(buffer);
+    auto active = block.getSubBlock(0, static_cast<size_t>(numSamples));
+
+    if (filterActive)
+        applyFilter(active, settings);
+
+    int delay = latencySamples;
+    if (driveActive)
+        delay -= applyDrive(active, settings.driveDb, settings.highQuality);
+    else
+        lastDriveActive = false;
+
+    if (transientActive)
+        applyTransientShaper(buffer, numSamples, settings);
+
+    if (delay > 0)
+    {
+        alignment.setDelay(static_cast<float>(delay));
+        alignment.process(juce::dsp::ProcessContextReplacing<float>(active));
+    }
+
+    if (!hasInput)
+        tailSamplesRemaining = juce::jmax(0, tailSamplesRemaining - numSamples);
+}
+
+void PadInsertChain::applyFilter(juce::dsp::AudioBlock<float>& block, const Settings& settings)
+{
+    switch (settings.filterType)
+    {
+        case FilterType::lowPass:  filter.setType(juce::dsp::StateVariableTPTFilterType::lowpass); break;
+        case FilterType::highPass: filter.setType(juce::dsp::StateVariableTPTFilterType::highpass); break;
+        case FilterType::bandPass: filter.setType(juce::dsp::StateVariableTPTFilterType::bandpass); break;
+    }
+
+    const auto nyquistLimit = static_cast<float>(sampleRate * 0.45);
+    filter.setCutoffFrequency(juce::jlimit(kMinCutoffHz, nyquistLimit, settings.cutoffHz));
+    filter.setResonance(settings.resonance);
+    filter.process(juce::dsp::ProcessContextReplacing<float>(block));
+}
+
+int PadInsertChain::applyDrive(juce::dsp::AudioBlock<float>& block, float driveDb, bool highQuality)
+{
+    const float driveGain = juce::Decibels::decibelsToGain(driveDb);
+    // Keeps a full-scale input at full scale whatever the drive amount.
+    const float makeup = 1.0f / std::tanh(driveGain);
+    const float mix = juce::jmin(1.0f, driveDb / kDriveFadeDb);
+    auto& stage = highQuality ? highQualityOversampling : oversampling;
+
+    // The other stage's filters hold audio from before the switch, and a
+    // stage that wasn't running holds audio from before it stopped.
+    if (highQuality != lastDriveHighQuality || !lastDriveActive)
+    {
+        stage.reset();
+        lastDriveHighQuality = highQuality;
+        lastDriveActive = true;
+    }
+
+    auto oversampled = stage.processSamplesUp(block);
+    for (size_t ch = 0; ch < oversampled.getNumChannels(); ++ch)
+    {
+        auto* data = oversampled.getChannelPointer(ch);
+        for (size_t i = 0; i < oversampled.getNumSamples(); ++i)
+        {
+            const float dry = data[i];
+            data[i] = dry + mix * (std::tanh(dry * driveGain) * makeup - dry);
+        }
+    }
+
+    stage.processSamplesDown(block);
+    return juce::roundToInt(stage.getLatencyInSamples());
+}
+
+void PadInsertChain::applyTransientShaper(juce::AudioBuffer<float>& buffer, int numSamples, const Settings& settings)
+{
+    auto* left = buffer.getWritePointer(0);
+    auto* right = buffer.getWritePointer(1);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float level = juce::jmax(std::abs(left[i]), std::abs(right[i]));
+
+        fastEnvelope = level + (level > fastEnvelope ? fastAttackCoeff : releaseCoeff) * (fastEnvelope - level);
+        slowEnvelope = level + (level > slowEnvelope ? slowAttackCoeff : releaseCoeff) * (slowEnvelope - level);
+
+        // How far the fast follower leads the slow one: ~1 on the hit, 0 in the body.
+        const float transient = fastEnvelope > kEnvelopeFloor
+            ? juce::jlimit(0.0f, 1.0f, (fastEnvelope - slowEnvelope) / fastEnvelope)
+            : 0.0f;
+
+        const float gainDb = kTransientRangeDb * (settings.attack * transient + settings.sustain * (1.0f - transient));
+        const float gain = std::exp(gainDb * kDbToNeper);
+
+        left[i] *= gain;
+        right[i] *= gain;
+    }
+}
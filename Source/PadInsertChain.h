@@ -0,0 +1,83 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+#include <array>
+
+// Per-pad insert effects: state-variable filter, oversampled waveshaper and
+// transient shaper. Stages left at their neutral settings are skipped, and the
+// whole chain stops processing once the pad's voices and effect tails are done.
+// Every pad is delayed by getLatencySamples() whichever stages run, so the
+// oversampled drive never moves a pad against the others or the host.
+class PadInsertChain
+{
+public:
+    enum class FilterType
+    {
+        lowPass = 0,
+        highPass,
+        bandPass
+    };
+
+    struct Settings
+    {
+        FilterType filterType = FilterType::lowPass;
+        float cutoffHz = 20000.0f;
+        float resonance = 0.707f;
+        float driveDb = 0.0f;
+        float attack = 0.0f;  // -1..1, cut or boost transients
+        float sustain = 0.0f; // -1..1, cut or boost the body after the hit
+        bool highQuality = false; // offline: drive oversampled 8x instead of 2x
+    };
+
+    static constexpr float kMinCutoffHz = 20.0f;
+    static constexpr float kMaxCutoffHz = 20000.0f;
+
+    // Long enough for a resonant filter to ring out after the last voice ends.
+    static constexpr double kTailSeconds = 0.25;
+
+    PadInsertChain();
+
+    void prepare(double sampleRate, int maxBlockSize);
+    void reset();
+
+    // The same in real time and offline; valid after prepare().
+    int getLatencySamples() const noexcept { return latencySamples; }
+
+    // True while the chain still has a tail to play out after its input stopped.
+    bool isTailActive() const noexcept { return tailSamplesRemaining > 0; }
+
+    // Processes the first numSamples of a stereo buffer in place. hasInput says
+    // whether any voice wrote into the buffer this block.
+    void process(juce::AudioBuffer<float>& buffer, int numSamples, const Settings& settings, bool hasInput);
+
+private:
+    static bool filterIsNeutral(const Settings& settings) noexcept;
+
+    void resetEffects();
+    void applyFilter(juce::dsp::AudioBlock<float>& block, const Settings& settings);
+    // Returns the latency the drive added.
+    int applyDrive(juce::dsp::AudioBlock<float>& block, float driveDb, bool highQuality);
+    void applyTransientShaper(juce::AudioBuffer<float>& buffer, int numSamples, const Settings& settings);
+
+    double sampleRate = 44100.0;
+    int latencySamples = 0;
+    int tailSamples = 0;
+    int tailSamplesRemaining = 0;
+    bool wasActive = false;
+
+    juce::dsp::StateVariableTPTFilter<float> filter;
+    // Both are prepared up front so switching quality never allocates.
+    juce::dsp::Oversampling<float> oversampling;
+    juce::dsp::Oversampling<float> highQualityOversampling;
+    bool lastDriveHighQuality = false;
+    bool lastDriveActive = false;
+    // Makes up the difference between the drive's latency, if it ran, and latencySamples.
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None> alignment;
+
+    float fastAttackCoeff = 0.0f;
+    float slowAttackCoeff = 0.0f;
+    float releaseCoeff = 0.0f;
+    float fastEnvelope = 0.0f;
+    float slowEnvelope = 0.0f;
+};
@@ -0,0 +1,1371 @@
+#include "PadSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+ #define GROOVESEQ_LOCK_PAGES 1
+ #include <sys/mman.h>
+ #include <unistd.h>
+#else
+ #define GROOVESEQ_LOCK_PAGES 0
+#endif
+
+namespace
+{
+constexpr float kInt16Scale = 32767.0f;
+constexpr int kLoadChunkFrames = 32768;
+constexpr size_t kPageBytes = 4096;
+
+// Released voices whose envelope falls below -80 dBFS are ended early.
+constexpr float kSilenceThreshold = 1.0e-4f;
+constexpr float kFadeOutSeconds = 0.004f;
+
+// Slices are cut at the next hit; ramp their last few ms down so the cut doesn't click.
+constexpr double kRegionFadeSeconds = 0.003;
+
+// Loop speeds this close to 1 play at exactly 1, so a stretch rendered at the
+// current tempo is read sample for sample.
+constexpr double kUnitSpeedTolerance = 1.0e-4;
+
+// Windowed-sinc interpolation for high-quality rendering: a 16-tap
+// Blackman-windowed kernel tabulated at 512 fractional positions, with the
+// cutoff just under Nyquist so sources up to ~10% above the output rate
+// don't alias.
+constexpr int kSincTaps = 16;
+constexpr int kSincHalfTaps = kSincTaps / 2;
+constexpr int kSincPhases = 512;
+constexpr double kSincCutoff = 0.9;
+
+using SincTable = std::array<std::array<float, kSincTaps>, kSincPhases + 1>;
+
+SincTable makeSincTable()
+{
+    SincTable table{};
+
+    for (int phase = 0; phase <= kSincPhases; ++phase)
+    {
+        const double fraction = static_cast<double>(phase) / kSincPhases;
+        double sum = 0.0;
+
+        for (int tap = 0; tap < kSincTaps; ++tap)
+        {
+            // Distance from the interpolated position to this tap's frame.
+            const double distance = tap - (kSincHalfTaps - 1) - fraction;
+            const double x = juce::MathConstants<double>::pi * kSincCutoff * distance;
+            const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(x) / x;
+
+            const double w = (distance + kSincHalfTaps) / kSincTaps; // 0..1 across the kernel
+            const double window = 0.42 - 0.5 * std::cos(2.0 * juce::MathConstants<double>::pi * w)
+                                + 0.08 * std::cos(4.0 * juce::MathConstants<double>::pi * w);
+
+            const double value = sinc * window;
+            table[static_cast<size_t>(phase)][static_cast<size_t>(tap)] = static_cast<float>(value);
+            sum += value;
+        }
+
+        // Unity gain at DC for every phase.
+        for (auto& value : table[static_cast<size_t>(phase)])
+            value = static_cast<float>(value / sum);
+    }
+
+    return table;
+}
+
+// Built at load time so the audio thread never computes it.
+const SincTable sincTable = makeSincTable();
+
+// in[pos + 1 - kSincHalfTaps] to in[pos + kSincHalfTaps] must be readable.
+float interpolateSinc(const float* in, int pos, float alpha) noexcept
+{
+    const float phase = alpha * kSincPhases;
+    const int row = juce::jmin(kSincPhases - 1, static_cast<int>(phase));
+    const float blend = phase - static_cast<float>(row);
+
+    const auto& a = sincTable[static_cast<size_t>(row)];
+    const auto& b = sincTable[static_cast<size_t>(row + 1)];
+    const float* x = in + pos + 1 - kSincHalfTaps;
+
+    float sumA = 0.0f;
+    float sumB = 0.0f;
+    for (int tap = 0; tap < kSincTaps; ++tap)
+    {
+        sumA += x[tap] * a[static_cast<size_t>(tap)];
+        sumB += x[tap] * b[static_cast<size_t>(tap)];
+    }
+
+    return sumA + (sumB - sumA) * blend;
+}
+
+// Mapped data streams in chunks. Each playback start keeps its first
+// kHeadSeconds on the heap, which covers the read-ahead thread's reaction
+// time; chunks up to kReadAheadSeconds past where a voice reads are paged in
+// and locked ahead of it, and unlocked about a second after the last read.
+constexpr int kStreamChunkFrames = 8192;
+constexpr double kHeadSeconds = 0.25;
+constexpr double kReadAheadSeconds = 1.0;
+constexpr int kReadAheadPollMs = 5;
+constexpr int kSweepPolls = 100;
+
+// The audio thread moves cold chunks to wanted and marks the others used as
+// it reads them; the read-ahead thread makes wanted chunks resident and, on
+// a sweep, steps unused ones down through draining to cold. A draining chunk
+// is still locked, so it can be picked up again where it is.
+enum class ChunkState : juce::uint8
+{
+    cold,
+    wanted,
+    resident,
+    used,
+    draining
+};
+
+// Pins [begin, begin + bytes) in RAM, faulting it in. When the OS won't lock
+// it the pages are still faulted in, but may be dropped again later.
+bool lockPages(const char* begin, size_t bytes) noexcept
+{
+#if GROOVESEQ_LOCK_PAGES
+    const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto first = reinterpret_cast<std::uintptr_t>(begin) & ~(pageSize - 1);
+    const auto end = reinterpret_cast<std::uintptr_t>(begin) + bytes;
+    if (mlock(reinterpret_cast<const void*>(first), end - first) == 0)
+        return true;
+#endif
+
+    float sink = 0.0f;
+    for (size_t offset = 0; offset < bytes; offset += kPageBytes)
+        sink += static_cast<float>(begin[offset]);
+
+    volatile float touched = sink;
+    juce::ignoreUnused(touched);
+    return false;
+}
+
+// Unlocks the pages wholly inside the range. Pages shared with a neighbouring
+// range stay locked until the file is unmapped, as locks don't nest.
+void unlockPages(const char* begin, size_t bytes) noexcept
+{
+#if GROOVESEQ_LOCK_PAGES
+    const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto first = (reinterpret_cast<std::uintptr_t>(begin) + pageSize - 1) & ~(pageSize - 1);
+    const auto end = (reinterpret_cast<std::uintptr_t>(begin) + bytes) & ~(pageSize - 1);
+    if (end > first)
+        munlock(reinterpret_cast<const void*>(first), end - first);
+#else
+    juce::ignoreUnused(begin, bytes);
+#endif
+}
+} // namespace
+
+//==============================================================================
+// One thread pages in streamed data for every instance in the process.
+class SampleData::ReadAhead : private juce::Thread
+{
+public:
+    ReadAhead()
+        : juce::Thread("GrooveSeq sample read-ahead")
+    {
+        startThread(juce::Thread::Priority::high);
+    }
+
+    ~ReadAhead() override
+    {
+        stopThread(4000);
+    }
+
+    void add(Streaming& stream)
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        streams.push_back(&stream);
+    }
+
+    // Returns once the thread has let go of stream.
+    void remove(Streaming& stream)
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        streams.erase(std::remove(streams.begin(), streams.end(), &stream), streams.end());
+    }
+
+private:
+    void run() override;
+
+    std::mutex mutex;
+    std::vector<Streaming*> streams; // under mutex
+};
+
+struct SampleData::Streaming
+{
+    Streaming(const SampleData& data, int chunks);
+    ~Streaming();
+
+    // Audio thread: whether chunk can be read without faulting.
+    bool isResident(int chunk) noexcept;
+    // Audio thread: asks for chunks [first, last] to be paged in, or kept.
+    void request(int first, int last) noexcept;
+    // Read-ahead thread: pages in wanted chunks, and on a sweep lets go of
+    // those no voice has read for a while.
+    void service(bool sweep);
+
+    const SampleData& owner;
+    const int numChunks;
+    std::unique_ptr<std::atomic<ChunkState>[]> states;
+    std::vector<bool> locked; // read-ahead thread only
+    std::atomic<bool> pending { false };
+    juce::SharedResourcePointer<ReadAhead> readAhead;
+
+private:
+    const char* getChunkBytes(const char* samples, int channel, int chunk, size_t& bytes) const noexcept;
+};
+
+void SampleData::ReadAhead::run()
+{
+    for (int poll = 0; !threadShouldExit(); ++poll)
+    {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            const bool sweep = poll % kSweepPolls == 0;
+            for (auto* stream : streams)
+                stream->service(sweep);
+        }
+
+        wait(kReadAheadPollMs);
+    }
+}
+
+SampleData::Streaming::Streaming(const SampleData& data, int chunks)
+    : owner(data)
+    , numChunks(chunks)
+    , states(new std::atomic<ChunkState>[static_cast<size_t>(chunks)])
+    , locked(static_cast<size_t>(chunks), false)
+{
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+        states[static_cast<size_t>(chunk)].store(ChunkState::cold, std::memory_order_relaxed);
+
+    readAhead->add(*this);
+}
+
+SampleData::Streaming::~Streaming()
+{
+    readAhead->remove(*this);
+}
+
+bool SampleData::Streaming::isResident(int chunk) noexcept
+{
+    auto& state = states[static_cast<size_t>(chunk)];
+    auto current = state.load(std::memory_order_acquire);
+    while (current == ChunkState::resident || current == ChunkState::draining)
+    {
+        if (state.compare_exchange_weak(current, ChunkState::used, std::memory_order_acq_rel))
+            return true;
+    }
+
+    return current == ChunkState::used;
+}
+
+void SampleData::Streaming::request(int first, int last) noexcept
+{
+    bool wanted = false;
+    for (int chunk = first; chunk <= last; ++chunk)
+    {
+        auto& state = states[static_cast<size_t>(chunk)];
+        auto current = state.load(std::memory_order_acquire);
+
+        if (current == ChunkState::cold)
+            wanted = state.compare_exchange_strong(current, ChunkState::wanted, std::memory_order_acq_rel) || wanted;
+
+        // Chunks already in are kept until the voice gets there.
+        if (current == ChunkState::resident || current == ChunkState::draining)
+            state.compare_exchange_strong(current, ChunkState::used, std::memory_order_acq_rel);
+    }
+
+    if (wanted)
+        pending.store(true, std::memory_order_release);
+}
+
+const char* SampleData::Streaming::getChunkBytes(const char* samples, int channel, int chunk, size_t& bytes) const noexcept
+{
+    const int start = chunk * kStreamChunkFrames;
+    const int frames = juce::jmin(kStreamChunkFrames, owner.numFrames + kGuardFrames - start);
+    bytes = static_cast<size_t>(frames) * owner.getBytesPerSample();
+    return samples + owner.getChannelStride() * static_cast<size_t>(channel)
+         + static_cast<size_t>(start) * owner.getBytesPerSample();
+}
+
+void SampleData::Streaming::service(bool sweep)
+{
+    if (!pending.exchange(false, std::memory_order_acquire) && !sweep)
+        return;
+
+    const auto storage = owner.retainStorage();
+    const auto* samples = owner.getRawBytes();
+
+    const auto lock = [&](int chunk)
+    {
+        bool all = true;
+        for (int channel = 0; channel < owner.numChannels; ++channel)
+        {
+            size_t bytes = 0;
+            const auto* begin = getChunkBytes(samples, channel, chunk, bytes);
+            all = lockPages(begin, bytes) && all;
+        }
+
+        return all;
+    };
+
+    const auto unlock = [&](int chunk)
+    {
+        for (int channel = 0; channel < owner.numChannels; ++channel)
+        {
+            size_t bytes = 0;
+            const auto* begin = getChunkBytes(samples, channel, chunk, bytes);
+            unlockPages(begin, bytes);
+        }
+    };
+
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+    {
+        auto& state = states[static_cast<size_t>(chunk)];
+        auto current = state.load(std::memory_order_acquire);
+
+        if (current == ChunkState::wanted)
+        {
+            if (!locked[static_cast<size_t>(chunk)])
+                locked[static_cast<size_t>(chunk)] = lock(chunk);
+
+            state.store(ChunkState::resident, std::memory_order_release);
+        }
+        else if (sweep && current == ChunkState::used)
+        {
+            state.compare_exchange_strong(current, ChunkState::resident, std::memory_order_acq_rel);
+        }
+        else if (sweep && current == ChunkState::resident)
+        {
+            state.compare_exchange_strong(current, ChunkState::draining, std::memory_order_acq_rel);
+        }
+        else if (sweep && current == ChunkState::draining)
+        {
+            // Readers that saw it resident finished a sweep ago.
+            if (state.compare_exchange_strong(current, ChunkState::cold, std::memory_order_acq_rel)
+                && locked[static_cast<size_t>(chunk)])
+            {
+                unlock(chunk);
+                locked[static_cast<size_t>(chunk)] = false;
+            }
+        }
+    }
+}
+
+//==============================================================================
+SampleData::SampleData(int channels, int frames, double rate, Format storageFormat)
+    : numChannels(channels)
+    , numFrames(frames)
+    , sampleRate(rate)
+    , format(storageFormat)
+{
+    auto owned = std::make_shared<Storage>();
+    owned->heap.allocate(getChannelStride() * static_cast<size_t>(numChannels), true);
+    owned->samples = owned->heap.get();
+    live = owned.get();
+    storage = std::move(owned);
+}
+
+SampleData::SampleData(int channels, int frames, double rate, Format storageFormat,
+                       std::shared_ptr<const juce::MemoryMappedFile> file, size_t offset)
+    : numChannels(channels)
+    , numFrames(frames)
+    , sampleRate(rate)
+    , format(storageFormat)
+{
+    auto owned = std::make_shared<Storage>();
+    owned->mapping = std::move(file);
+    owned->samples = static_cast<const char*>(owned->mapping->getData()) + offset;
+    live = owned.get();
+    storage = std::move(owned);
+
+    streaming = std::make_unique<Streaming>(*this, (numFrames + kStreamChunkFrames - 1) / kStreamChunkFrames);
+    mapped = true;
+}
+
+SampleData::~SampleData() = default;
+
+std::shared_ptr<const SampleData> SampleData::fromReader(juce::AudioFormatReader& reader,
+                                                         double maxLengthSeconds,
+                                                         Format format)
+{
+    const auto maxFrames = static_cast<juce::int64>(maxLengthSeconds * reader.sampleRate);
+    const int frames = static_cast<int>(juce::jmin(reader.lengthInSamples, maxFrames));
+    const int channels = juce::jmin(2, static_cast<int>(reader.numChannels));
+    if (frames <= 0 || channels <= 0 || reader.sampleRate <= 0.0)
+        return {};
+
+    std::shared_ptr<SampleData> result(new SampleData(channels, frames, reader.sampleRate, format));
+
+    // Read through a small float window so compact pads never hold a
+    // full-length float copy, even while loading.
+    juce::AudioBuffer<float> chunk(channels, juce::jmin(kLoadChunkFrames, frames));
+    for (int start = 0; start < frames; start += kLoadChunkFrames)
+    {
+        const int count = juce::jmin(kLoadChunkFrames, frames - start);
+        reader.read(&chunk, 0, count, start, true, true);
+
+        for (int ch = 0; ch < channels; ++ch)
+            result->encode(ch, start, count, chunk.getReadPointer(ch));
+    }
+
+    return result;
+}
+
+std::shared_ptr<const SampleData> SampleData::fromBuffer(const juce::AudioBuffer<float>& buffer,
+                                                         int numFrames,
+                                                         double rate,
+                                                         Format format)
+{
+    const int frames = juce::jmin(numFrames, buffer.getNumSamples());
+    const int channels = juce::jmin(2, buffer.getNumChannels());
+    if (frames <= 0 || channels <= 0 || rate <= 0.0)
+        return {};
+
+    std::shared_ptr<SampleData> result(new SampleData(channels, frames, rate, format));
+    for (int ch = 0; ch < channels; ++ch)
+        result->encode(ch, 0, frames, buffer.getReadPointer(ch));
+
+    return result;
+}
+
+std::shared_ptr<const SampleData> SampleData::convert(const std::shared_ptr<const SampleData>& source,
+                                                      Format newFormat)
+{
+    if (source == nullptr || source->format == newFormat)
+        return source;
+
+    std::shared_ptr<SampleData> result(new SampleData(source->numChannels,
+                                                      source->numFrames,
+                                                      source->sampleRate,
+                                                      newFormat));
+
+    std::array<float, 1024> window;
+    const int windowFrames = static_cast<int>(window.size());
+    for (int ch = 0; ch < source->numChannels; ++ch)
+    {
+        for (int start = 0; start < source->numFrames; start += windowFrames)
+        {
+            const int count = juce::jmin(windowFrames, source->numFrames - start);
+            source->decode(ch, start, count, window.data());
+            result->encode(ch, start, count, window.data());
+        }
+    }
+
+    return result;
+}
+
+std::shared_ptr<const SampleData> SampleData::fromMappedFile(std::shared_ptr<const juce::MemoryMappedFile> file,
+                                                             size_t offset,
+                                                             int channels,
+                                                             int frames,
+                                                             double rate,
+                                                             Format format)
+{
+    if (file == nullptr || file->getData() == nullptr || channels <= 0 || channels > 2 || frames <= 0 || rate <= 0.0)
+        return {};
+
+    const auto bytes = getMemoryBytes(channels, frames, format);
+    if (offset % alignof(float) != 0 || offset > file->getSize() || bytes > file->getSize() - offset)
+        return {};
+
+    return std::shared_ptr<const SampleData>(new SampleData(channels, frames, rate, format, std::move(file), offset));
+}
+
+std::shared_ptr<const void> SampleData::moveToTemporaryFile(const juce::File& directory,
+                                                            const std::vector<int>& playbackStarts) const
+{
+    if (isMapped() || !directory.createDirectory())
+        return {};
+
+    const auto file = directory.getNonexistentChildFile("layer", ".raw", false);
+    bool written = false;
+    {
+        juce::FileOutputStream out(file);
+        written = out.openedOk() && out.write(getRawBytes(), getMemoryBytes());
+        out.flush();
+        written = written && !out.getStatus().failed();
+    }
+
+    if (!written)
+    {
+        file.deleteFile();
+        return {};
+    }
+
+    // Unmapped before the file is deleted, which Windows requires.
+    auto replacement = std::make_shared<Storage>();
+    replacement->mapping.reset(new juce::MemoryMappedFile(file, juce::MemoryMappedFile::readOnly, false),
+                               [file](const juce::MemoryMappedFile* mapping)
+                               {
+                                   delete mapping;
+                                   file.deleteFile();
+                               });
+
+    replacement->samples = static_cast<const char*>(replacement->mapping->getData());
+    if (replacement->samples == nullptr || replacement->mapping->getSize() < getMemoryBytes())
+        return {};
+
+    // Heads come from the heap copy, which is still resident.
+    addHeads(*replacement, playbackStarts, getRawBytes());
+    streaming = std::make_unique<Streaming>(*this, (numFrames + kStreamChunkFrames - 1) / kStreamChunkFrames);
+    return replaceStorage(std::move(replacement));
+}
+
+std::shared_ptr<const void> SampleData::setPlaybackStarts(std::vector<int> starts) const
+{
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+    const auto current = std::static_pointer_cast<const Storage>(retainStorage());
+    if (current->mapping == nullptr || current->playbackStarts == starts)
+        return {};
+
+    auto replacement = std::make_shared<Storage>();
+    replacement->mapping = current->mapping;
+    replacement->samples = current->samples;
+    addHeads(*replacement, std::move(starts), current->samples);
+    return replaceStorage(std::move(replacement));
+}
+
+std::shared_ptr<const void> SampleData::retainStorage() const
+{
+    const juce::SpinLock::ScopedLockType lock(storageLock);
+    return storage;
+}
+
+std::shared_ptr<const void> SampleData::replaceStorage(std::shared_ptr<const Storage> replacement) const
+{
+    const juce::SpinLock::ScopedLockType lock(storageLock);
+    auto previous = std::exchange(storage, std::move(replacement));
+    live.store(storage.get(), std::memory_order_release);
+    mapped.store(storage->mapping != nullptr, std::memory_order_release);
+    return previous;
+}
+
+void SampleData::addHeads(Storage& target, std::vector<int> starts, const char* source) const
+{
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+    target.playbackStarts = starts;
+
+    // Each head reaches kSincHalfTaps either side, for the sinc kernel, and
+    // overlapping heads are merged so they don't share frames.
+    const int headFrames = static_cast<int>(kHeadSeconds * sampleRate);
+    std::vector<juce::Range<int>> ranges;
+    for (const int start : starts)
+    {
+        const juce::Range<int> range(juce::jmax(0, start - kSincHalfTaps),
+                                     juce::jmin(numFrames, start + headFrames + kSincHalfTaps));
+        if (range.isEmpty())
+            continue;
+
+        if (!ranges.empty() && range.getStart() <= ranges.back().getEnd())
+            ranges.back() = ranges.back().getUnionWith(range);
+        else
+            ranges.push_back(range);
+    }
+
+    const auto bytesPerSample = getBytesPerSample();
+    for (const auto& range : ranges)
+    {
+        Head head;
+        head.start = range.getStart();
+        head.frames = range.getLength();
+
+        const auto channelBytes = static_cast<size_t>(head.frames) * bytesPerSample;
+        head.bytes.allocate(channelBytes * static_cast<size_t>(numChannels), false);
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            std::memcpy(head.bytes.get() + channelBytes * static_cast<size_t>(channel),
+                        source + getChannelStride() * static_cast<size_t>(channel) + static_cast<size_t>(head.start) * bytesPerSample,
+                        channelBytes);
+        }
+
+        target.heads.push_back(std::move(head));
+    }
+}
+
+size_t SampleData::getMemoryBytes(int channels, int frames, Format format) noexcept
+{
+    const size_t bytesPerSample = format == Format::int16 ? sizeof(juce::int16) : sizeof(float);
+    return static_cast<size_t>(frames + kGuardFrames) * bytesPerSample * static_cast<size_t>(channels);
+}
+
+size_t SampleData::getBytesPerSample() const noexcept
+{
+    return format == Format::int16 ? sizeof(juce::int16) : sizeof(float);
+}
+
+size_t SampleData::getChannelStride() const noexcept
+{
+    return static_cast<size_t>(numFrames + kGuardFrames) * getBytesPerSample();
+}
+
+size_t SampleData::getMemoryBytes() const noexcept
+{
+    return getChannelStride() * static_cast<size_t>(numChannels);
+}
+
+const char* SampleData::getChannelBytes(int channel) const noexcept
+{
+    return getRawBytes() + getChannelStride() * static_cast<size_t>(channel);
+}
+
+char* SampleData::getChannelBytes(int channel) noexcept
+{
+    // Only used while building new data, which is always on the heap.
+    return const_cast<char*>(std::as_const(*this).getChannelBytes(channel));
+}
+
+const float* SampleData::getFloatChannel(int channel) const noexcept
+{
+    if (format != Format::float32 || isMapped())
+        return nullptr;
+
+    return reinterpret_cast<const float*>(getChannelBytes(channel));
+}
+
+void SampleData::encode(int channel, int startFrame, int count, const float* source) noexcept
+{
+    if (format == Format::float32)
+    {
+        auto* dest = reinterpret_cast<float*>(getChannelBytes(channel)) + startFrame;
+        juce::FloatVectorOperations::copy(dest, source, count);
+        return;
+    }
+
+    auto* dest = reinterpret_cast<juce::int16*>(getChannelBytes(channel)) + startFrame;
+    for (int i = 0; i < count; ++i)
+        dest[i] = static_cast<juce::int16>(juce::roundToInt(juce::jlimit(-1.0f, 1.0f, source[i]) * kInt16Scale));
+}
+
+void SampleData::decodeBytes(const char* channelBytes, int startFrame, int count, float* dest) const noexcept
+{
+    if (format == Format::float32)
+    {
+        juce::FloatVectorOperations::copy(dest, reinterpret_cast<const float*>(channelBytes) + startFrame, count);
+        return;
+    }
+
+    // Plain counted loop with no aliasing so the compiler emits packed
+    // int->float conversions for it.
+    const auto* src = reinterpret_cast<const juce::int16*>(channelBytes) + startFrame;
+    constexpr float scale = 1.0f / kInt16Scale;
+    for (int i = 0; i < count; ++i)
+        dest[i] = static_cast<float>(src[i]) * scale;
+}
+
+void SampleData::decode(int channel, int startFrame, int count, float* dest) const noexcept
+{
+    const int available = juce::jlimit(0, count, numFrames - startFrame);
+    decodeBytes(getChannelBytes(channel), startFrame, available, dest);
+
+    if (available < count)
+        juce::FloatVectorOperations::clear(dest + available, count - available);
+}
+
+void SampleData::decodeForPlayback(int channel, int startFrame, int count, float* dest) const noexcept
+{
+    if (!isMapped())
+    {
+        decode(channel, startFrame, count, dest);
+        return;
+    }
+
+    const auto& current = *live.load(std::memory_order_acquire);
+    const auto& heads = current.heads;
+    const int available = juce::jlimit(0, count, numFrames - startFrame);
+
+    if (available > 0)
+    {
+        const auto readAheadFrames = static_cast<int>(kReadAheadSeconds * sampleRate);
+        streaming->request(startFrame / kStreamChunkFrames,
+                           juce::jmin(streaming->numChunks - 1, (startFrame + readAheadFrames) / kStreamChunkFrames));
+    }
+
+    for (int done = 0; done < available;)
+    {
+        const int frame = startFrame + done;
+        int length = available - done;
+
+        // Heads are disjoint and sorted, so only the last starting at or
+        // before frame can hold it.
+        const auto next = std::upper_bound(heads.begin(), heads.end(), frame, [](int f, const Head& head)
+        {
+            return f < head.start;
+        });
+
+        if (next != heads.begin() && frame < std::prev(next)->start + std::prev(next)->frames)
+        {
+            const auto& head = *std::prev(next);
+            length = juce::jmin(length, head.start + head.frames - frame);
+            decodeBytes(head.bytes.get() + static_cast<size_t>(head.frames) * getBytesPerSample() * static_cast<size_t>(channel),
+                        frame - head.start,
+                        length,
+                        dest + done);
+        }
+        else
+        {
+            const int chunk = frame / kStreamChunkFrames;
+            length = juce::jmin(length, (chunk + 1) * kStreamChunkFrames - frame);
+            if (next != heads.end())
+                length = juce::jmin(length, next->start - frame);
+
+            if (streaming->isResident(chunk))
+                decodeBytes(current.samples + getChannelStride() * static_cast<size_t>(channel), frame, length, dest + done);
+            else
+                juce::FloatVectorOperations::clear(dest + done, length);
+        }
+
+        done += length;
+    }
+
+    if (available < count)
+        juce::FloatVectorOperations::clear(dest + available, count - available);
+}
+
+float SampleData::touchPages() const noexcept
+{
+    float sink = 0.0f;
+    const auto* bytes = getRawBytes();
+    const auto totalBytes = getMemoryBytes();
+    for (size_t offset = 0; offset < totalBytes; offset += kPageBytes)
+        sink += static_cast<float>(bytes[offset]);
+
+    return sink;
+}
+
+//==============================================================================
+PadSound::PadSound(const juce::String& soundName,
+                   std::shared_ptr<const SampleData> sampleData,
+                   int pad,
+                   int rootNote,
+                   juce::Range<int> frames)
+    : PadSound(soundName, { Layer { std::move(sampleData), frames, 127 } }, pad, rootNote, Cycle::roundRobin)
+{
+}
+
+PadSound::PadSound(const juce::String& soundName,
+                   std::vector<Layer> soundLayers,
+                   int pad,
+                   int rootNote,
+                   Cycle cycleMode)
+    : name(soundName)
+    , layers(std::move(soundLayers))
+    , lastUse(new std::atomic<juce::uint32>[juce::jmax<size_t>(1, layers.size())]())
+    , cycle(cycleMode)
+    , padIndex(pad)
+    , midiRootNote(rootNote)
+{
+    jassert(!layers.empty());
+
+    const auto now = juce::Time::getMillisecondCounter();
+    for (size_t i = 0; i < layers.size(); ++i)
+        lastUse[i].store(now, std::memory_order_relaxed);
+
+    // Stable, so round-robin order within a zone is the order layers were added.
+    std::stable_sort(layers.begin(), layers.end(), [](const Layer& a, const Layer& b)
+    {
+        return a.topVelocity < b.topVelocity;
+    });
+
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+        auto& layer = layers[i];
+        jassert(layer.data != nullptr);
+
+        const juce::Range<int> wholeSample(0, layer.data->getNumFrames());
+        layer.region = layer.region.isEmpty() ? wholeSample : wholeSample.getIntersectionWith(layer.region);
+        layer.topVelocity = juce::jlimit(0, 127, layer.topVelocity);
+
+        if (zones.empty() || layers[i - 1].topVelocity != layer.topVelocity)
+            zones.push_back({ static_cast<int>(i), 0, 0 });
+
+        ++zones.back().numLayers;
+    }
+
+    // Velocities above the loudest zone's top play that zone.
+    size_t zone = 0;
+    for (int velocity = 0; velocity < static_cast<int>(zoneForVelocity.size()); ++velocity)
+    {
+        while (zone + 1 < zones.size() && velocity > layers[static_cast<size_t>(zones[zone].firstLayer)].topVelocity)
+            ++zone;
+
+        zoneForVelocity[static_cast<size_t>(velocity)] = static_cast<juce::uint8>(zone);
+    }
+}
+
+const PadSound::Layer& PadSound::selectLayer(float velocity) noexcept
+{
+    const int midiVelocity = juce::jlimit(0, 127, juce::roundToInt(velocity * 127.0f));
+    auto& zone = zones[zoneForVelocity[static_cast<size_t>(midiVelocity)]];
+
+    int index = 0;
+    if (zone.numLayers > 1)
+    {
+        index = cycle == Cycle::random ? random.nextInt(zone.numLayers) : zone.next;
+        zone.next = (index + 1) % zone.numLayers;
+    }
+
+    const auto layer = static_cast<size_t>(zone.firstLayer + index);
+    setLastUse(layer, juce::Time::getMillisecondCounter());
+    return layers[layer];
+}
+
+//==============================================================================
+bool PadVoice::canPlaySound(juce::SynthesiserSound* sound)
+{
+    return dynamic_cast<const PadSound*>(sound) != nullptr;
+}
+
+void PadVoice::startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound* s, int)
+{
+    if (auto* sound = dynamic_cast<PadSound*>(s))
+    {
+        const auto& layer = sound->selectLayer(velocity);
+        data = layer.data.get();
+        auto region = layer.region;
+        double speed = 1.0;
+
+        // Loop pads play the stretch rendered nearest the tempo and make up
+        // the rest by varispeed, which is all they do until the first render.
+        if (sound->getLoopSteps() > 0 && tempo > 0.0)
+        {
+            const auto* stretch = sound->getStretch();
+            const auto index = static_cast<size_t>(&layer - sound->getLayers().data());
+            if (stretch != nullptr && index < stretch->layers.size())
+            {
+                data = stretch->layers[index].get();
+                region = { 0, data->getNumFrames() };
+            }
+
+            const double loopFrames = sound->getLoopSteps() * 15.0 / tempo * data->getSampleRate();
+            speed = region.getLength() / loopFrames;
+            if (std::abs(speed - 1.0) < kUnitSpeedTolerance)
+                speed = 1.0;
+        }
+
+        pitchRatio = std::pow(2.0, (midiNoteNumber - sound->getMidiRootNote()) / 12.0)
+            * speed * data->getSampleRate() / getSampleRate();
+
+        sourceSamplePosition = region.getStart();
+        endPosition = region.getEnd();
+
+        // Only slices fade at their end; a whole sample ends in its own tail.
+        const bool isSlice = region.getEnd() < data->getNumFrames();
+        fadeLength = juce::jmax(1.0, kRegionFadeSeconds * data->getSampleRate());
+        fadeStartPosition = isSlice ? endPosition - fadeLength : endPosition;
+
+        gain = velocity;
+        currentPad = sound->getPadIndex();
+
+        // Until the first render, assume the new note is as loud as it was hit
+        // so it is not mistaken for the quietest voice.
+        currentLevel = velocity;
+        fadingOut = false;
+        released = false;
+
+        envelope = sound->getEnvelopeParameters();
+        adsr.setSampleRate(getSampleRate());
+        adsr.setParameters(envelope);
+        adsr.noteOn();
+    }
+    else
+    {
+        jassertfalse; // this voice only plays PadSounds
+    }
+}
+
+void PadVoice::stopNote(float, bool allowTailOff)
+{
+    if (allowTailOff)
+    {
+        released = true;
+        adsr.noteOff();
+    }
+    else
+    {
+        clearCurrentNote();
+        adsr.reset();
+    }
+}
+
+int PadVoice::getPadIndex() const noexcept
+{
+    return isVoiceActive() ? currentPad : -1;
+}
+
+void PadVoice::fadeOut()
+{
+    if (!isVoiceActive() || fadingOut)
+        return;
+
+    fadingOut = true;
+    released = true;
+
+    auto fast = envelope;
+    fast.release = kFadeOutSeconds;
+    adsr.setParameters(fast);
+    adsr.noteOff();
+}
+
+void PadVoice::decodeWindow(const SampleData& source, int channel, int firstFrame, float* dest) noexcept
+{
+    // Frames before the sample start read as silence, as decode() does past its end.
+    const int before = juce::jlimit(0, kDecodeFrames, -firstFrame);
+    juce::FloatVectorOperations::clear(dest, before);
+
+    if (before < kDecodeFrames)
+        source.decodeForPlayback(channel, firstFrame + before, kDecodeFrames - before, dest + before);
+}
+
+void PadVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    if (getCurrentlyPlayingSound() == nullptr || data == nullptr)
+        return;
+
+    const auto& source = *data;
+    const bool stereoSource = source.getNumChannels() > 1;
+
+    float* outL = outputBuffer.getWritePointer(0, startSample);
+    float* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+
+    // Each pass decodes one window of source frames and renders as many
+    // output samples as that window covers, keeping one frame for linear
+    // interpolation. The sinc kernel reaches further, so high-quality windows
+    // keep kSincHalfTaps frames of margin at both ends and are always decoded,
+    // which pads frames outside the sample with silence.
+    const int margin = highQuality ? kSincHalfTaps : 0;
+    const int samplesPerWindow = juce::jmax(1, static_cast<int>((kDecodeFrames - 2 - 2 * margin) / pitchRatio));
+
+    while (numSamples > 0)
+    {
+        const int windowStart = static_cast<int>(sourceSamplePosition) - margin;
+        const int chunk = juce::jmin(numSamples, samplesPerWindow);
+
+        const float* inL = highQuality ? nullptr : source.getFloatChannel(0);
+        const float* inR = stereoSource && !highQuality ? source.getFloatChannel(1) : nullptr;
+
+        if (inL != nullptr)
+        {
+            inL += windowStart;
+            if (inR != nullptr)
+                inR += windowStart;
+        }
+        else
+        {
+            decodeWindow(source, 0, windowStart, decodeBuffer[0].data());
+            inL = decodeBuffer[0].data();
+
+            if (stereoSource)
+            {
+                decodeWindow(source, 1, windowStart, decodeBuffer[1].data());
+                inR = decodeBuffer[1].data();
+            }
+        }
+
+        float peak = 0.0f;
+        float envelopeValue = 0.0f;
+
+        for (int i = 0; i < chunk; ++i)
+        {
+            const double local = sourceSamplePosition - windowStart;
+            const int pos = static_cast<int>(local);
+            const float alpha = static_cast<float>(local - pos);
+
+            float l = 0.0f;
+            float r = 0.0f;
+
+            if (highQuality)
+            {
+                l = interpolateSinc(inL, pos, alpha);
+                r = (inR != nullptr) ? interpolateSinc(inR, pos, alpha) : l;
+            }
+            else
+            {
+                const float invAlpha = 1.0f - alpha;
+                l = inL[pos] * invAlpha + inL[pos + 1] * alpha;
+                r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
+            }
+
+            envelopeValue = adsr.getNextSample() * gain;
+
+            if (sourceSamplePosition > fadeStartPosition)
+                envelopeValue *= static_cast<float>(juce::jmax(0.0, (endPosition - sourceSamplePosition) / fadeLength));
+
+            l *= envelopeValue;
+            r *= envelopeValue;
+            peak = juce::jmax(peak, std::abs(l), std::abs(r));
+
+            if (outR != nullptr)
+            {
+                *outL++ += l;
+                *outR++ += r;
+            }
+            else
+            {
+                *outL++ += (l + r) * 0.5f;
+            }
+
+            sourceSamplePosition += pitchRatio;
+
+            if (sourceSamplePosition > endPosition)
+            {
+                stopNote(0.0f, false);
+                return;
+            }
+        }
+
+        numSamples -= chunk;
+        currentLevel = peak;
+
+        // End voices once their envelope can no longer be heard. Quiet sample
+        // content doesn't end a voice: loops and slices can have long gaps
+        // between hits, and the voice ends at the sample's end anyway.
+        const bool envelopeInaudible = released && envelopeValue < kSilenceThreshold;
+
+        if (!adsr.isActive() || envelopeInaudible)
+        {
+            clearCurrentNote();
+            adsr.reset();
+            return;
+        }
+    }
+}
+
+//==============================================================================
+PadSynth::PadSynth()
+{
+    for (auto& polyphony : padPolyphony)
+        polyphony.store(kDefaultPadPolyphony);
+
+    for (auto& group : padChokeGroup)
+        group.store(0);
+}
+
+void PadSynth::setPadPolyphony(int pad, int maxVoices)
+{
+    if (pad < 0 || pad >= Sequencer::kPads)
+        return;
+
+    padPolyphony[static_cast<size_t>(pad)].store(juce::jmax(1, maxVoices), std::memory_order_relaxed);
+}
+
+void PadSynth::setPadChokeGroup(int pad, int group)
+{
+    if (pad < 0 || pad >= Sequencer::kPads)
+        return;
+
+    padChokeGroup[static_cast<size_t>(pad)].store(juce::jmax(0, group), std::memory_order_relaxed);
+}
+
+void PadSynth::prepare(double sampleRate, int maxBlockSize)
+{
+    for (auto& buffer : padBuffers)
+        buffer.setSize(2, maxBlockSize, false, true, false);
+
+    for (auto& chain : inserts)
+        chain.prepare(sampleRate, maxBlockSize);
+
+    padRendered.fill(false);
+    lastGains.fill({});
+    // The pool keeps growing after prepare, and grouping runs on the audio thread.
+    groupedVoices.reserve(static_cast<size_t>(kMaxVoices));
+}
+
+void PadSynth::beginBlock(int numSamples, bool highQuality, double bpm)
+{
+    for (auto* voice : voices)
+    {
+        auto* padVoice = static_cast<PadVoice*>(voice);
+        padVoice->setHighQuality(highQuality);
+        padVoice->setTempo(bpm);
+    }
+
+    // The processor splits oversized host blocks, so this never reallocates.
+    jassert(numSamples <= padBuffers[0].getNumSamples());
+    blockSamples = juce::jmin(numSamples, padBuffers[0].getNumSamples());
+    padRendered.fill(false);
+}
+
+bool PadSynth::isIdle() const noexcept
+{
+    for (const auto* voice : voices)
+        if (voice->isVoiceActive())
+            return false;
+
+    for (const auto& chain : inserts)
+        if (chain.isTailActive())
+            return false;
+
+    return true;
+}
+
+void PadSynth::renderVoices(juce::AudioBuffer<float>&, int startSample, int numSamples)
+{
+    if (renderPool != nullptr)
+    {
+        renderVoicesInParallel(startSample, numSamples);
+        return;
+    }
+
+    for (auto* v : voices)
+    {
+        auto* voice = static_cast<PadVoice*>(v);
+        const int pad = voice->getPadIndex();
+        if (pad < 0)
+            continue;
+
+        auto& padBuffer = padBuffers[static_cast<size_t>(pad)];
+        if (!padRendered[static_cast<size_t>(pad)])
+        {
+            padBuffer.clear(0, blockSamples);
+            padRendered[static_cast<size_t>(pad)] = true;
+        }
+
+        voice->renderNextBlock(padBuffer, startSample, numSamples);
+    }
+}
+
+void PadSynth::renderVoicesInParallel(int startSample, int numSamples)
+{
+    // Grouping keeps each pad's voices in voice order, the order the serial
+    // path adds them in. Growing the list allocates, which is fine offline.
+    groupedVoices.clear();
+    int numActive = 0;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        padVoiceStart[static_cast<size_t>(pad)] = static_cast<int>(groupedVoices.size());
+
+        for (auto* v : voices)
+        {
+            auto* voice = static_cast<PadVoice*>(v);
+            if (voice->getPadIndex() == pad)
+                groupedVoices.push_back(voice);
+        }
+
+        if (static_cast<int>(groupedVoices.size()) == padVoiceStart[static_cast<size_t>(pad)])
+            continue;
+
+        if (!padRendered[static_cast<size_t>(pad)])
+        {
+            padBuffers[static_cast<size_t>(pad)].clear(0, blockSamples);
+            padRendered[static_cast<size_t>(pad)] = true;
+        }
+
+        activePads[static_cast<size_t>(numActive++)] = pad;
+    }
+
+    padVoiceStart.back() = static_cast<int>(groupedVoices.size());
+
+    renderPool->run(numActive, [this, startSample, numSamples](int job)
+    {
+        const auto pad = static_cast<size_t>(activePads[static_cast<size_t>(job)]);
+        for (int i = padVoiceStart[pad]; i < padVoiceStart[pad + 1]; ++i)
+            groupedVoices[static_cast<size_t>(i)]->renderNextBlock(padBuffers[pad], startSample, numSamples);
+    });
+}
+
+PadSynth::SendActivity PadSynth::mixPads(juce::AudioBuffer<float>& output,
+                                         const SendBuses& sends,
+                                         const std::array<PadChannel, Sequencer::kPads>& channels)
+{
+    const int numSamples = juce::jmin(blockSamples, output.getNumSamples());
+    SendActivity activity{};
+
+    std::array<PadGains, Sequencer::kPads> previousGains;
+    std::array<std::array<PadGains, kNumSends>, Sequencer::kPads> previousSendGains;
+    int numActive = 0;
+
+    for (size_t pad = 0; pad < padBuffers.size(); ++pad)
+    {
+        const auto& channel = channels[pad];
+        const auto target = channel.gains;
+        previousGains[pad] = lastGains[pad];
+        lastGains[pad] = target;
+
+        // Sends are post-fader: they follow the pad's level, pan and mute.
+        previousSendGains[pad] = lastSendGains[pad];
+        for (size_t send = 0; send < kNumSends; ++send)
+            lastSendGains[pad][send] = { target.left * channel.sends[send], target.right * channel.sends[send] };
+
+        // Pads with no voices and no effect tail left cost nothing here.
+        if (!padRendered[pad])
+        {
+            if (!inserts[pad].isTailActive())
+                continue;
+
+            padBuffers[pad].clear(0, numSamples);
+        }
+
+        activePads[static_cast<size_t>(numActive++)] = static_cast<int>(pad);
+    }
+
+    const auto processInserts = [this, &channels, numSamples](int job)
+    {
+        const auto pad = static_cast<size_t>(activePads[static_cast<size_t>(job)]);
+        inserts[pad].process(padBuffers[pad], numSamples, channels[pad].inserts, padRendered[pad]);
+    };
+
+    if (renderPool != nullptr)
+    {
+        renderPool->run(numActive, processInserts);
+    }
+    else
+    {
+        for (int job = 0; job < numActive; ++job)
+            processInserts(job);
+    }
+
+    // Summed in pad order, whichever thread processed each pad.
+    for (int job = 0; job < numActive; ++job)
+    {
+        const auto pad = static_cast<size_t>(activePads[static_cast<size_t>(job)]);
+        const auto& padBuffer = padBuffers[pad];
+
+        addPad(output, padBuffer, numSamples, previousGains[pad], lastGains[pad]);
+
+        for (size_t send = 0; send < kNumSends; ++send)
+        {
+            if (sends[send] != nullptr
+                && addPad(*sends[send], padBuffer, numSamples, previousSendGains[pad][send], lastSendGains[pad][send]))
+                activity[send] = true;
+        }
+    }
+
+    return activity;
+}
+
+bool PadSynth::addPad(juce::AudioBuffer<float>& destination,
+                      const juce::AudioBuffer<float>& padBuffer,
+                      int numSamples,
+                      PadGains previous,
+                      PadGains target)
+{
+    if (target.left == 0.0f && target.right == 0.0f && previous.left == 0.0f && previous.right == 0.0f)
+        return false;
+
+    if (destination.getNumChannels() > 1)
+    {
+        destination.addFromWithRamp(0, 0, padBuffer.getReadPointer(0), numSamples, previous.left, target.left);
+        destination.addFromWithRamp(1, 0, padBuffer.getReadPointer(1), numSamples, previous.right, target.right);
+    }
+    else
+    {
+        destination.addFromWithRamp(0, 0, padBuffer.getReadPointer(0), numSamples, previous.left * 0.5f, target.left * 0.5f);
+        destination.addFromWithRamp(0, 0, padBuffer.getReadPointer(1), numSamples, previous.right * 0.5f, target.right * 0.5f);
+    }
+
+    return true;
+}
+
+void PadSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto* sound : sounds)
+    {
+        if (!sound->appliesToNote(midiNoteNumber) || !sound->appliesToChannel(midiChannel))
+            continue;
+
+        const int pad = static_cast<PadSound*>(sound)->getPadIndex();
+        if (pad < 0 || pad >= Sequencer::kPads)
+            continue;
+
+        const int chokeGroup = padChokeGroup[static_cast<size_t>(pad)].load(std::memory_order_relaxed);
+        const int maxVoices = padPolyphony[static_cast<size_t>(pad)].load(std::memory_order_relaxed);
+
+        int padVoices = 0;
+        int freeVoices = 0;
+
+        for (auto* v : voices)
+        {
+            auto* voice = static_cast<PadVoice*>(v);
+            const int voicePad = voice->getPadIndex();
+
+            if (voicePad < 0)
+            {
+                ++freeVoices;
+                continue;
+            }
+
+            if (voice->isFadingOut())
+                continue;
+
+            if (voicePad == pad)
+                ++padVoices;
+            else if (chokeGroup > 0
+                     && padChokeGroup[static_cast<size_t>(voicePad)].load(std::memory_order_relaxed) == chokeGroup)
+                voice->fadeOut();
+        }
+
+        for (; padVoices >= maxVoices; --padVoices)
+            fadeQuietest(pad);
+
+        if (freeVoices <= kFreeVoiceReserve)
+        {
+            voicePressure.store(true, std::memory_order_relaxed);
+            fadeQuietest(-1);
+        }
+
+        startVoice(findFreeVoice(sound, midiChannel, midiNoteNumber, isNoteStealingEnabled()),
+                   sound,
+                   midiChannel,
+                   midiNoteNumber,
+                   velocity);
+    }
+}
+
+void PadSynth::fadeQuietest(int pad)
+{
+    PadVoice* quietest = nullptr;
+
+    for (auto* v : voices)
+    {
+        auto* voice = static_cast<PadVoice*>(v);
+        const int voicePad = voice->getPadIndex();
+
+        if (voicePad < 0 || voice->isFadingOut() || (pad >= 0 && voicePad != pad))
+            continue;
+
+        if (quietest == nullptr || voice->getCurrentLevel() < quietest->getCurrentLevel())
+            quietest = voice;
+    }
+
+    if (quietest != nullptr)
+        quietest->fadeOut();
+}
+
+juce::SynthesiserVoice* PadSynth::findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int, int) const
+{
+    // Voices already fading out go first, then the quietest one still sounding.
+    juce::SynthesiserVoice* best = nullptr;
+    float bestLevel = std::numeric_limits<float>::max();
+
+    for (auto* v : voices)
+    {
+        if (!v->canPlaySound(soundToPlay))
+            continue;
+
+        auto* voice = static_cast<PadVoice*>(v);
+        const float level = voice->isFadingOut() ? -1.0f : voice->getCurrentLevel();
+        if (level < bestLevel)
+        {
+            bestLevel = level;
+            best = voice;
+        }
+    }
+
+    jassert(best != nullptr);
+    return best;
+}
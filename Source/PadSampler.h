@@ -0,0 +1,436 @@
+#pragma once
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "PadInsertChain.h"
+#include "RenderPool.h"
+#include "Sequencer.h"
+
+// Immutable decoded sample audio. Stored planar either as 32-bit float or as
+// 16-bit PCM; voices decode it block-wise so compact pads cost half the RAM.
+// The samples live either on the heap or in a memory-mapped file. Heap data
+// can be moved to a file in place, so every holder follows, undo history
+// included.
+//
+// Mapped data is streamed: the first moments after each playback start stay
+// on the heap, and a shared background thread pages in and locks the rest
+// ahead of wherever voices are playing, so the audio thread never reads a
+// page that isn't resident.
+class SampleData
+{
+public:
+    enum class Format
+    {
+        float32,
+        int16
+    };
+
+    ~SampleData();
+
+    static std::shared_ptr<const SampleData> fromReader(juce::AudioFormatReader& reader,
+                                                        double maxLengthSeconds,
+                                                        Format format);
+
+    // Copies the first numFrames of up to two channels of buffer.
+    static std::shared_ptr<const SampleData> fromBuffer(const juce::AudioBuffer<float>& buffer,
+                                                        int numFrames,
+                                                        double rate,
+                                                        Format format);
+
+    // Returns source itself when it is already stored in the requested format.
+    static std::shared_ptr<const SampleData> convert(const std::shared_ptr<const SampleData>& source,
+                                                     Format newFormat);
+
+    // Plays straight from bytes [offset, offset + getMemoryBytes()) of a mapped
+    // file laid out as getRawBytes() describes. The mapping is kept alive by
+    // the result. Returns null when the range doesn't fit or isn't aligned.
+    static std::shared_ptr<const SampleData> fromMappedFile(std::shared_ptr<const juce::MemoryMappedFile> file,
+                                                            size_t offset,
+                                                            int channels,
+                                                            int frames,
+                                                            double rate,
+                                                            Format format);
+
+    // Writes the samples to a new file in directory and plays them from a
+    // read-only mapping of it from then on, so their pages come from disk on
+    // demand and can be dropped by the OS. The file is deleted with the data.
+    // playbackStarts are as for setPlaybackStarts().
+    //
+    // Returns the heap copy that was replaced: reads that began before the
+    // switch may still be using it, so hold it until they can't be. Returns
+    // null when already mapped or on failure.
+    std::shared_ptr<const void> moveToTemporaryFile(const juce::File& directory,
+                                                    const std::vector<int>& playbackStarts) const;
+
+    // Mapped data only: the frames voices start from, each of which keeps a
+    // short head on the heap. Returns the storage replaced, as
+    // moveToTemporaryFile() does, or null when nothing changed.
+    std::shared_ptr<const void> setPlaybackStarts(std::vector<int> starts) const;
+
+    // Keeps the current storage alive while the result is held, for reads on
+    // threads that moveToTemporaryFile() doesn't wait for.
+    std::shared_ptr<const void> retainStorage() const;
+
+    int getNumChannels() const noexcept { return numChannels; }
+    int getNumFrames() const noexcept { return numFrames; }
+    double getSampleRate() const noexcept { return sampleRate; }
+    Format getFormat() const noexcept { return format; }
+    size_t getMemoryBytes() const noexcept;
+    bool isMapped() const noexcept { return mapped.load(std::memory_order_acquire); }
+
+    // The stored samples: each channel's frames in turn, followed by
+    // kGuardFrames of silence, in the native byte order of getFormat().
+    const char* getRawBytes() const noexcept { return live.load(std::memory_order_acquire)->samples; }
+    static size_t getMemoryBytes(int channels, int frames, Format format) noexcept;
+
+    // Returns the channel directly when stored as float on the heap, nullptr
+    // otherwise.
+    const float* getFloatChannel(int channel) const noexcept;
+
+    // Writes frames [startFrame, startFrame + count) of a channel as float.
+    // Frames past the end of the sample are written as silence.
+    void decode(int channel, int startFrame, int count, float* dest) const noexcept;
+
+    // decode() for the audio thread. Frames of mapped data that are neither in
+    // a head nor paged in yet are written as silence rather than faulted in,
+    // and the read-ahead is asked for what follows startFrame.
+    void decodeForPlayback(int channel, int startFrame, int count, float* dest) const noexcept;
+
+    // Reads one value per memory page so the data is resident before playback.
+    float touchPages() const noexcept;
+
+private:
+    SampleData(int channels, int frames, double rate, Format storageFormat);
+    SampleData(int channels, int frames, double rate, Format storageFormat,
+               std::shared_ptr<const juce::MemoryMappedFile> file, size_t offset);
+
+    // Zeroed frames after each channel so interpolation can read one past the end.
+    static constexpr int kGuardFrames = 4;
+
+    // A heap copy of frames [start, start + frames) of every channel, in the
+    // stored format, channel after channel.
+    struct Head
+    {
+        int start = 0;
+        int frames = 0;
+        juce::HeapBlock<char> bytes;
+    };
+
+    struct Storage
+    {
+        juce::HeapBlock<char> heap;
+        std::shared_ptr<const juce::MemoryMappedFile> mapping;
+        const char* samples = nullptr; // into heap or mapping
+        std::vector<int> playbackStarts;
+        std::vector<Head> heads; // mapped only, disjoint, by start
+    };
+
+    struct Streaming;
+    class ReadAhead;
+
+    void encode(int channel, int startFrame, int count, const float* source) noexcept;
+    void decodeBytes(const char* channelBytes, int startFrame, int count, float* dest) const noexcept;
+    size_t getBytesPerSample() const noexcept;
+    size_t getChannelStride() const noexcept;
+    const char* getChannelBytes(int channel) const noexcept;
+    char* getChannelBytes(int channel) noexcept;
+    std::shared_ptr<const void> replaceStorage(std::shared_ptr<const Storage> replacement) const;
+    void addHeads(Storage& target, std::vector<int> starts, const char* source) const;
+
+    int numChannels = 0;
+    int numFrames = 0;
+    double sampleRate = 44100.0;
+    Format format = Format::float32;
+
+    // Replaced whole when the data moves to disk or its heads change. Readers
+    // go through live, so the audio thread never touches the shared_ptr.
+    mutable juce::SpinLock storageLock;
+    mutable std::shared_ptr<const Storage> storage; // under storageLock
+    mutable std::atomic<const Storage*> live { nullptr };
+    mutable std::atomic<bool> mapped { false };
+    // Set before mapped is; destroyed first, so the read-ahead lets go of
+    // this data before its mapping goes.
+    mutable std::unique_ptr<Streaming> streaming;
+};
+
+// One pad's sound: one or more layers, each a frame range of shared sample
+// data, so slices of a loop are views into a single decoded buffer rather
+// than copies of it.
+//
+// Layers sharing a top velocity form a velocity zone. A hit looks its zone up
+// in a flat 128-entry table and cycles through the zone's layers, so picking
+// a layer costs the same however many there are.
+class PadSound : public juce::SynthesiserSound
+{
+public:
+    enum class Cycle
+    {
+        roundRobin,
+        random
+    };
+
+    struct Layer
+    {
+        std::shared_ptr<const SampleData> data;
+        juce::Range<int> region; // empty plays the whole sample
+        int topVelocity = 127;   // highest MIDI velocity of the layer's zone
+    };
+
+    // A loop pad's layers time-stretched to one tempo, each covering the
+    // whole of its data, in the same order as getLayers().
+    struct Stretch
+    {
+        double bpm = 120.0;
+        std::vector<std::shared_ptr<const SampleData>> layers;
+    };
+
+    // A single layer covering every velocity.
+    PadSound(const juce::String& soundName,
+             std::shared_ptr<const SampleData> sampleData,
+             int pad,
+             int rootNote,
+             juce::Range<int> region = {});
+
+    PadSound(const juce::String& soundName,
+             std::vector<Layer> soundLayers,
+             int pad,
+             int rootNote,
+             Cycle cycleMode);
+
+    bool appliesToNote(int midiNoteNumber) override { return midiNoteNumber == midiRootNote; }
+    bool appliesToChannel(int) override { return true; }
+
+    const juce::String& getName() const noexcept { return name; }
+    int getPadIndex() const noexcept { return padIndex; }
+    int getMidiRootNote() const noexcept { return midiRootNote; }
+    Cycle getCycle() const noexcept { return cycle; }
+
+    // The first layer, which names, classifies and draws the pad.
+    const SampleData& getData() const noexcept { return *layers.front().data; }
+    const std::shared_ptr<const SampleData>& getSharedData() const noexcept { return layers.front().data; }
+    juce::Range<int> getRegion() const noexcept { return layers.front().region; }
+
+    // Layers in ascending zone order, regions clipped to their sample.
+    const std::vector<Layer>& getLayers() const noexcept { return layers; }
+
+    // Millisecond counter of the layer's last hit, or of its loading.
+    juce::uint32 getLastUse(size_t layer) const noexcept { return lastUse[layer].load(std::memory_order_relaxed); }
+    void setLastUse(size_t layer, juce::uint32 time) noexcept { lastUse[layer].store(time, std::memory_order_relaxed); }
+
+    // Picks the layer for a hit and marks it used; audio thread only.
+    const Layer& selectLayer(float velocity) noexcept;
+
+    void setEnvelopeParameters(const juce::ADSR::Parameters& params) { envelope = params; }
+    const juce::ADSR::Parameters& getEnvelopeParameters() const noexcept { return envelope; }
+
+    // Loop pads play each hit over loopSteps 16ths of the host tempo; 0 is a
+    // one-shot at its own speed. Both setters are for before the sound is
+    // installed.
+    void setLoopSteps(int steps) noexcept { loopSteps = juce::jmax(0, steps); }
+    int getLoopSteps() const noexcept { return loopSteps; }
+    void setStretch(std::shared_ptr<const Stretch> rendered) { stretch = std::move(rendered); }
+    // The precomputed stretch, or null until one has been rendered.
+    const Stretch* getStretch() const noexcept { return stretch.get(); }
+    const std::shared_ptr<const Stretch>& getSharedStretch() const noexcept { return stretch; }
+
+private:
+    struct Zone
+    {
+        int firstLayer = 0;
+        int numLayers = 0;
+        int next = 0; // round-robin position
+    };
+
+    juce::String name;
+    std::vector<Layer> layers;
+    std::vector<Zone> zones;
+    std::array<juce::uint8, 128> zoneForVelocity{};
+    std::unique_ptr<std::atomic<juce::uint32>[]> lastUse;
+    juce::Random random;
+    Cycle cycle = Cycle::roundRobin;
+    int padIndex = 0;
+    int midiRootNote = 60;
+    int loopSteps = 0;
+    std::shared_ptr<const Stretch> stretch;
+    juce::ADSR::Parameters envelope;
+
+    JUCE_LEAK_DETECTOR(PadSound)
+};
+
+class PadVoice : public juce::SynthesiserVoice
+{
+public:
+    bool canPlaySound(juce::SynthesiserSound* sound) override;
+
+    void startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound*, int pitchWheel) override;
+    void stopNote(float velocity, bool allowTailOff) override;
+
+    void pitchWheelMoved(int) override {}
+    void controllerMoved(int, int) override {}
+
+    void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override;
+    using juce::SynthesiserVoice::renderNextBlock;
+
+    // Pad of the sound being played, or -1 when idle.
+    int getPadIndex() const noexcept;
+
+    // Recent output peak, used to pick the quietest voice to steal.
+    float getCurrentLevel() const noexcept { return currentLevel; }
+
+    // Releases the note over a few milliseconds instead of its ADSR release.
+    void fadeOut();
+    bool isFadingOut() const noexcept { return fadingOut; }
+
+    // Windowed-sinc instead of linear interpolation, for offline rendering.
+    // Takes effect from the next block.
+    void setHighQuality(bool shouldBeHighQuality) noexcept { highQuality = shouldBeHighQuality; }
+
+    // Host tempo that loop pads started from now on are fitted to.
+    void setTempo(double bpm) noexcept { tempo = bpm; }
+
+private:
+    static constexpr int kDecodeFrames = 256;
+
+    void decodeWindow(const SampleData& source, int channel, int firstFrame, float* dest) noexcept;
+
+    double pitchRatio = 0.0;
+    double sourceSamplePosition = 0.0;
+    double endPosition = 0.0;
+    double fadeStartPosition = 0.0;
+    double fadeLength = 1.0;
+    double tempo = 120.0;
+    float gain = 0.0f;
+    float currentLevel = 0.0f;
+    int currentPad = -1;
+    bool fadingOut = false;
+    bool released = false;
+    bool highQuality = false;
+    juce::ADSR adsr;
+    juce::ADSR::Parameters envelope;
+    std::array<std::array<float, kDecodeFrames>, 2> decodeBuffer{};
+
+    // The layer being played, owned by the playing sound.
+    const SampleData* data = nullptr;
+
+    JUCE_LEAK_DETECTOR(PadVoice)
+};
+
+// Synthesiser with per-pad polyphony limits, choke groups and quietest-first
+// voice stealing. Limits are set from the message thread and read on the
+// audio thread.
+//
+// Voices render into one stereo scratch buffer per pad instead of the output;
+// mixPads() then runs each pad's insert chain, applies its gains and sums the
+// pads that are still sounding.
+//
+// Pads never share a voice or a buffer, so with a render pool set the
+// per-pad work runs in parallel. Each pad's voices are still summed in voice
+// order and pads are mixed in pad order, so the output is bit-identical to
+// serial rendering.
+class PadSynth : public juce::Synthesiser
+{
+public:
+    static constexpr int kDefaultPadPolyphony = 4;
+
+    struct PadGains
+    {
+        float left = 1.0f;
+        float right = 1.0f;
+    };
+
+    static constexpr int kNumSends = 2;
+    // The most voices a pool grows to; per-block scratch is sized for it.
+    static constexpr int kMaxVoices = 32;
+
+    struct PadChannel
+    {
+        PadGains gains;
+        std::array<float, kNumSends> sends{};
+        PadInsertChain::Settings inserts;
+    };
+
+    using SendBuses = std::array<juce::AudioBuffer<float>*, kNumSends>;
+    using SendActivity = std::array<bool, kNumSends>;
+
+    PadSynth();
+
+    void setPadPolyphony(int pad, int maxVoices);
+    void setPadChokeGroup(int pad, int group);
+
+    // Allocates the per-pad scratch buffers and insert chains; call from prepareToPlay.
+    void prepare(double sampleRate, int maxBlockSize);
+
+    // What the insert chains delay every pad by; valid after prepare().
+    int getLatencySamples() const noexcept { return inserts.front().getLatencySamples(); }
+
+    // Renders pads on pool, or serially when null. The pool blocks the
+    // rendering thread, so only set one for offline rendering.
+    void setRenderPool(RenderPool* pool) noexcept { renderPool = pool; }
+
+    // Starts a new block of pad rendering; call before renderNextBlock.
+    // numSamples may not exceed the block size given to prepare().
+    // highQuality switches voices to windowed-sinc interpolation; bpm is the
+    // tempo loop pads are fitted to.
+    void beginBlock(int numSamples, bool highQuality = false, double bpm = 120.0);
+
+    // Adds every pad rendered this block into output and the send buses,
+    // ramping from the previous block's gains to the new ones. Returns which
+    // send buses received any signal.
+    SendActivity mixPads(juce::AudioBuffer<float>& output,
+                         const SendBuses& sends,
+                         const std::array<PadChannel, Sequencer::kPads>& channels);
+
+    // True when no voice is sounding and no insert chain has a tail left, so a
+    // block without note-ons would render silence. Same lock as rendering.
+    bool isIdle() const noexcept;
+
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) override;
+
+    // True once since the last call if a note-on found the free-voice
+    // reserve used up, i.e. the pool would benefit from more voices.
+    bool takeVoicePressure() noexcept { return voicePressure.exchange(false); }
+
+protected:
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+
+    juce::SynthesiserVoice* findVoiceToSteal(juce::SynthesiserSound* soundToPlay,
+                                             int midiChannel,
+                                             int midiNoteNumber) const override;
+
+private:
+    // Free voices kept available by fading the quietest one early, so the
+    // pool rarely has to hard-cut a sounding voice.
+    static constexpr int kFreeVoiceReserve = 2;
+
+    void fadeQuietest(int pad);
+    void renderVoicesInParallel(int startSample, int numSamples);
+
+    static bool addPad(juce::AudioBuffer<float>& destination,
+                       const juce::AudioBuffer<float>& padBuffer,
+                       int numSamples,
+                       PadGains previous,
+                       PadGains target);
+
+    std::array<std::atomic<int>, Sequencer::kPads> padPolyphony;
+    std::array<std::atomic<int>, Sequencer::kPads> padChokeGroup;
+    std::atomic<bool> voicePressure { false };
+
+    std::array<juce::AudioBuffer<float>, Sequencer::kPads> padBuffers;
+    std::array<PadInsertChain, Sequencer::kPads> inserts;
+    std::array<bool, Sequencer::kPads> padRendered{};
+    std::array<PadGains, Sequencer::kPads> lastGains{};
+    std::array<std::array<PadGains, kNumSends>, Sequencer::kPads> lastSendGains{};
+    int blockSamples = 0;
+
+    RenderPool* renderPool = nullptr;
+    // Voices grouped by pad, for parallel rendering; pad p's are
+    // [padVoiceStart[p], padVoiceStart[p + 1]).
+    std::vector<PadVoice*> groupedVoices;
+    std::array<int, Sequencer::kPads + 1> padVoiceStart{};
+    std::array<int, Sequencer::kPads> activePads{};
+};
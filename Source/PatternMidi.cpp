@@ -0,0 +1,226 @@
+#include "PatternMidi.h"
+
+#include <cmath>
+#include <functional>
+
+namespace
+{
+constexpr int kTicksPerStep = PatternMidi::kTicksPerQuarter / 4;
+constexpr int kNoteTicks = kTicksPerStep / 2;
+constexpr int kPatternTicks = Sequencer::kSteps * kTicksPerStep;
+constexpr int kReadBufferBytes = 8192;
+
+using NoteCallback = std::function<void(juce::int64 tick, int note, int velocity)>;
+
+juce::String readChunkId(juce::InputStream& in)
+{
+    char id[4];
+    if (in.read(id, 4) != 4)
+        return {};
+
+    return juce::String(id, 4);
+}
+
+// SMF variable-length quantity; false at the end of the chunk or on a malformed value.
+bool readVariableLength(juce::InputStream& in, juce::int64 end, juce::uint32& value)
+{
+    value = 0;
+
+    for (int i = 0; i < 4 && in.getPosition() < end; ++i)
+    {
+        const auto byte = static_cast<juce::uint8>(in.readByte());
+        value = (value << 7) | (byte & 0x7fu);
+
+        if ((byte & 0x80u) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// Walks one MTrk chunk event by event, reporting note-ons with their absolute tick.
+void readTrack(juce::InputStream& in, juce::int64 end, const NoteCallback& onNote)
+{
+    juce::int64 tick = 0;
+    int runningStatus = 0;
+
+    while (in.getPosition() < end)
+    {
+        juce::uint32 delta = 0;
+        if (!readVariableLength(in, end, delta))
+            return;
+
+        tick += delta;
+
+        int status = static_cast<juce::uint8>(in.readByte());
+        int firstData = 0;
+
+        if (status < 0x80)
+        {
+            if (runningStatus == 0)
+                return;
+
+            firstData = status;
+            status = runningStatus;
+        }
+        else if (status == 0xff || status == 0xf0 || status == 0xf7)
+        {
+            // Meta and sysex events carry a length, so they can be skipped unread.
+            if (status == 0xff)
+                in.readByte();
+
+            juce::uint32 length = 0;
+            if (!readVariableLength(in, end, length))
+                return;
+
+            in.skipNextBytes(length);
+            continue;
+        }
+        else if (status > 0xf0)
+        {
+            return;
+        }
+        else
+        {
+            runningStatus = status;
+            firstData = static_cast<juce::uint8>(in.readByte());
+        }
+
+        const int type = status & 0xf0;
+        const bool oneDataByte = type == 0xc0 || type == 0xd0;
+        const int secondData = oneDataByte ? 0 : static_cast<juce::uint8>(in.readByte());
+
+        if (type == 0x90 && secondData > 0)
+            onNote(tick, firstData, secondData);
+    }
+}
+} // namespace
+
+namespace PatternMidi
+{
+juce::MidiFile createMidiFile(const Sequencer::Pattern& pattern, float swingPercent, double bpm)
+{
+    juce::MidiMessageSequence track;
+    track.addEvent(juce::MidiMessage::textMetaEvent(3, "GrooveSeq"), 0.0);
+    track.addEvent(juce::MidiMessage::tempoMetaEvent(juce::roundToInt(60000000.0 / juce::jmax(1.0, bpm))), 0.0);
+    track.addEvent(juce::MidiMessage::timeSignatureMetaEvent(4, 4), 0.0);
+
+    const double swingTicks = kTicksPerStep * (swingPercent / 100.0) * 0.5;
+
+    for (int step = 0; step < Sequencer::kSteps; ++step)
+    {
+        for (int pad = 0; pad < Sequencer::kPads; ++pad)
+        {
+            if (!pattern.active[pad][step])
+                continue;
+
+            double tick = (step + pattern.offset[pad][step]) * kTicksPerStep;
+            if (step % 2 == 1)
+                tick += swingTicks;
+
+            // Kept inside the clip, so it loops cleanly in a DAW.
+            const double noteOnTick = juce::jlimit(0.0, kPatternTicks - 1.0, std::round(tick));
+            const double noteOffTick = juce::jmin(static_cast<double>(kPatternTicks), noteOnTick + kNoteTicks);
+            const int note = kFirstNote + pad;
+            const auto velocity = static_cast<juce::uint8>(juce::jlimit(1, 127, juce::roundToInt(pattern.velocity[pad][step] * 127.0f)));
+
+            track.addEvent(juce::MidiMessage::noteOn(kDrumChannel, note, velocity), noteOnTick);
+            track.addEvent(juce::MidiMessage::noteOff(kDrumChannel, note), noteOffTick);
+        }
+    }
+
+    track.addEvent(juce::MidiMessage::endOfTrack(), kPatternTicks);
+    track.sort();
+    track.updateMatchedPairs();
+
+    juce::MidiFile file;
+    file.setTicksPerQuarterNote(kTicksPerQuarter);
+    file.addTrack(track);
+    return file;
+}
+
+bool writeMidiFile(const Sequencer::Pattern& pattern, float swingPercent, double bpm, const juce::File& file)
+{
+    juce::TemporaryFile temp(file);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk() || !createMidiFile(pattern, swingPercent, bpm).writeTo(out))
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+std::vector<Sequencer::Pattern> readPatterns(juce::InputStream& input, size_t maxPatterns)
+{
+    std::vector<Sequencer::Pattern> patterns;
+    juce::BufferedInputStream in(input, kReadBufferBytes);
+
+    if (maxPatterns == 0 || readChunkId(in) != "MThd")
+        return patterns;
+
+    const int headerLength = in.readIntBigEndian();
+    if (headerLength < 6)
+        return patterns;
+
+    in.readShortBigEndian(); // format: tracks are merged either way
+    const int numTracks = in.readShortBigEndian();
+    const int division = in.readShortBigEndian();
+    in.skipNextBytes(headerLength - 6);
+
+    // Negative divisions are SMPTE frame rates, which say nothing about beats.
+    if (division <= 0)
+        return patterns;
+
+    const double ticksPerStep = division / 4.0;
+    const auto emptyPattern = Sequencer().getPattern();
+
+    const NoteCallback addHit = [&](juce::int64 tick, int note, int velocity)
+    {
+        const int pad = note - kFirstNote;
+        if (pad < 0 || pad >= Sequencer::kPads)
+            return;
+
+        const double position = static_cast<double>(tick) / ticksPerStep;
+        const double nearest = std::round(position);
+        const auto absoluteStep = static_cast<juce::int64>(nearest);
+        const auto index = static_cast<size_t>(absoluteStep / Sequencer::kSteps);
+        if (index >= maxPatterns)
+            return;
+
+        if (index >= patterns.size())
+            patterns.resize(index + 1, emptyPattern);
+
+        auto& pattern = patterns[index];
+        const int step = static_cast<int>(absoluteStep % Sequencer::kSteps);
+        const float level = static_cast<float>(velocity) / 127.0f;
+
+        // Two notes quantized onto one step: keep the louder.
+        if (pattern.active[pad][step] && pattern.velocity[pad][step] >= level)
+            return;
+
+        pattern.active[pad][step] = true;
+        pattern.velocity[pad][step] = level;
+        pattern.offset[pad][step] = static_cast<float>(juce::jlimit(-0.5, 0.5, position - nearest));
+    };
+
+    for (int tracksRead = 0; tracksRead < numTracks && !in.isExhausted();)
+    {
+        const auto id = readChunkId(in);
+        const auto length = static_cast<juce::uint32>(in.readIntBigEndian());
+        const auto end = in.getPosition() + length;
+
+        // Unknown chunk types are allowed by the spec and skipped.
+        if (id == "MTrk")
+        {
+            readTrack(in, end, addHit);
+            ++tracksRead;
+        }
+
+        if (!in.setPosition(end))
+            break;
+    }
+
+    return patterns;
+}
+} // namespace PatternMidi
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <vector>
+
+#include "Sequencer.h"
+
+// Standard MIDI File conversion for patterns. Pads map to notes 36-51 on the
+// GM drum channel, one step to a 16th note.
+namespace PatternMidi
+{
+constexpr int kTicksPerQuarter = 960;
+constexpr int kDrumChannel = 10;
+constexpr int kFirstNote = 36;
+
+// One track with the pattern's hits at their velocity, micro-timing and
+// swing (odd 16ths pushed late by swingPercent / 2 of a step), plus tempo
+// and 4/4 time signature.
+juce::MidiFile createMidiFile(const Sequencer::Pattern& pattern, float swingPercent, double bpm);
+
+// Writes createMidiFile() to file through a temporary, so readers never see
+// a half-written file.
+bool writeMidiFile(const Sequencer::Pattern& pattern, float swingPercent, double bpm, const juce::File& file);
+
+// Reads an SMF one event at a time and cuts it into consecutive patterns of
+// Sequencer::kSteps 16ths; note-ons 36-51 on any channel and in any track
+// become hits. Only the patterns are kept in memory, not the file's events.
+// Returns at most maxPatterns, or none if input isn't a readable SMF with a
+// metrical time division.
+std::vector<Sequencer::Pattern> readPatterns(juce::InputStream& input, size_t maxPatterns);
+} // namespace PatternMidi
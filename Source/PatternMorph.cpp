@@ -0,0 +1,97 @@
+#include "PatternMorph.h"
+
+#include <algorithm>
+
+namespace
+{
+// Bar and half-bar downbeats outrank beats, which outrank 8ths, then 16ths.
+float metricWeight(int step)
+{
+    if (step % 16 == 0)
+        return 1.0f;
+    if (step % 8 == 0)
+        return 0.75f;
+    if (step % 4 == 0)
+        return 0.5f;
+    if (step % 2 == 0)
+        return 0.25f;
+    return 0.0f;
+}
+} // namespace
+
+PatternMorph::PatternMorph(const Sequencer::Pattern& a, const Sequencer::Pattern& b)
+{
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        auto& row = steps[static_cast<size_t>(pad)];
+        std::array<int, Sequencer::kSteps> onlyA{};
+        std::array<int, Sequencer::kSteps> onlyB{};
+        int numOnlyA = 0;
+        int numOnlyB = 0;
+
+        for (int step = 0; step < Sequencer::kSteps; ++step)
+        {
+            auto& cell = row[static_cast<size_t>(step)];
+            cell.velocityA = a.velocity[pad][step];
+            cell.velocityB = b.velocity[pad][step];
+            cell.offsetA = a.offset[pad][step];
+            cell.offsetB = b.offset[pad][step];
+
+            const bool inA = a.active[pad][step];
+            const bool inB = b.active[pad][step];
+            if (inA && inB)
+                cell.source = Source::both;
+            else if (inA)
+                cell.source = Source::a;
+            else if (inB)
+                cell.source = Source::b;
+
+            if (inA && !inB)
+                onlyA[static_cast<size_t>(numOnlyA++)] = step;
+            else if (inB && !inA)
+                onlyB[static_cast<size_t>(numOnlyB++)] = step;
+        }
+
+        const auto strengthA = [&row](int step) { return row[static_cast<size_t>(step)].velocityA + metricWeight(step); };
+        const auto strengthB = [&row](int step) { return row[static_cast<size_t>(step)].velocityB + metricWeight(step); };
+
+        // Weakest A-only steps leave first, strongest B-only steps arrive
+        // first; ties go by position so the order is repeatable.
+        std::stable_sort(onlyA.begin(), onlyA.begin() + numOnlyA,
+                         [&](int x, int y) { return strengthA(x) < strengthA(y); });
+        std::stable_sort(onlyB.begin(), onlyB.begin() + numOnlyB,
+                         [&](int x, int y) { return strengthB(x) > strengthB(y); });
+
+        // Spread the thresholds evenly inside (0, 1), so morph 0 is exactly A
+        // and morph 1 exactly B.
+        for (int rank = 0; rank < numOnlyA; ++rank)
+            row[static_cast<size_t>(onlyA[static_cast<size_t>(rank)])].threshold = (rank + 1.0f) / (numOnlyA + 1.0f);
+
+        for (int rank = 0; rank < numOnlyB; ++rank)
+            row[static_cast<size_t>(onlyB[static_cast<size_t>(rank)])].threshold = (rank + 1.0f) / (numOnlyB + 1.0f);
+    }
+}
+
+PatternMorph::Hit PatternMorph::evaluate(int pad, int step, float morph, Mode mode, float chance) const noexcept
+{
+    const auto& cell = steps[static_cast<size_t>(pad)][static_cast<size_t>(step)];
+
+    switch (cell.source)
+    {
+        case Source::both:
+            return { true,
+                     cell.velocityA + (cell.velocityB - cell.velocityA) * morph,
+                     cell.offsetA + (cell.offsetB - cell.offsetA) * morph };
+
+        case Source::a:
+            return { mode == Mode::density ? morph < cell.threshold : chance >= morph, cell.velocityA, cell.offsetA };
+
+        case Source::b:
+            return { mode == Mode::density ? morph >= cell.threshold : chance < morph, cell.velocityB, cell.offsetB };
+
+        case Source::neither:
+            break;
+    }
+
+    return {};
+}
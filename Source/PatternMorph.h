@@ -0,0 +1,65 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+
+#include "Sequencer.h"
+
+// Blends pattern A into pattern B for live transitions. Steps both patterns
+// share always play, with their velocity and micro-timing interpolated.
+// Steps only one of them has are brought in or dropped as the morph moves:
+//
+// - density: each pad's A-only steps drop out weakest first, and its B-only
+//   steps come in strongest first, ranked by velocity and metric position.
+// - probability: each step plays with a chance that follows the morph,
+//   drawn afresh every cycle.
+//
+// The rank tables are built once, on the message thread, so evaluating a step
+// on the audio thread is a couple of comparisons and never allocates.
+class PatternMorph
+{
+public:
+    enum class Mode
+    {
+        density = 0,
+        probability
+    };
+
+    struct Hit
+    {
+        bool active = false;
+        float velocity = 0.0f;
+        float offset = 0.0f;
+    };
+
+    PatternMorph() = default;
+    PatternMorph(const Sequencer::Pattern& a, const Sequencer::Pattern& b);
+
+    // What pad plays on step at morph (0 is A, 1 is B). chance is this
+    // cycle's draw for the step in [0, 1), used only in probability mode.
+    Hit evaluate(int pad, int step, float morph, Mode mode, float chance) const noexcept;
+
+private:
+    enum class Source : juce::uint8
+    {
+        neither = 0,
+        a,
+        b,
+        both
+    };
+
+    struct Step
+    {
+        float velocityA = 0.0f;
+        float velocityB = 0.0f;
+        float offsetA = 0.0f;
+        float offsetB = 0.0f;
+        // Density mode: an A-only step plays while the morph is below this,
+        // a B-only step once it reaches it.
+        float threshold = 0.0f;
+        Source source = Source::neither;
+    };
+
+    std::array<std::array<Step, Sequencer::kSteps>, Sequencer::kPads> steps{};
+};
@@ -0,0 +1,59 @@
+#include "PatternRecorder.h"
+
+#include <cmath>
+
+void PatternRecorder::recordHit(int pad, double stepPosition, float velocity, float quantizeStrength, double swingSteps) noexcept
+{
+    if (pad < 0 || pad >= Sequencer::kPads)
+        return;
+
+    // Halfway between an even step and the swung odd step either side of it
+    // is always swingSteps / 2 past the straight midpoint.
+    const double nearest = std::floor(stepPosition + 0.5 - swingSteps * 0.5);
+    const bool odd = static_cast<juce::int64>(nearest) % 2 != 0;
+    const double gridPosition = nearest + (odd ? swingSteps : 0.0);
+    const int step = static_cast<int>(static_cast<juce::int64>(nearest) % Sequencer::kSteps);
+
+    Event event;
+    event.pad = pad;
+    event.step = step < 0 ? step + Sequencer::kSteps : step;
+    event.velocity = velocity;
+    event.offset = static_cast<float>((stepPosition - gridPosition) * (1.0 - quantizeStrength));
+    push(event);
+}
+
+void PatternRecorder::eraseStep(int step) noexcept
+{
+    Event event;
+    event.step = step;
+    push(event);
+}
+
+void PatternRecorder::push(const Event& event) noexcept
+{
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 > 0)
+        buffer[static_cast<size_t>(scope.startIndex1)] = event;
+}
+
+void PatternRecorder::popAll(std::vector<Event>& events)
+{
+    const auto scope = fifo.read(fifo.getNumReady());
+    scope.forEach([this, &events](int index)
+    {
+        events.push_back(buffer[static_cast<size_t>(index)]);
+    });
+}
+
+void PatternRecorder::apply(const Event& event, Sequencer& sequencer)
+{
+    if (event.pad < 0)
+    {
+        for (int pad = 0; pad < Sequencer::kPads; ++pad)
+            sequencer.setStepActive(pad, event.step, false);
+    }
+    else
+    {
+        sequencer.setStep(event.pad, event.step, event.velocity, event.offset);
+    }
+}
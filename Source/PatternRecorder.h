@@ -0,0 +1,45 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <vector>
+
+#include "Sequencer.h"
+
+// Carries notes played in record mode from the audio thread to the pattern.
+// The audio thread pushes into a single-producer/single-consumer FIFO without
+// locking or allocating; the message thread pops the events and writes them
+// into the Sequencer.
+class PatternRecorder
+{
+public:
+    struct Event
+    {
+        int pad = -1; // -1 erases the step on every pad
+        int step = 0;
+        float velocity = Sequencer::kDefaultVelocity;
+        float offset = 0.0f;
+    };
+
+    // Audio thread. stepPosition is in steps from the start of the pattern
+    // cycle and may run past its end; quantizeStrength 0..1 pulls the hit
+    // from where it was played (0) to the grid (1). swingSteps is how late
+    // playback puts odd steps, so a hit on the swung position is on time.
+    // Full queues drop events.
+    void recordHit(int pad, double stepPosition, float velocity, float quantizeStrength, double swingSteps) noexcept;
+    void eraseStep(int step) noexcept;
+
+    // Message thread. Moves every queued event into events, oldest first.
+    void popAll(std::vector<Event>& events);
+
+    static void apply(const Event& event, Sequencer& sequencer);
+
+private:
+    void push(const Event& event) noexcept;
+
+    static constexpr int kCapacity = 1024;
+
+    juce::AbstractFifo fifo { kCapacity };
+    std::array<Event, kCapacity> buffer{};
+};
@@ -0,0 +1,63 @@
+#include "PatternSnapshot.h"
+
+namespace
+{
+constexpr float kVelocitySteps = 255.0f;
+constexpr float kOffsetSteps = 254.0f; // +-0.5 of a step maps onto +-127
+} // namespace
+
+bool PatternSnapshot::Row::operator==(const Row& other) const noexcept
+{
+    return active == other.active && velocity == other.velocity && offset == other.offset;
+}
+
+PatternSnapshot::Ptr PatternSnapshot::make(const Sequencer::Pattern& pattern, const Ptr& previous)
+{
+    auto snapshot = std::make_shared<PatternSnapshot>();
+    bool changed = previous == nullptr;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        Row row;
+        for (int step = 0; step < Sequencer::kSteps; ++step)
+        {
+            if (pattern.active[pad][step])
+                row.active |= 1u << step;
+
+            const float velocity = juce::jlimit(0.0f, 1.0f, pattern.velocity[pad][step]);
+            const float offset = juce::jlimit(-0.5f, 0.5f, pattern.offset[pad][step]);
+            row.velocity[static_cast<size_t>(step)] = static_cast<juce::uint8>(juce::roundToInt(velocity * kVelocitySteps));
+            row.offset[static_cast<size_t>(step)] = static_cast<juce::int8>(juce::roundToInt(offset * kOffsetSteps));
+        }
+
+        auto& slot = snapshot->rows[static_cast<size_t>(pad)];
+        if (previous != nullptr && *previous->rows[static_cast<size_t>(pad)] == row)
+        {
+            slot = previous->rows[static_cast<size_t>(pad)];
+        }
+        else
+        {
+            slot = std::make_shared<const Row>(row);
+            changed = true;
+        }
+    }
+
+    if (!changed)
+        return previous;
+
+    return snapshot;
+}
+
+void PatternSnapshot::decode(Sequencer::Pattern& pattern) const noexcept
+{
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto& row = *rows[static_cast<size_t>(pad)];
+        for (int step = 0; step < Sequencer::kSteps; ++step)
+        {
+            pattern.active[pad][step] = (row.active >> step) & 1u;
+            pattern.velocity[pad][step] = row.velocity[static_cast<size_t>(step)] / kVelocitySteps;
+            pattern.offset[pad][step] = row.offset[static_cast<size_t>(step)] / kOffsetSteps;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <memory>
+
+#include "Sequencer.h"
+
+// Immutable, bit-packed copy of a Sequencer::Pattern, as kept by the undo
+// history and read by the audio thread. Each pad's row is stored once and
+// shared by every snapshot it didn't change in, so a snapshot taken after a
+// one-step edit owns a single 68-byte row and points at the other fifteen.
+//
+// Velocities are kept to 1/255 and micro-timing offsets to 1/254 of a step.
+class PatternSnapshot
+{
+public:
+    using Ptr = std::shared_ptr<const PatternSnapshot>;
+
+    // Packs pattern, reusing the rows of previous it didn't change. Returns
+    // previous itself when the pattern packs to the same thing.
+    static Ptr make(const Sequencer::Pattern& pattern, const Ptr& previous = {});
+
+    // Unpacks into pattern without allocating, so the audio thread can call it.
+    void decode(Sequencer::Pattern& pattern) const noexcept;
+
+private:
+    static_assert(Sequencer::kSteps <= 32, "a row's active steps are packed into one 32-bit word");
+
+    struct Row
+    {
+        juce::uint32 active = 0; // bit n is step n
+        std::array<juce::uint8, Sequencer::kSteps> velocity{};
+        std::array<juce::int8, Sequencer::kSteps> offset{};
+
+        bool operator==(const Row& other) const noexcept;
+    };
+
+    std::array<std::shared_ptr<const Row>, Sequencer::kPads> rows;
+};
@@ -5,7 +5,8 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
     , processor(p)
     , sequencerGrid(*this)
 {
-    setSize(820, 620);
+    setSize(1020, 710);
+    setWantsKeyboardFocus(true);
 
     generateButton.onClick = [this]
     {
@@ -13,11 +14,70 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
         sequencerGrid.repaint();
     };
 
+    undoButton.onClick = [this]
+    {
+        stepHistory(true);
+    };
+    redoButton.onClick = [this]
+    {
+        stepHistory(false);
+    };
+    processor.addHistoryListener(this);
+    updateHistoryButtons();
+
+    // Which segment a controller should open, or that there is none to open.
+    const int controller = processor.getControllerInstance();
+    controllerText = controller > 0 ? "Controller /grooveseq-" + juce::String(controller) : "No controller segment";
+
+    bankBox.setTooltip("Patterns imported from the last MIDI file dropped on the grid");
+    bankBox.setTextWhenNothingSelected("No pattern bank");
+    bankBox.setTextWhenNoChoicesAvailable("No pattern bank");
+    bankBox.onChange = [this]
+    {
+        processor.selectBankPattern(bankBox.getSelectedId() - 1);
+        sequencerGrid.repaint();
+    };
+    morphTargetBox.setTooltip("Pattern B for Morph. Pick Copy of Current again after Off to take a new copy.");
+    morphTargetBox.onChange = [this]
+    {
+        const int id = morphTargetBox.getSelectedId();
+        if (id == morphOffId)
+            processor.clearMorphTarget();
+        else if (id == morphCopyId)
+            processor.setMorphTarget(-1);
+        else if (id > 0)
+            processor.setMorphTarget(id - morphFirstBankId);
+    };
+    updateBankBox();
+
     browseButton.onClick = [this]
     {
-        fileBrowserVisible = !fileBrowserVisible;
-        fileBrowser.setVisible(fileBrowserVisible);
-        resized();
+        toggleSampleBrowser();
+    };
+
+    compactToggle.setTooltip("Keep loaded samples as 16-bit PCM to halve their memory use");
+    compactToggle.setToggleState(processor.isCompactSampleStorage(), juce::dontSendNotification);
+    compactToggle.onClick = [this]
+    {
+        processor.setCompactSampleStorage(compactToggle.getToggleState());
+    };
+
+    sliceToggle.setTooltip("Cut loaded loops at their hits across this and the following pads");
+    sliceToggle.setToggleState(processor.isSliceMode(), juce::dontSendNotification);
+    sliceToggle.onClick = [this]
+    {
+        processor.setSliceMode(sliceToggle.getToggleState());
+    };
+
+    impulseButton.onClick = [this]
+    {
+        handleLoadImpulseResponse();
+    };
+
+    kitButton.setTooltip("Load or save all pads, their settings and the patterns as one .gsqkit file");
+    kitButton.onClick = [this]
+    {
+        showKitMenu();
     };
 
     auto setupSlider = [](juce::Slider& slider)
@@ -31,25 +91,74 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
     setupSlider(fillsSlider);
     setupSlider(densitySlider);
     setupSlider(velocitySlider);
+    setupSlider(reverbReturnSlider);
+    setupSlider(delayReturnSlider);
+    setupSlider(delayFeedbackSlider);
+    setupSlider(recordQuantizeSlider);
+    setupSlider(morphSlider);
     setupSlider(attackSlider);
     setupSlider(decaySlider);
     setupSlider(sustainSlider);
     setupSlider(releaseSlider);
+    setupSlider(polyphonySlider);
+    setupSlider(chokeSlider);
+    setupSlider(padLevelSlider);
+    setupSlider(padPanSlider);
+    setupSlider(cutoffSlider);
+    setupSlider(resonanceSlider);
+    setupSlider(driveSlider);
+    setupSlider(transientAttackSlider);
+    setupSlider(transientSustainSlider);
+    setupSlider(reverbSendSlider);
+    setupSlider(delaySendSlider);
+
+    filterTypeBox.addItemList({ "Low-pass", "High-pass", "Band-pass" }, 1);
+    delayTimeBox.addItemList({ "1/4", "1/8", "1/8 Dotted", "1/8 Triplet", "1/16" }, 1);
+    recordModeBox.addItemList({ "Overdub", "Replace" }, 1);
+    morphModeBox.addItemList({ "Density", "Probability" }, 1);
+    morphModeBox.setTooltip("Density brings B's strongest hits in and drops A's weakest first; "
+                            "Probability plays each differing hit by chance, drawn every cycle");
+    recordButton.setTooltip("While the transport runs, write incoming notes 36-51 into the pattern");
 
     attackSlider.setRange(0.0, 100.0, 0.1);
     decaySlider.setRange(0.0, 800.0, 0.1);
     sustainSlider.setRange(0.0, 1.0, 0.001);
     releaseSlider.setRange(0.0, 1500.0, 0.1);
+    polyphonySlider.setRange(1.0, 8.0, 1.0);
+    chokeSlider.setRange(0.0, 4.0, 1.0);
+    chokeSlider.textFromValueFunction = [](double value)
+    {
+        return value < 0.5 ? juce::String("Off") : juce::String(juce::roundToInt(value));
+    };
 
     swingLabel.setJustificationType(juce::Justification::centred);
     humanizeLabel.setJustificationType(juce::Justification::centred);
     fillsLabel.setJustificationType(juce::Justification::centred);
     densityLabel.setJustificationType(juce::Justification::centred);
     velocityLabel.setJustificationType(juce::Justification::centred);
+    reverbReturnLabel.setJustificationType(juce::Justification::centred);
+    delayReturnLabel.setJustificationType(juce::Justification::centred);
+    delayTimeLabel.setJustificationType(juce::Justification::centred);
+    delayFeedbackLabel.setJustificationType(juce::Justification::centred);
+    recordQuantizeLabel.setJustificationType(juce::Justification::centred);
+    morphLabel.setJustificationType(juce::Justification::centred);
+    morphTargetLabel.setJustificationType(juce::Justification::centred);
     attackLabel.setJustificationType(juce::Justification::centred);
     decayLabel.setJustificationType(juce::Justification::centred);
     sustainLabel.setJustificationType(juce::Justification::centred);
     releaseLabel.setJustificationType(juce::Justification::centred);
+    polyphonyLabel.setJustificationType(juce::Justification::centred);
+    chokeLabel.setJustificationType(juce::Justification::centred);
+    padLevelLabel.setJustificationType(juce::Justification::centred);
+    padPanLabel.setJustificationType(juce::Justification::centred);
+    filterTypeLabel.setJustificationType(juce::Justification::centred);
+    cutoffLabel.setJustificationType(juce::Justification::centred);
+    resonanceLabel.setJustificationType(juce::Justification::centred);
+    driveLabel.setJustificationType(juce::Justification::centred);
+    transientAttackLabel.setJustificationType(juce::Justification::centred);
+    transientSustainLabel.setJustificationType(juce::Justification::centred);
+    reverbSendLabel.setJustificationType(juce::Justification::centred);
+    delaySendLabel.setJustificationType(juce::Justification::centred);
     helpLabel.setJustificationType(juce::Justification::centredLeft);
     helpLabel.setColour(juce::Label::textColourId, juce::Colour(0xff9aa0a6));
     selectedLabel.setJustificationType(juce::Justification::centredLeft);
@@ -60,16 +169,44 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
     fillsLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
     densityLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
     velocityLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    reverbReturnLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    delayReturnLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    delayTimeLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    delayFeedbackLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    recordQuantizeLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    morphLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    morphTargetLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
     attackLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
     decayLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
     sustainLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
     releaseLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    polyphonyLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    chokeLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    padLevelLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    padPanLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    filterTypeLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    cutoffLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    resonanceLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    driveLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    transientAttackLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    transientSustainLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    reverbSendLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
+    delaySendLabel.setColour(juce::Label::textColourId, juce::Colour(0xffe0e0e0));
 
     swingAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "swing", swingSlider);
     humanizeAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "humanize", humanizeSlider);
     fillsAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "fills", fillsSlider);
     densityAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "density", densitySlider);
     velocityAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "velocity", velocitySlider);
+    reverbReturnAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "reverbReturn", reverbReturnSlider);
+    delayReturnAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "delayReturn", delayReturnSlider);
+    delayTimeAttachment = std::make_unique<ComboBoxAttachment>(processor.getValueTreeState(), "delayTime", delayTimeBox);
+    delayFeedbackAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "delayFeedback", delayFeedbackSlider);
+    recordQuantizeAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "recordQuantize", recordQuantizeSlider);
+    recordAttachment = std::make_unique<ButtonAttachment>(processor.getValueTreeState(), "record", recordButton);
+    recordModeAttachment = std::make_unique<ComboBoxAttachment>(processor.getValueTreeState(), "recordMode", recordModeBox);
+    morphAttachment = std::make_unique<SliderAttachment>(processor.getValueTreeState(), "morph", morphSlider);
+    morphModeAttachment = std::make_unique<ComboBoxAttachment>(processor.getValueTreeState(), "morphMode", morphModeBox);
     attackSlider.onValueChange = [this]
     {
         auto params = processor.getPadAdsr(selectedPad);
@@ -94,9 +231,24 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
         params.release = static_cast<float>(releaseSlider.getValue() / 1000.0);
         processor.setPadAdsr(selectedPad, params);
     };
+    polyphonySlider.onValueChange = [this]
+    {
+        processor.setPadPolyphony(selectedPad, juce::roundToInt(polyphonySlider.getValue()));
+    };
+    chokeSlider.onValueChange = [this]
+    {
+        processor.setPadChokeGroup(selectedPad, juce::roundToInt(chokeSlider.getValue()));
+    };
 
     addAndMakeVisible(generateButton);
+    addAndMakeVisible(undoButton);
+    addAndMakeVisible(redoButton);
     addAndMakeVisible(browseButton);
+    addAndMakeVisible(compactToggle);
+    addAndMakeVisible(sliceToggle);
+    addAndMakeVisible(impulseButton);
+    addAndMakeVisible(kitButton);
+    addAndMakeVisible(bankBox);
     addAndMakeVisible(helpLabel);
     addAndMakeVisible(selectedLabel);
     addAndMakeVisible(sequencerGrid);
@@ -106,20 +258,63 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
     addAndMakeVisible(fillsSlider);
     addAndMakeVisible(densitySlider);
     addAndMakeVisible(velocitySlider);
+    addAndMakeVisible(reverbReturnSlider);
+    addAndMakeVisible(delayReturnSlider);
+    addAndMakeVisible(delayTimeBox);
+    addAndMakeVisible(delayFeedbackSlider);
+    addAndMakeVisible(recordQuantizeSlider);
+    addAndMakeVisible(recordButton);
+    addAndMakeVisible(recordModeBox);
+    addAndMakeVisible(morphSlider);
+    addAndMakeVisible(morphTargetBox);
+    addAndMakeVisible(morphModeBox);
     addAndMakeVisible(attackSlider);
     addAndMakeVisible(decaySlider);
     addAndMakeVisible(sustainSlider);
     addAndMakeVisible(releaseSlider);
+    addAndMakeVisible(polyphonySlider);
+    addAndMakeVisible(chokeSlider);
+    addAndMakeVisible(padLevelSlider);
+    addAndMakeVisible(padPanSlider);
+    addAndMakeVisible(muteButton);
+    addAndMakeVisible(soloButton);
+    addAndMakeVisible(filterTypeBox);
+    addAndMakeVisible(cutoffSlider);
+    addAndMakeVisible(resonanceSlider);
+    addAndMakeVisible(driveSlider);
+    addAndMakeVisible(transientAttackSlider);
+    addAndMakeVisible(transientSustainSlider);
+    addAndMakeVisible(reverbSendSlider);
+    addAndMakeVisible(delaySendSlider);
 
     addAndMakeVisible(swingLabel);
     addAndMakeVisible(humanizeLabel);
     addAndMakeVisible(fillsLabel);
     addAndMakeVisible(densityLabel);
     addAndMakeVisible(velocityLabel);
+    addAndMakeVisible(reverbReturnLabel);
+    addAndMakeVisible(delayReturnLabel);
+    addAndMakeVisible(delayTimeLabel);
+    addAndMakeVisible(delayFeedbackLabel);
+    addAndMakeVisible(recordQuantizeLabel);
+    addAndMakeVisible(morphLabel);
+    addAndMakeVisible(morphTargetLabel);
     addAndMakeVisible(attackLabel);
     addAndMakeVisible(decayLabel);
     addAndMakeVisible(sustainLabel);
     addAndMakeVisible(releaseLabel);
+    addAndMakeVisible(polyphonyLabel);
+    addAndMakeVisible(chokeLabel);
+    addAndMakeVisible(padLevelLabel);
+    addAndMakeVisible(padPanLabel);
+    addAndMakeVisible(filterTypeLabel);
+    addAndMakeVisible(cutoffLabel);
+    addAndMakeVisible(resonanceLabel);
+    addAndMakeVisible(driveLabel);
+    addAndMakeVisible(transientAttackLabel);
+    addAndMakeVisible(transientSustainLabel);
+    addAndMakeVisible(reverbSendLabel);
+    addAndMakeVisible(delaySendLabel);
 
     pads.reserve(Sequencer::kPads);
     for (int i = 0; i < Sequencer::kPads; ++i)
@@ -139,6 +334,10 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
         {
             processor.triggerPadPreview(padIndex);
         });
+        pad->setOnMenu([this](int padIndex)
+        {
+            showPadMenu(padIndex);
+        });
         pads.push_back(std::move(pad));
         addAndMakeVisible(pads.back().get());
     }
@@ -146,14 +345,15 @@ GrooveSeqAudioProcessorEditor::GrooveSeqAudioProcessorEditor(GrooveSeqAudioProce
     updatePadLabels();
     selectPad(0);
 
-    fileBrowser.addListener(this);
-    fileBrowser.setVisible(false);
-    addAndMakeVisible(fileBrowser);
-
     resized();
+    startTimerHz(4);
 }
 
-GrooveSeqAudioProcessorEditor::~GrooveSeqAudioProcessorEditor() = default;
+GrooveSeqAudioProcessorEditor::~GrooveSeqAudioProcessorEditor()
+{
+    stopTimer();
+    processor.removeHistoryListener(this);
+}
 
 void GrooveSeqAudioProcessorEditor::paint(juce::Graphics& g)
 {
@@ -161,33 +361,48 @@ void GrooveSeqAudioProcessorEditor::paint(juce::Graphics& g)
     g.setColour(juce::Colour(0xffd7d7d7));
     g.setFont(juce::Font(16.0f, juce::Font::bold));
     g.drawText("GrooveSeq", getLocalBounds().removeFromTop(30), juce::Justification::centred);
+
+    g.setColour(juce::Colour(0xff9aa0a6));
+    g.setFont(juce::Font(12.0f));
+    g.drawText(controllerText + "   " + blockLoadText, getLocalBounds().removeFromTop(30).reduced(12, 0),
+               juce::Justification::centredRight);
 }
 
 void GrooveSeqAudioProcessorEditor::resized()
 {
     auto area = getLocalBounds().reduced(12);
-    auto header = area.removeFromTop(210);
+    auto header = area.removeFromTop(300);
 
     auto headerTop = header.removeFromTop(34);
-    generateButton.setBounds(headerTop.removeFromLeft(140).reduced(6, 2));
-    browseButton.setBounds(headerTop.removeFromLeft(140).reduced(6, 2));
-    selectedLabel.setBounds(headerTop.removeFromLeft(180).reduced(6, 2));
+    generateButton.setBounds(headerTop.removeFromLeft(100).reduced(6, 2));
+    undoButton.setBounds(headerTop.removeFromLeft(60).reduced(6, 2));
+    redoButton.setBounds(headerTop.removeFromLeft(60).reduced(6, 2));
+    browseButton.setBounds(headerTop.removeFromLeft(90).reduced(6, 2));
+    kitButton.setBounds(headerTop.removeFromLeft(60).reduced(6, 2));
+    compactToggle.setBounds(headerTop.removeFromLeft(120).reduced(6, 2));
+    sliceToggle.setBounds(headerTop.removeFromLeft(110).reduced(6, 2));
+    impulseButton.setBounds(headerTop.removeFromLeft(100).reduced(6, 2));
+    bankBox.setBounds(headerTop.removeFromLeft(130).reduced(6, 2));
+    selectedLabel.setBounds(headerTop.removeFromLeft(150).reduced(6, 2));
     helpLabel.setBounds(headerTop.reduced(6, 2));
 
-    if (fileBrowserVisible)
+    if (sampleBrowserVisible && sampleBrowser != nullptr)
     {
         auto browserArea = area.removeFromBottom(180);
-        fileBrowser.setBounds(browserArea.reduced(6));
+        sampleBrowser->setBounds(browserArea.reduced(6));
     }
 
     auto gridArea = area.removeFromTop(160);
     sequencerGrid.setBounds(gridArea.reduced(4, 0));
 
     auto sliderArea = header.reduced(0, 6);
-    auto topRow = sliderArea.removeFromTop(sliderArea.getHeight() / 2);
-    auto bottomRow = sliderArea;
-    const int topWidth = topRow.getWidth() / 5;
-    const int bottomWidth = bottomRow.getWidth() / 4;
+    const int rowHeight = sliderArea.getHeight() / 3;
+    auto topRow = sliderArea.removeFromTop(rowHeight);
+    auto bottomRow = sliderArea.removeFromTop(rowHeight);
+    auto insertRow = sliderArea;
+    const int topWidth = topRow.getWidth() / 13;
+    const int bottomWidth = bottomRow.getWidth() / 9;
+    const int insertWidth = insertRow.getWidth() / 8;
 
     auto placeSlider = [](juce::Rectangle<int> area, juce::Slider& slider, juce::Label& label)
     {
@@ -201,11 +416,50 @@ void GrooveSeqAudioProcessorEditor::resized()
     placeSlider(topRow.removeFromLeft(topWidth), fillsSlider, fillsLabel);
     placeSlider(topRow.removeFromLeft(topWidth), densitySlider, densityLabel);
     placeSlider(topRow.removeFromLeft(topWidth), velocitySlider, velocityLabel);
+    placeSlider(topRow.removeFromLeft(topWidth), reverbReturnSlider, reverbReturnLabel);
+    placeSlider(topRow.removeFromLeft(topWidth), delayReturnSlider, delayReturnLabel);
+
+    auto delayTimeSlot = topRow.removeFromLeft(topWidth).reduced(6);
+    delayTimeLabel.setBounds(delayTimeSlot.removeFromTop(18));
+    delayTimeBox.setBounds(delayTimeSlot.withSizeKeepingCentre(delayTimeSlot.getWidth(), 24));
+    placeSlider(topRow.removeFromLeft(topWidth), delayFeedbackSlider, delayFeedbackLabel);
+    placeSlider(topRow.removeFromLeft(topWidth), recordQuantizeSlider, recordQuantizeLabel);
+
+    auto recordSlot = topRow.removeFromLeft(topWidth).reduced(6);
+    recordSlot.removeFromTop(18);
+    recordButton.setBounds(recordSlot.removeFromTop(recordSlot.getHeight() / 2));
+    recordModeBox.setBounds(recordSlot.withSizeKeepingCentre(recordSlot.getWidth(), 24));
+
+    placeSlider(topRow.removeFromLeft(topWidth), morphSlider, morphLabel);
+    auto morphSlot = topRow.removeFromLeft(topWidth).reduced(6);
+    morphTargetLabel.setBounds(morphSlot.removeFromTop(18));
+    morphTargetBox.setBounds(morphSlot.removeFromTop(morphSlot.getHeight() / 2).withSizeKeepingCentre(morphSlot.getWidth(), 24));
+    morphModeBox.setBounds(morphSlot.withSizeKeepingCentre(morphSlot.getWidth(), 24));
 
     placeSlider(bottomRow.removeFromLeft(bottomWidth), attackSlider, attackLabel);
     placeSlider(bottomRow.removeFromLeft(bottomWidth), decaySlider, decayLabel);
     placeSlider(bottomRow.removeFromLeft(bottomWidth), sustainSlider, sustainLabel);
     placeSlider(bottomRow.removeFromLeft(bottomWidth), releaseSlider, releaseLabel);
+    placeSlider(bottomRow.removeFromLeft(bottomWidth), polyphonySlider, polyphonyLabel);
+    placeSlider(bottomRow.removeFromLeft(bottomWidth), chokeSlider, chokeLabel);
+    placeSlider(bottomRow.removeFromLeft(bottomWidth), padLevelSlider, padLevelLabel);
+    placeSlider(bottomRow.removeFromLeft(bottomWidth), padPanSlider, padPanLabel);
+
+    auto toggleSlot = bottomRow.removeFromLeft(bottomWidth).reduced(6);
+    toggleSlot.removeFromTop(18);
+    muteButton.setBounds(toggleSlot.removeFromTop(toggleSlot.getHeight() / 2));
+    soloButton.setBounds(toggleSlot);
+
+    auto filterSlot = insertRow.removeFromLeft(insertWidth).reduced(6);
+    filterTypeLabel.setBounds(filterSlot.removeFromTop(18));
+    filterTypeBox.setBounds(filterSlot.withSizeKeepingCentre(filterSlot.getWidth(), 24));
+    placeSlider(insertRow.removeFromLeft(insertWidth), cutoffSlider, cutoffLabel);
+    placeSlider(insertRow.removeFromLeft(insertWidth), resonanceSlider, resonanceLabel);
+    placeSlider(insertRow.removeFromLeft(insertWidth), driveSlider, driveLabel);
+    placeSlider(insertRow.removeFromLeft(insertWidth), transientAttackSlider, transientAttackLabel);
+    placeSlider(insertRow.removeFromLeft(insertWidth), transientSustainSlider, transientSustainLabel);
+    placeSlider(insertRow.removeFromLeft(insertWidth), reverbSendSlider, reverbSendLabel);
+    placeSlider(insertRow.removeFromLeft(insertWidth), delaySendSlider, delaySendLabel);
 
     juce::Grid grid;
     grid.templateColumns = { juce::Grid::TrackInfo(juce::Grid::Fr(1)),
@@ -225,6 +479,71 @@ void GrooveSeqAudioProcessorEditor::resized()
     grid.performLayout(area);
 }
 
+bool GrooveSeqAudioProcessorEditor::keyPressed(const juce::KeyPress& key)
+{
+    const auto modifiers = key.getModifiers();
+    if (!modifiers.isCommandDown())
+        return false;
+
+    const int keyCode = key.getKeyCode();
+    if (keyCode == 'Z' || keyCode == 'z')
+    {
+        stepHistory(!modifiers.isShiftDown());
+        return true;
+    }
+
+    if (keyCode == 'Y' || keyCode == 'y')
+    {
+        stepHistory(false);
+        return true;
+    }
+
+    return false;
+}
+
+void GrooveSeqAudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    updateHistoryButtons();
+
+    // Controller commands edit the pattern, bank and pads through the same
+    // history, so this is also where the editor catches up with them.
+    updatePadLabels();
+    updateBankBox();
+}
+
+void GrooveSeqAudioProcessorEditor::timerCallback()
+{
+    // The peak since the last tick, so a spike shows for a quarter second.
+    const auto load = processor.takeBlockLoad();
+    auto text = "Peak DSP " + juce::String(juce::roundToInt(load.peak * 100.0)) + "%";
+    if (load.overruns > 0)
+        text << ", " << load.overruns << " overruns";
+
+    if (text != blockLoadText)
+    {
+        blockLoadText = text;
+        repaint(getLocalBounds().removeFromTop(30));
+    }
+}
+
+void GrooveSeqAudioProcessorEditor::stepHistory(bool backwards)
+{
+    if (!(backwards ? processor.undo() : processor.redo()))
+        return;
+
+    // Any of the pads, the pattern or the selected pad's envelope may have changed.
+    updatePadLabels();
+    updatePadControls();
+}
+
+void GrooveSeqAudioProcessorEditor::updateHistoryButtons()
+{
+    undoButton.setEnabled(processor.canUndo());
+    redoButton.setEnabled(processor.canRedo());
+    undoButton.setTooltip(processor.canUndo() ? "Undo " + processor.getUndoDescription() : juce::String());
+    redoButton.setTooltip(processor.canRedo() ? "Redo " + processor.getRedoDescription() : juce::String());
+}
+
 void GrooveSeqAudioProcessorEditor::handleLoadSample(int padIndex)
 {
     fileChooser = std::make_unique<juce::FileChooser>(
@@ -248,10 +567,231 @@ void GrooveSeqAudioProcessorEditor::handleLoadSample(int padIndex)
     });
 }
 
+void GrooveSeqAudioProcessorEditor::handleAddLayer(int padIndex, bool newVelocityZone)
+{
+    fileChooser = std::make_unique<juce::FileChooser>(
+        newVelocityZone ? "Add a velocity layer" : "Add a round-robin sample",
+        processor.getPadFile(padIndex),
+        "*.wav;*.aiff;*.aif;*.flac",
+        false,
+        false,
+        this);
+
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+    fileChooser->launchAsync(flags, [this, padIndex, newVelocityZone](const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file.existsAsFile() && processor.addPadLayer(padIndex, file, newVelocityZone))
+            updatePadLabels();
+    });
+}
+
+void GrooveSeqAudioProcessorEditor::handleLoadImpulseResponse()
+{
+    fileChooser = std::make_unique<juce::FileChooser>(
+        "Select a reverb impulse response",
+        processor.getImpulseResponseFile(),
+        "*.wav;*.aiff;*.aif;*.flac",
+        false,
+        false,
+        this);
+
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+    fileChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file.existsAsFile())
+            processor.loadImpulseResponse(file);
+    });
+}
+
+void GrooveSeqAudioProcessorEditor::toggleSampleBrowser()
+{
+    if (sampleBrowser == nullptr)
+    {
+        sampleBrowser = std::make_unique<SampleBrowser>();
+        sampleBrowser->setOnSampleChosen([this](const juce::File& file)
+        {
+            tryLoadFileToSelectedPad(file);
+        });
+        addChildComponent(*sampleBrowser);
+    }
+
+    sampleBrowserVisible = !sampleBrowserVisible;
+    sampleBrowser->setVisible(sampleBrowserVisible);
+    resized();
+}
+
+void GrooveSeqAudioProcessorEditor::showKitMenu()
+{
+    enum
+    {
+        loadKitItem = 1,
+        saveKitItem
+    };
+
+    static constexpr std::array<int, 6> budgetsMb { 0, 64, 128, 256, 512, 1024 };
+    constexpr int firstBudgetItem = 100;
+
+    juce::PopupMenu budgetMenu;
+    for (size_t i = 0; i < budgetsMb.size(); ++i)
+    {
+        budgetMenu.addItem(firstBudgetItem + static_cast<int>(i),
+                           budgetsMb[i] == 0 ? juce::String("Unlimited") : juce::String(budgetsMb[i]) + " MB",
+                           true,
+                           processor.getSampleMemoryBudget() == budgetsMb[i]);
+    }
+
+    juce::PopupMenu menu;
+    menu.addItem(loadKitItem, "Load Kit...");
+    menu.addItem(saveKitItem, "Save Kit...");
+    menu.addSeparator();
+    menu.addSubMenu("Sample Memory Budget", budgetMenu);
+
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(kitButton), [this](int result)
+    {
+        if (result >= firstBudgetItem && result < firstBudgetItem + static_cast<int>(budgetsMb.size()))
+        {
+            processor.setSampleMemoryBudget(budgetsMb[static_cast<size_t>(result - firstBudgetItem)]);
+            return;
+        }
+
+        if (result != loadKitItem && result != saveKitItem)
+            return;
+
+        const bool saving = result == saveKitItem;
+        fileChooser = std::make_unique<juce::FileChooser>(
+            saving ? "Save kit" : "Load kit",
+            juce::File::getSpecialLocation(juce::File::userMusicDirectory),
+            juce::String("*") + KitBundle::kFileExtension,
+            false,
+            false,
+            this);
+
+        const auto flags = saving ? juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting
+                                  : juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+        fileChooser->launchAsync(flags, [this, saving](const juce::FileChooser& chooser)
+        {
+            auto file = chooser.getResult();
+            if (file == juce::File())
+                return;
+
+            if (saving)
+            {
+                processor.saveKit(file.withFileExtension(KitBundle::kFileExtension));
+                return;
+            }
+
+            if (processor.loadKit(file))
+            {
+                updatePadLabels();
+                updateBankBox();
+                selectPad(selectedPad);
+                sequencerGrid.repaint();
+            }
+        });
+    });
+}
+
+void GrooveSeqAudioProcessorEditor::showPadMenu(int padIndex)
+{
+    enum
+    {
+        addVelocityLayerItem = 1,
+        addRoundRobinItem,
+        roundRobinItem,
+        randomItem,
+        loopItem,
+        clearLayersItem
+    };
+
+    const bool loaded = processor.getPadLayerCount(padIndex) > 0;
+    const auto cycle = processor.getPadCycle(padIndex);
+    const bool looped = processor.getPadLoopSteps(padIndex) > 0;
+
+    juce::PopupMenu menu;
+    menu.addItem(addVelocityLayerItem, "Add Velocity Layer...");
+    menu.addItem(addRoundRobinItem, "Add Round-Robin Sample...");
+    menu.addSeparator();
+    menu.addItem(roundRobinItem, "Cycle in Order", loaded, cycle == PadSound::Cycle::roundRobin);
+    menu.addItem(randomItem, "Cycle at Random", loaded, cycle == PadSound::Cycle::random);
+    menu.addSeparator();
+    menu.addItem(loopItem, "Loop to Tempo", loaded, looped);
+    menu.addSeparator();
+    menu.addItem(clearLayersItem, "Clear Extra Layers", processor.getPadLayerCount(padIndex) > 1);
+
+    const auto* target = pads[static_cast<size_t>(padIndex)].get();
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(target), [this, padIndex, looped](int result)
+    {
+        switch (result)
+        {
+            case addVelocityLayerItem: handleAddLayer(padIndex, true); break;
+            case addRoundRobinItem: handleAddLayer(padIndex, false); break;
+            case roundRobinItem: processor.setPadCycle(padIndex, PadSound::Cycle::roundRobin); break;
+            case randomItem: processor.setPadCycle(padIndex, PadSound::Cycle::random); break;
+            case loopItem:
+                processor.setPadLoop(padIndex, !looped);
+                updatePadLabels();
+                break;
+            case clearLayersItem:
+                processor.clearPadLayers(padIndex);
+                updatePadLabels();
+                break;
+            default: break;
+        }
+    });
+}
+
+void GrooveSeqAudioProcessorEditor::updateBankBox()
+{
+    bankBox.clear(juce::dontSendNotification);
+
+    for (int i = 0; i < processor.getPatternBankSize(); ++i)
+        bankBox.addItem("Pattern " + juce::String(i + 1), i + 1);
+
+    bankBox.setSelectedId(processor.getSelectedBankPattern() + 1, juce::dontSendNotification);
+
+    // Morph targets include the bank's patterns, so they change with it.
+    morphTargetBox.clear(juce::dontSendNotification);
+    morphTargetBox.addItem("Off", morphOffId);
+    morphTargetBox.addItem("Copy of Current", morphCopyId);
+    for (int i = 0; i < processor.getPatternBankSize(); ++i)
+        morphTargetBox.addItem("Pattern " + juce::String(i + 1), morphFirstBankId + i);
+
+    int morphId = morphOffId;
+    if (processor.hasMorphTarget())
+    {
+        const int bankPattern = processor.getMorphTargetBankPattern();
+        morphId = bankPattern >= 0 ? morphFirstBankId + bankPattern : morphCopyId;
+    }
+
+    morphTargetBox.setSelectedId(morphId, juce::dontSendNotification);
+}
+
 void GrooveSeqAudioProcessorEditor::updatePadLabels()
 {
     for (int i = 0; i < static_cast<int>(pads.size()); ++i)
-        pads[static_cast<size_t>(i)]->setPadName(processor.getPadName(i));
+    {
+        auto& pad = *pads[static_cast<size_t>(i)];
+        pad.setPadName(processor.getPadName(i));
+        pad.setSampleFile(processor.getPadFile(i), processor.getPadRegion(i));
+
+        const int layers = processor.getPadLayerCount(i);
+        const int loopSteps = processor.getPadLoopSteps(i);
+        juce::String role = Sequencer::getRoleName(processor.getPadRole(i));
+        if (layers > 1)
+            role = (role + "  " + juce::String(layers) + " layers").trim();
+        if (loopSteps > 0)
+            role = (role + "  loop " + juce::String(loopSteps)).trim();
+
+        pad.setRoleName(role);
+    }
+
+    // Sliced loads also rewrite the pattern.
+    sequencerGrid.repaint();
 }
 
 void GrooveSeqAudioProcessorEditor::selectPad(int padIndex)
@@ -264,12 +804,33 @@ void GrooveSeqAudioProcessorEditor::selectPad(int padIndex)
         pads[static_cast<size_t>(i)]->setSelected(i == padIndex);
 
     selectedLabel.setText("Selected Pad: " + juce::String(selectedPad + 1), juce::dontSendNotification);
+    updatePadControls();
+
+    // Re-point the mixer controls at the selected pad's parameters.
+    auto& state = processor.getValueTreeState();
+    padLevelAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "level"), padLevelSlider);
+    padPanAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "pan"), padPanSlider);
+    muteAttachment = std::make_unique<ButtonAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "mute"), muteButton);
+    soloAttachment = std::make_unique<ButtonAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "solo"), soloButton);
+    filterTypeAttachment = std::make_unique<ComboBoxAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "filter"), filterTypeBox);
+    cutoffAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "cutoff"), cutoffSlider);
+    resonanceAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "reso"), resonanceSlider);
+    driveAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "drive"), driveSlider);
+    transientAttackAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "attack"), transientAttackSlider);
+    transientSustainAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "sustain"), transientSustainSlider);
+    reverbSendAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "reverb"), reverbSendSlider);
+    delaySendAttachment = std::make_unique<SliderAttachment>(state, GrooveSeqAudioProcessor::padParamId(selectedPad, "delay"), delaySendSlider);
+}
 
+void GrooveSeqAudioProcessorEditor::updatePadControls()
+{
     const auto params = processor.getPadAdsr(selectedPad);
     attackSlider.setValue(params.attack * 1000.0, juce::dontSendNotification);
     decaySlider.setValue(params.decay * 1000.0, juce::dontSendNotification);
     sustainSlider.setValue(params.sustain, juce::dontSendNotification);
     releaseSlider.setValue(params.release * 1000.0, juce::dontSendNotification);
+    polyphonySlider.setValue(processor.getPadPolyphony(selectedPad), juce::dontSendNotification);
+    chokeSlider.setValue(processor.getPadChokeGroup(selectedPad), juce::dontSendNotification);
 }
 
 void GrooveSeqAudioProcessorEditor::tryLoadFileToSelectedPad(const juce::File& file)
@@ -281,37 +842,24 @@ void GrooveSeqAudioProcessorEditor::tryLoadFileToSelectedPad(const juce::File& f
         updatePadLabels();
 }
 
-void GrooveSeqAudioProcessorEditor::selectionChanged()
-{
-    auto file = fileBrowser.getSelectedFile(0);
-    if (file.existsAsFile())
-        tryLoadFileToSelectedPad(file);
-}
-
-void GrooveSeqAudioProcessorEditor::fileClicked(const juce::File& file, const juce::MouseEvent&)
-{
-    if (file.existsAsFile())
-        tryLoadFileToSelectedPad(file);
-}
-
-void GrooveSeqAudioProcessorEditor::fileDoubleClicked(const juce::File& file)
+bool GrooveSeqAudioProcessorEditor::getStepState(int pad, int step) const
 {
-    if (file.existsAsFile())
-        tryLoadFileToSelectedPad(file);
+    return processor.getStepState(pad, step);
 }
 
-void GrooveSeqAudioProcessorEditor::browserRootChanged(const juce::File&)
+void GrooveSeqAudioProcessorEditor::setStepState(int pad, int step, bool enabled)
 {
+    processor.setStepState(pad, step, enabled);
 }
 
-bool GrooveSeqAudioProcessorEditor::getStepState(int pad, int step) const
+float GrooveSeqAudioProcessorEditor::getStepVelocity(int pad, int step) const
 {
-    return processor.getStepState(pad, step);
+    return processor.getStepVelocity(pad, step);
 }
 
-void GrooveSeqAudioProcessorEditor::setStepState(int pad, int step, bool enabled)
+float GrooveSeqAudioProcessorEditor::getStepOffset(int pad, int step) const
 {
-    processor.setStepState(pad, step, enabled);
+    return processor.getStepOffset(pad, step);
 }
 
 int GrooveSeqAudioProcessorEditor::getCurrentStep() const
@@ -328,3 +876,28 @@ int GrooveSeqAudioProcessorEditor::getStepCount() const
 {
     return Sequencer::kSteps;
 }
+
+void GrooveSeqAudioProcessorEditor::loopDropped(const juce::File& file)
+{
+    processor.transcribeLoop(file);
+}
+
+void GrooveSeqAudioProcessorEditor::midiFileDropped(const juce::File& file)
+{
+    if (processor.importPatternMidi(file) > 0)
+    {
+        updateBankBox();
+        sequencerGrid.repaint();
+    }
+}
+
+juce::File GrooveSeqAudioProcessorEditor::exportPatternForDrag()
+{
+    const auto file = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("GrooveSeq Pattern.mid");
+    return processor.exportPatternMidi(file) ? file : juce::File{};
+}
+
+float GrooveSeqAudioProcessorEditor::getTranscriptionProgress() const
+{
+    return processor.getTranscriptionProgress();
+}
@@ -5,12 +5,14 @@
 #include <vector>
 
 #include "PluginProcessor.h"
+#include "SampleBrowser.h"
 #include "SamplePad.h"
 #include "SequencerGrid.h"
 
 class GrooveSeqAudioProcessorEditor : public juce::AudioProcessorEditor,
-                                      public juce::FileBrowserListener,
-                                      public SequencerGrid::DataProvider
+                                      public SequencerGrid::DataProvider,
+                                      private juce::ChangeListener,
+                                      private juce::Timer
 {
 public:
     explicit GrooveSeqAudioProcessorEditor(GrooveSeqAudioProcessor&);
@@ -18,26 +20,55 @@ public:
 
     void paint(juce::Graphics&) override;
     void resized() override;
-    void selectionChanged() override;
-    void fileClicked(const juce::File& file, const juce::MouseEvent& e) override;
-    void fileDoubleClicked(const juce::File& file) override;
-    void browserRootChanged(const juce::File& newRoot) override;
+    bool keyPressed(const juce::KeyPress& key) override;
     bool getStepState(int pad, int step) const override;
     void setStepState(int pad, int step, bool enabled) override;
+    float getStepVelocity(int pad, int step) const override;
+    float getStepOffset(int pad, int step) const override;
     int getCurrentStep() const override;
     int getPadCount() const override;
     int getStepCount() const override;
+    void loopDropped(const juce::File& file) override;
+    void midiFileDropped(const juce::File& file) override;
+    juce::File exportPatternForDrag() override;
+    float getTranscriptionProgress() const override;
 
 private:
+    // morphTargetBox item IDs; bank pattern N is morphFirstBankId + N.
+    enum
+    {
+        morphOffId = 1,
+        morphCopyId,
+        morphFirstBankId
+    };
+
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
+    void timerCallback() override;
+    void stepHistory(bool backwards);
+    void updateHistoryButtons();
     void handleLoadSample(int padIndex);
+    void handleLoadImpulseResponse();
+    void showKitMenu();
+    void showPadMenu(int padIndex);
+    void handleAddLayer(int padIndex, bool newVelocityZone);
+    void toggleSampleBrowser();
     void updatePadLabels();
+    void updateBankBox();
     void selectPad(int padIndex);
+    void updatePadControls();
     void tryLoadFileToSelectedPad(const juce::File& file);
 
     GrooveSeqAudioProcessor& processor;
 
     juce::TextButton generateButton { "Generate" };
+    juce::TextButton undoButton { "Undo" };
+    juce::TextButton redoButton { "Redo" };
     juce::TextButton browseButton { "Browse" };
+    juce::ToggleButton compactToggle { "Compact RAM" };
+    juce::ToggleButton sliceToggle { "Slice Loops" };
+    juce::TextButton impulseButton { "Reverb IR" };
+    juce::TextButton kitButton { "Kit" };
+    juce::ComboBox bankBox;
     juce::Label helpLabel { {}, "Click Load or drop a sample onto a pad" };
     juce::Label selectedLabel { {}, "Selected Pad: 1" };
     SequencerGrid sequencerGrid;
@@ -47,38 +78,103 @@ private:
     juce::Slider fillsSlider;
     juce::Slider densitySlider;
     juce::Slider velocitySlider;
+    juce::Slider reverbReturnSlider;
+    juce::Slider delayReturnSlider;
+    juce::ComboBox delayTimeBox;
+    juce::Slider delayFeedbackSlider;
+    juce::Slider recordQuantizeSlider;
+    juce::ToggleButton recordButton { "Record" };
+    juce::ComboBox recordModeBox;
+    juce::Slider morphSlider;
+    juce::ComboBox morphTargetBox;
+    juce::ComboBox morphModeBox;
     juce::Slider attackSlider;
     juce::Slider decaySlider;
     juce::Slider sustainSlider;
     juce::Slider releaseSlider;
+    juce::Slider polyphonySlider;
+    juce::Slider chokeSlider;
+    juce::Slider padLevelSlider;
+    juce::Slider padPanSlider;
+    juce::ToggleButton muteButton { "Mute" };
+    juce::ComboBox filterTypeBox;
+    juce::Slider cutoffSlider;
+    juce::Slider resonanceSlider;
+    juce::Slider driveSlider;
+    juce::Slider transientAttackSlider;
+    juce::Slider transientSustainSlider;
+    juce::Slider reverbSendSlider;
+    juce::Slider delaySendSlider;
+    juce::ToggleButton soloButton { "Solo" };
 
     juce::Label swingLabel { {}, "Swing" };
     juce::Label humanizeLabel { {}, "Humanize" };
     juce::Label fillsLabel { {}, "Fills" };
     juce::Label densityLabel { {}, "Density" };
     juce::Label velocityLabel { {}, "Velocity" };
+    juce::Label reverbReturnLabel { {}, "Reverb" };
+    juce::Label delayReturnLabel { {}, "Delay" };
+    juce::Label delayTimeLabel { {}, "Time" };
+    juce::Label delayFeedbackLabel { {}, "Feedback" };
+    juce::Label recordQuantizeLabel { {}, "Rec Quant" };
+    juce::Label morphLabel { {}, "Morph" };
+    juce::Label morphTargetLabel { {}, "Morph To" };
     juce::Label attackLabel { {}, "Attack" };
     juce::Label decayLabel { {}, "Decay" };
     juce::Label sustainLabel { {}, "Sustain" };
     juce::Label releaseLabel { {}, "Release" };
+    juce::Label polyphonyLabel { {}, "Voices" };
+    juce::Label chokeLabel { {}, "Choke" };
+    juce::Label padLevelLabel { {}, "Level" };
+    juce::Label padPanLabel { {}, "Pan" };
+    juce::Label filterTypeLabel { {}, "Filter" };
+    juce::Label cutoffLabel { {}, "Cutoff" };
+    juce::Label resonanceLabel { {}, "Reso" };
+    juce::Label driveLabel { {}, "Drive" };
+    juce::Label transientAttackLabel { {}, "Punch" };
+    juce::Label transientSustainLabel { {}, "Body" };
+    juce::Label reverbSendLabel { {}, "Rev Send" };
+    juce::Label delaySendLabel { {}, "Dly Send" };
 
     using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
 
     std::unique_ptr<SliderAttachment> swingAttachment;
     std::unique_ptr<SliderAttachment> humanizeAttachment;
     std::unique_ptr<SliderAttachment> fillsAttachment;
     std::unique_ptr<SliderAttachment> densityAttachment;
     std::unique_ptr<SliderAttachment> velocityAttachment;
+    std::unique_ptr<SliderAttachment> reverbReturnAttachment;
+    std::unique_ptr<SliderAttachment> delayReturnAttachment;
+    std::unique_ptr<ComboBoxAttachment> delayTimeAttachment;
+    std::unique_ptr<SliderAttachment> delayFeedbackAttachment;
+    std::unique_ptr<SliderAttachment> recordQuantizeAttachment;
+    std::unique_ptr<ButtonAttachment> recordAttachment;
+    std::unique_ptr<ComboBoxAttachment> recordModeAttachment;
+    std::unique_ptr<SliderAttachment> morphAttachment;
+    std::unique_ptr<ComboBoxAttachment> morphModeAttachment;
+    std::unique_ptr<SliderAttachment> padLevelAttachment;
+    std::unique_ptr<SliderAttachment> padPanAttachment;
+    std::unique_ptr<ButtonAttachment> muteAttachment;
+    std::unique_ptr<ButtonAttachment> soloAttachment;
+    std::unique_ptr<ComboBoxAttachment> filterTypeAttachment;
+    std::unique_ptr<SliderAttachment> cutoffAttachment;
+    std::unique_ptr<SliderAttachment> resonanceAttachment;
+    std::unique_ptr<SliderAttachment> driveAttachment;
+    std::unique_ptr<SliderAttachment> transientAttackAttachment;
+    std::unique_ptr<SliderAttachment> transientSustainAttachment;
+    std::unique_ptr<SliderAttachment> reverbSendAttachment;
+    std::unique_ptr<SliderAttachment> delaySendAttachment;
 
     std::vector<std::unique_ptr<SamplePad>> pads;
     std::unique_ptr<juce::FileChooser> fileChooser;
-    juce::WildcardFileFilter sampleFilter { "*.wav;*.wave;*.aiff;*.aif;*.flac", "*", "Samples" };
-    juce::FileBrowserComponent fileBrowser { juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
-                                             juce::File::getSpecialLocation(juce::File::userHomeDirectory),
-                                             &sampleFilter,
-                                             nullptr };
-    bool fileBrowserVisible = false;
+    // Built on first show, so opening an editor doesn't start the library indexer.
+    std::unique_ptr<SampleBrowser> sampleBrowser;
+    bool sampleBrowserVisible = false;
     int selectedPad = 0;
+    juce::String blockLoadText;
+    juce::String controllerText;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrooveSeqAudioProcessorEditor)
 };
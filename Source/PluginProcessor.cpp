@@ -1,30 +1,353 @@
 #include "PluginProcessor.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "PluginEditor.h"
 
+namespace
+{
+const juce::Identifier compactSamplesId { "compactSamples" };
+const juce::Identifier reverbIrId { "reverbIr" };
+const juce::Identifier sliceLoopsId { "sliceLoops" };
+const juce::Identifier sampleBudgetId { "sampleBudgetMb" };
+constexpr double kMaxSampleLengthSeconds = 10.0;
+constexpr size_t kMaxPadLayers = 32;
+constexpr double kMaxLoopLengthSeconds = 60.0;
+constexpr int kAnalysisWindowFrames = 4096;
+constexpr float kMinPadLevelDb = -60.0f;
+
+// Enough of each sample to cover the hit and its decay for classification.
+constexpr double kClassifySeconds = 1.0;
+
+// Notes that play pads 1-16, and so are what record mode captures.
+constexpr int kFirstPadNote = 36;
+
+// How often notes captured in record mode are written into the pattern, and
+// the voice pool is grown if the synth ran short of voices.
+constexpr int kRecordCommitHz = 30;
+
+// Streams of stepNoise(), one per humanized quantity.
+constexpr juce::uint64 kHumanizeTimingStream = 0x5851f42d4c957f2dull;
+constexpr juce::uint64 kHumanizeVelocityStream = 0x14057b7ef767814full;
+// Per-cycle draws of the probability morph.
+constexpr juce::uint64 kMorphStream = 0x2545f4914f6cdd1dull;
+
+// Continuing edits this close together share an undo step.
+constexpr juce::uint32 kContinuingEditMs = 1500;
+
+// Loop pads are re-stretched once the host tempo has held this long, to
+// within the tolerance, so a tempo ramp doesn't queue a render per block.
+constexpr juce::uint32 kTempoSettleMs = 250;
+constexpr double kTempoTolerance = 0.01;
+
+// Patterns kept from one imported MIDI file; 128 bars.
+constexpr size_t kMaxBankPatterns = 64;
+
+// Delay time choices, in beats: 1/4, 1/8, dotted 1/8, 1/8 triplet, 1/16.
+constexpr std::array<float, 5> kDelayBeats { 1.0f, 0.5f, 0.75f, 1.0f / 3.0f, 0.25f };
+
+Sequencer::Role classifySample(const PadSound& sound, SampleAnalysis::FeatureExtractor& extractor)
+{
+    const auto& data = sound.getData();
+    const auto region = sound.getRegion();
+    const int frames = juce::jmin(region.getLength(), static_cast<int>(kClassifySeconds * data.getSampleRate()));
+    if (frames <= 0)
+        return Sequencer::Role::other;
+
+    std::vector<float> mono(static_cast<size_t>(frames), 0.0f);
+    std::vector<float> channel(static_cast<size_t>(frames));
+
+    for (int ch = 0; ch < data.getNumChannels(); ++ch)
+    {
+        data.decode(ch, region.getStart(), frames, channel.data());
+        juce::FloatVectorOperations::add(mono.data(), channel.data(), frames);
+    }
+
+    juce::FloatVectorOperations::multiply(mono.data(), 1.0f / static_cast<float>(data.getNumChannels()), frames);
+    return SampleAnalysis::classify(extractor.extract(mono.data(), frames, data.getSampleRate()));
+}
+
+SampleAnalysis::OnsetDetector detectOnsets(const SampleData& data)
+{
+    SampleAnalysis::OnsetDetector detector(data.getSampleRate());
+    std::array<float, kAnalysisWindowFrames> mono;
+    std::array<float, kAnalysisWindowFrames> channel;
+    const float channelGain = 1.0f / static_cast<float>(data.getNumChannels());
+
+    for (int start = 0; start < data.getNumFrames(); start += kAnalysisWindowFrames)
+    {
+        const int count = juce::jmin(kAnalysisWindowFrames, data.getNumFrames() - start);
+        juce::FloatVectorOperations::clear(mono.data(), count);
+
+        for (int ch = 0; ch < data.getNumChannels(); ++ch)
+        {
+            data.decode(ch, start, count, channel.data());
+            juce::FloatVectorOperations::addWithMultiply(mono.data(), channel.data(), channelGain, count);
+        }
+
+        detector.process(mono.data(), count);
+    }
+
+    return detector;
+}
+
+// Noise in [-1, 1) that depends only on the step, pad and stream, so an
+// offline bounce humanizes a passage the same way every time it is rendered,
+// whatever the block size. splitmix64 finalizer.
+float stepNoise(juce::int64 step, int pad, juce::uint64 stream)
+{
+    auto x = static_cast<juce::uint64>(step) * 0x9e3779b97f4a7c15ull;
+    x ^= (static_cast<juce::uint64>(pad) << 48) ^ stream;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+
+    return static_cast<float>(x >> 40) / static_cast<float>(1 << 23) - 1.0f;
+}
+
+// The strongest onsets, at most maxSlices of them, in time order. A loop with
+// no detectable hit becomes one slice.
+std::vector<int> pickSliceStarts(const SampleAnalysis::OnsetDetector& detector, int maxSlices)
+{
+    const auto& onsets = detector.getOnsets();
+    const auto& strengths = detector.getStrengths();
+
+    std::vector<size_t> order(onsets.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    if (static_cast<int>(order.size()) > maxSlices)
+    {
+        std::partial_sort(order.begin(), order.begin() + maxSlices, order.end(), [&strengths](size_t a, size_t b)
+        {
+            return strengths[a] > strengths[b];
+        });
+        order.resize(static_cast<size_t>(maxSlices));
+    }
+
+    std::vector<int> starts;
+    for (auto index : order)
+        starts.push_back(static_cast<int>(onsets[index]));
+
+    std::sort(starts.begin(), starts.end());
+
+    if (starts.empty())
+        starts.push_back(0);
+
+    return starts;
+}
+} // namespace
+
+class GrooveSeqAudioProcessor::PatternEdit : public juce::UndoableAction
+{
+public:
+    PatternEdit(GrooveSeqAudioProcessor& owner, PatternSnapshot::Ptr beforeEdit, PatternSnapshot::Ptr afterEdit)
+        : processor(owner)
+        , before(std::move(beforeEdit))
+        , after(std::move(afterEdit))
+    {
+    }
+
+    bool perform() override
+    {
+        processor.restorePattern(after);
+        return true;
+    }
+
+    bool undo() override
+    {
+        processor.restorePattern(before);
+        return true;
+    }
+
+    // Runs of pattern changes in one step only need the first and last state.
+    juce::UndoableAction* createCoalescedAction(juce::UndoableAction* next) override
+    {
+        if (auto* edit = dynamic_cast<PatternEdit*>(next))
+            return new PatternEdit(processor, before, edit->after);
+
+        return nullptr;
+    }
+
+    // Snapshots share unchanged rows, so an edit costs well under a kilobyte.
+    int getSizeInUnits() override { return 1; }
+
+private:
+    GrooveSeqAudioProcessor& processor;
+    PatternSnapshot::Ptr before;
+    PatternSnapshot::Ptr after;
+};
+
+class GrooveSeqAudioProcessor::EnvelopeEdit : public juce::UndoableAction
+{
+public:
+    EnvelopeEdit(GrooveSeqAudioProcessor& owner, int padIndex, juce::ADSR::Parameters beforeEdit, juce::ADSR::Parameters afterEdit)
+        : processor(owner)
+        , pad(padIndex)
+        , before(beforeEdit)
+        , after(afterEdit)
+    {
+    }
+
+    bool perform() override
+    {
+        processor.applyPadAdsr(pad, after);
+        return true;
+    }
+
+    bool undo() override
+    {
+        processor.applyPadAdsr(pad, before);
+        return true;
+    }
+
+    juce::UndoableAction* createCoalescedAction(juce::UndoableAction* next) override
+    {
+        auto* edit = dynamic_cast<EnvelopeEdit*>(next);
+        if (edit == nullptr || edit->pad != pad)
+            return nullptr;
+
+        return new EnvelopeEdit(processor, pad, before, edit->after);
+    }
+
+    int getSizeInUnits() override { return 1; }
+
+private:
+    GrooveSeqAudioProcessor& processor;
+    int pad = 0;
+    juce::ADSR::Parameters before;
+    juce::ADSR::Parameters after;
+};
+
+class GrooveSeqAudioProcessor::PadAssignmentEdit : public juce::UndoableAction
+{
+public:
+    PadAssignmentEdit(GrooveSeqAudioProcessor& owner, int padIndex, PadAssignment beforeEdit, PadAssignment afterEdit)
+        : processor(owner)
+        , pad(padIndex)
+        , before(std::move(beforeEdit))
+        , after(std::move(afterEdit))
+    {
+    }
+
+    bool perform() override
+    {
+        processor.restorePadAssignment(pad, after);
+        return true;
+    }
+
+    bool undo() override
+    {
+        processor.restorePadAssignment(pad, before);
+        return true;
+    }
+
+    // Kilobytes of sample audio the history keeps in RAM through this edit.
+    // Mapped samples are left out; the OS can drop their pages.
+    int getSizeInUnits() override
+    {
+        return static_cast<int>((heapBytes(before) + heapBytes(after)) / 1024) + 1;
+    }
+
+private:
+    static size_t heapBytes(const PadAssignment& assignment)
+    {
+        if (assignment.sound == nullptr)
+            return 0;
+
+        size_t total = 0;
+        const auto add = [&total](const std::shared_ptr<const SampleData>& data)
+        {
+            if (data != nullptr && !data->isMapped())
+                total += data->getMemoryBytes();
+        };
+
+        for (const auto& layer : assignment.sound->getLayers())
+            add(layer.data);
+
+        if (const auto* stretch = assignment.sound->getStretch())
+        {
+            for (const auto& layer : stretch->layers)
+                add(layer);
+        }
+
+        return total;
+    }
+
+    GrooveSeqAudioProcessor& processor;
+    int pad = 0;
+    PadAssignment before;
+    PadAssignment after;
+};
+
 GrooveSeqAudioProcessor::GrooveSeqAudioProcessor()
     : AudioProcessor(BusesProperties()
                          .withInput("Input", juce::AudioChannelSet::stereo(), false)
                          .withOutput("Output", juce::AudioChannelSet::stereo(), true))
     , parameters(*this, nullptr, "PARAMETERS", createParameterLayout())
 {
+    parameterPointers.swing = parameters.getRawParameterValue("swing");
+    parameterPointers.humanize = parameters.getRawParameterValue("humanize");
+    parameterPointers.fills = parameters.getRawParameterValue("fills");
+    parameterPointers.density = parameters.getRawParameterValue("density");
+    parameterPointers.velocity = parameters.getRawParameterValue("velocity");
+    parameterPointers.record = parameters.getRawParameterValue("record");
+    parameterPointers.recordMode = parameters.getRawParameterValue("recordMode");
+    parameterPointers.recordQuantize = parameters.getRawParameterValue("recordQuantize");
+    parameterPointers.morph = parameters.getRawParameterValue("morph");
+    parameterPointers.morphMode = parameters.getRawParameterValue("morphMode");
+    parameterPointers.reverbReturn = parameters.getRawParameterValue("reverbReturn");
+    parameterPointers.delayReturn = parameters.getRawParameterValue("delayReturn");
+    parameterPointers.delayTime = parameters.getRawParameterValue("delayTime");
+    parameterPointers.delayFeedback = parameters.getRawParameterValue("delayFeedback");
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        auto& padPointers = parameterPointers.pads[static_cast<size_t>(pad)];
+        padPointers.level = parameters.getRawParameterValue(padParamId(pad, "level"));
+        padPointers.pan = parameters.getRawParameterValue(padParamId(pad, "pan"));
+        padPointers.mute = parameters.getRawParameterValue(padParamId(pad, "mute"));
+        padPointers.solo = parameters.getRawParameterValue(padParamId(pad, "solo"));
+        padPointers.filterType = parameters.getRawParameterValue(padParamId(pad, "filter"));
+        padPointers.cutoff = parameters.getRawParameterValue(padParamId(pad, "cutoff"));
+        padPointers.resonance = parameters.getRawParameterValue(padParamId(pad, "reso"));
+        padPointers.drive = parameters.getRawParameterValue(padParamId(pad, "drive"));
+        padPointers.attack = parameters.getRawParameterValue(padParamId(pad, "attack"));
+        padPointers.sustain = parameters.getRawParameterValue(padParamId(pad, "sustain"));
+        padPointers.reverbSend = parameters.getRawParameterValue(padParamId(pad, "reverb"));
+        padPointers.delaySend = parameters.getRawParameterValue(padParamId(pad, "delay"));
+    }
+
     formatManager.registerBasicFormats();
 
     synth.setNoteStealingEnabled(true);
-    for (int i = 0; i < 32; ++i)
-        synth.addVoice(new juce::SamplerVoice());
-
-    std::array<bool, Sequencer::kPads> defaultActivePads;
-    defaultActivePads.fill(true);
-    sequencer.generate(0.6f,
-                       0.15f,
-                       juce::Random::getSystemRandom().nextInt(),
-                       defaultActivePads);
+    for (int i = 0; i < kInitialVoices; ++i)
+        synth.addVoice(new PadVoice());
 
     const juce::ADSR::Parameters defaultAdsr { 0.002f, 0.12f, 0.7f, 0.12f };
     padAdsr.fill(defaultAdsr);
+
+    padPolyphony.fill(PadSynth::kDefaultPadPolyphony);
+
+    // Closed hat (pad 2) and open hat (pad 3) choke each other by default.
+    setPadChokeGroup(2, 1);
+    setPadChokeGroup(3, 1);
+
+    currentPattern = PatternSnapshot::make(sequencer.getPattern());
+    livePattern.store(currentPattern.get());
+
+    startTimerHz(kRecordCommitHz);
 }
 
-GrooveSeqAudioProcessor::~GrooveSeqAudioProcessor() = default;
+GrooveSeqAudioProcessor::~GrooveSeqAudioProcessor()
+{
+    stopTimer();
+}
 
 const juce::String GrooveSeqAudioProcessor::getName() const
 {
@@ -48,7 +371,8 @@ bool GrooveSeqAudioProcessor::isMidiEffect() const
 
 double GrooveSeqAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const auto params = readParameters();
+    return padTailSeconds.load() + sendEffects.getTailSeconds(params.sends, hostBpm.load(std::memory_order_relaxed));
 }
 
 int GrooveSeqAudioProcessor::getNumPrograms() { return 1; }
@@ -59,8 +383,169 @@ void GrooveSeqAudioProcessor::changeProgramName(int, const juce::String&) {}
 
 void GrooveSeqAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused(samplesPerBlock);
-    synth.setCurrentPlaybackSampleRate(sampleRate);
+    generateDefaultPattern();
+
+    cachedSampleRate = sampleRate;
+    samplesPerMs = sampleRate / 1000.0;
+
+    const auto params = readParameters();
+    swingSmoothed.setCurrentAndTargetValue(params.swing);
+    humanizeSmoothed.setCurrentAndTargetValue(params.humanize);
+    velocitySmoothed.setCurrentAndTargetValue(params.velocity);
+    morphSmoothed.setCurrentAndTargetValue(params.morph);
+
+    preparedBlockSize = samplesPerBlock;
+    scratchBuffer.setSize(juce::jmax(2, getTotalNumOutputChannels()), samplesPerBlock, false, true, false);
+    blockMidi.ensureSize(kMidiReserveBytes);
+    subBlockHostMidi.ensureSize(kMidiReserveBytes);
+    subBlockMidi.ensureSize(kMidiReserveBytes);
+
+    {
+        const juce::SpinLock::ScopedLockType lock(previewLock);
+        previewMidi.ensureSize(kMidiReserveBytes);
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock(synthLock);
+        synth.setCurrentPlaybackSampleRate(sampleRate);
+
+        // The pool otherwise grows from the message-thread timer, which
+        // hosts may stall while bouncing, so offline renders start full.
+        if (isNonRealtime())
+        {
+            while (synth.getNumVoices() < PadSynth::kMaxVoices)
+                synth.addVoice(new PadVoice());
+        }
+
+        synth.prepare(sampleRate, samplesPerBlock);
+        prewarmVoices(samplesPerBlock);
+    }
+
+    setLatencySamples(synth.getLatencySamples());
+
+    sendEffects.prepare(sampleRate, samplesPerBlock);
+
+    if (isNonRealtime() && renderPool == nullptr)
+    {
+        auto pool = std::make_unique<RenderPool>(juce::SystemStats::getNumCpus() - 1);
+        const juce::SpinLock::ScopedLockType lock(synthLock);
+        renderPool = std::move(pool);
+    }
+}
+
+GrooveSeqAudioProcessor::ParameterSnapshot GrooveSeqAudioProcessor::readParameters() const
+{
+    ParameterSnapshot snapshot;
+    snapshot.swing = parameterPointers.swing->load(std::memory_order_relaxed);
+    snapshot.humanize = parameterPointers.humanize->load(std::memory_order_relaxed);
+    snapshot.fills = parameterPointers.fills->load(std::memory_order_relaxed);
+    snapshot.density = parameterPointers.density->load(std::memory_order_relaxed);
+    snapshot.velocity = parameterPointers.velocity->load(std::memory_order_relaxed);
+    snapshot.record = parameterPointers.record->load(std::memory_order_relaxed) >= 0.5f;
+    snapshot.recordReplace = parameterPointers.recordMode->load(std::memory_order_relaxed) >= 0.5f;
+    snapshot.recordQuantize = parameterPointers.recordQuantize->load(std::memory_order_relaxed) / 100.0f;
+    snapshot.morph = parameterPointers.morph->load(std::memory_order_relaxed) / 100.0f;
+    snapshot.morphMode = parameterPointers.morphMode->load(std::memory_order_relaxed) >= 0.5f ? PatternMorph::Mode::probability
+                                                                                               : PatternMorph::Mode::density;
+    snapshot.highQuality = isNonRealtime();
+
+    snapshot.sends.reverbReturnDb = parameterPointers.reverbReturn->load(std::memory_order_relaxed);
+    snapshot.sends.delayReturnDb = parameterPointers.delayReturn->load(std::memory_order_relaxed);
+    snapshot.sends.delayFeedback = parameterPointers.delayFeedback->load(std::memory_order_relaxed) / 100.0f;
+    const auto delayChoice = juce::jlimit(0, static_cast<int>(kDelayBeats.size()) - 1,
+                                          juce::roundToInt(parameterPointers.delayTime->load(std::memory_order_relaxed)));
+    snapshot.sends.delayBeats = kDelayBeats[static_cast<size_t>(delayChoice)];
+
+    for (size_t pad = 0; pad < snapshot.pads.size(); ++pad)
+    {
+        const auto& padPointers = parameterPointers.pads[pad];
+        auto& padSnapshot = snapshot.pads[pad];
+        padSnapshot.levelDb = padPointers.level->load(std::memory_order_relaxed);
+        padSnapshot.pan = padPointers.pan->load(std::memory_order_relaxed);
+        padSnapshot.mute = padPointers.mute->load(std::memory_order_relaxed) >= 0.5f;
+        padSnapshot.solo = padPointers.solo->load(std::memory_order_relaxed) >= 0.5f;
+        padSnapshot.reverbSend = padPointers.reverbSend->load(std::memory_order_relaxed) / 100.0f;
+        padSnapshot.delaySend = padPointers.delaySend->load(std::memory_order_relaxed) / 100.0f;
+
+        auto& inserts = padSnapshot.inserts;
+        inserts.filterType = static_cast<PadInsertChain::FilterType>(
+            juce::roundToInt(padPointers.filterType->load(std::memory_order_relaxed)));
+        inserts.cutoffHz = padPointers.cutoff->load(std::memory_order_relaxed);
+        inserts.resonance = padPointers.resonance->load(std::memory_order_relaxed);
+        inserts.driveDb = padPointers.drive->load(std::memory_order_relaxed);
+        inserts.attack = padPointers.attack->load(std::memory_order_relaxed) / 100.0f;
+        inserts.sustain = padPointers.sustain->load(std::memory_order_relaxed) / 100.0f;
+    }
+
+    return snapshot;
+}
+
+std::array<PadSynth::PadChannel, Sequencer::kPads> GrooveSeqAudioProcessor::computePadChannels(const ParameterSnapshot& params)
+{
+    bool anySolo = false;
+    for (const auto& pad : params.pads)
+        anySolo |= pad.solo;
+
+    std::array<PadSynth::PadChannel, Sequencer::kPads> channels;
+    for (size_t pad = 0; pad < channels.size(); ++pad)
+    {
+        const auto& settings = params.pads[pad];
+        auto& channel = channels[pad];
+        channel.inserts = settings.inserts;
+        channel.inserts.highQuality = params.highQuality;
+        channel.sends = { settings.reverbSend, settings.delaySend };
+
+        if (settings.mute || (anySolo && !settings.solo))
+        {
+            channel.gains = { 0.0f, 0.0f };
+            continue;
+        }
+
+        // Balance law: centre leaves both sides at unity, panning attenuates
+        // the opposite side.
+        const float level = juce::Decibels::decibelsToGain(settings.levelDb, kMinPadLevelDb);
+        channel.gains = { level * juce::jmin(1.0f, 1.0f - settings.pan),
+                          level * juce::jmin(1.0f, 1.0f + settings.pan) };
+    }
+
+    return channels;
+}
+
+void GrooveSeqAudioProcessor::prewarmVoices(int samplesPerBlock)
+{
+    // Touch every page of the loaded sample data so the first hits after
+    // transport start don't fault it in on the audio thread.
+    float sink = 0.0f;
+
+    for (auto* sound : padSounds)
+    {
+        if (sound == nullptr)
+            continue;
+
+        for (const auto& layer : sound->getLayers())
+            sink += layer.data->touchPages();
+    }
+
+    volatile float touched = sink;
+    juce::ignoreUnused(touched);
+
+    // Run each loaded pad once at zero velocity so voice state and the
+    // render path are warm, then silence everything before real playback.
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        if (padSounds[static_cast<size_t>(pad)] != nullptr)
+            synth.noteOn(1, 36 + pad, 0.0f);
+    }
+
+    // blockMidi may still hold the last block's events; don't replay them.
+    blockMidi.clear();
+    synth.beginBlock(samplesPerBlock);
+    synth.renderNextBlock(scratchBuffer, blockMidi, 0, samplesPerBlock);
+    synth.allNotesOff(0, false);
+
+    // The warm-up hits aren't real load; don't grow the pool for them.
+    synth.takeVoicePressure();
+    scratchBuffer.clear();
 }
 
 void GrooveSeqAudioProcessor::releaseResources() {}
@@ -85,12 +570,12 @@ void GrooveSeqAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
     const int numSamples = buffer.getNumSamples();
     buffer.clear();
 
-    juce::MidiBuffer midiOut;
-    midiOut.addEvents(midiMessages, 0, numSamples, 0);
+    blockMidi.clear();
+    blockMidi.addEvents(midiMessages, 0, numSamples, 0);
 
     {
         const juce::SpinLock::ScopedLockType lock(previewLock);
-        midiOut.addEvents(previewMidi, 0, numSamples, 0);
+        blockMidi.addEvents(previewMidi, 0, numSamples, 0);
         previewMidi.clear();
     }
 
@@ -101,10 +586,70 @@ void GrooveSeqAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
     if (playHead != nullptr && playHead->getCurrentPosition(posInfo))
         canPlay = posInfo.isPlaying;
 
+    const double bpm = (posInfo.bpm > 0.0) ? posInfo.bpm : 120.0;
+    hostBpm.store(bpm, std::memory_order_relaxed);
+
+    if (numSamples <= preparedBlockSize)
+    {
+        renderBlock(buffer, midiMessages, blockMidi, posInfo, canPlay);
+        return;
+    }
+
+    // Hosts may exceed the size promised in prepareToPlay. Everything is
+    // sized for that promise, so render in pieces of it rather than
+    // reallocating on the audio thread.
+    const double samplesPerQuarter = cachedSampleRate * 60.0 / bpm;
+    for (int start = 0; start < numSamples; start += preparedBlockSize)
+    {
+        const int length = juce::jmin(preparedBlockSize, numSamples - start);
+        juce::AudioBuffer<float> part(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, length);
+
+        subBlockHostMidi.clear();
+        subBlockHostMidi.addEvents(midiMessages, start, length, -start);
+        subBlockMidi.clear();
+        subBlockMidi.addEvents(blockMidi, start, length, -start);
+
+        renderBlock(part, subBlockHostMidi, subBlockMidi, posInfo, canPlay);
+
+        posInfo.ppqPosition += length / samplesPerQuarter;
+        posInfo.timeInSamples += length;
+    }
+}
+
+void GrooveSeqAudioProcessor::renderBlock(juce::AudioBuffer<float>& buffer,
+                                          const juce::MidiBuffer& hostMidi,
+                                          juce::MidiBuffer& midiOut,
+                                          const juce::AudioPlayHead::CurrentPositionInfo& posInfo,
+                                          bool canPlay)
+{
+    const auto blockStart = juce::Time::getHighResolutionTicks();
+    const int numSamples = buffer.getNumSamples();
+    const double bpm = (posInfo.bpm > 0.0) ? posInfo.bpm : 120.0;
+
+    // Stopped, nothing to trigger and nothing ringing: the cleared buffer is
+    // already the output, and is flagged as cleared for hosts that check.
+    if (!canPlay && midiOut.isEmpty() && sendEffects.isIdle())
+    {
+        const juce::SpinLock::ScopedLockType lock(synthLock);
+        if (synth.isIdle())
+            return;
+    }
+
+    // Ramp each timing parameter from last block's value to this one over the
+    // block, so events inside the block see interpolated automation.
+    const auto params = readParameters();
+    swingSmoothed.reset(numSamples);
+    swingSmoothed.setTargetValue(params.swing);
+    humanizeSmoothed.reset(numSamples);
+    humanizeSmoothed.setTargetValue(params.humanize);
+    velocitySmoothed.reset(numSamples);
+    velocitySmoothed.setTargetValue(params.velocity);
+    morphSmoothed.reset(numSamples);
+    morphSmoothed.setTargetValue(params.morph);
+
     if (canPlay)
     {
-        const double bpm = (posInfo.bpm > 0.0) ? posInfo.bpm : 120.0;
-        const double sampleRate = getSampleRate();
+        const double sampleRate = cachedSampleRate;
         const double samplesPerQuarter = sampleRate * 60.0 / bpm;
         const double stepPpq = 0.25; // 16th note
         const double barLengthPpq = (posInfo.timeSigDenominator > 0)
@@ -117,38 +662,47 @@ void GrooveSeqAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
 
         const double cycleStartPpq = std::floor(startPpq / cycleLengthPpq) * cycleLengthPpq;
 
-        const float swingPercent = parameters.getRawParameterValue("swing")->load();
-        const float humanizeMs = parameters.getRawParameterValue("humanize")->load();
-        const float velocityRand = parameters.getRawParameterValue("velocity")->load() / 100.0f;
-
         const double stepSamples = samplesPerQuarter / 4.0;
-        const double swingSamples = stepSamples * (swingPercent / 100.0) * 0.5;
-        const double humanizeSamples = (humanizeMs / 1000.0) * sampleRate;
+        int smoothedPosition = 0;
 
-        std::array<std::array<bool, Sequencer::kSteps>, Sequencer::kPads> patternSnapshot;
+        Sequencer::Pattern patternSnapshot;
+        const bool morphing = readLivePattern(patternSnapshot, blockMorph);
+
+        auto cycleStepOf = [&](int step)
         {
-            const juce::SpinLock::ScopedLockType lock(sequenceLock);
-            patternSnapshot = sequencer.getPattern();
-        }
+            const int stepInCycle = static_cast<int>(std::floor((step * stepPpq - cycleStartPpq) / stepPpq));
+            return ((stepInCycle % Sequencer::kSteps) + Sequencer::kSteps) % Sequencer::kSteps;
+        };
+
+        currentStep.store(cycleStepOf(static_cast<int>(std::floor(startPpq / stepPpq))), std::memory_order_relaxed);
+
+        if (params.record)
+            captureRecordedNotes(hostMidi, startPpq, endPpq, cycleStartPpq, samplesPerQuarter, params);
 
-        const int startStep = static_cast<int>(std::floor(startPpq / stepPpq));
-        const int endStep = static_cast<int>(std::floor(endPpq / stepPpq));
+        // Micro-timing moves hits up to half a step either way, so look at the
+        // steps just outside the block too.
+        const int startStep = static_cast<int>(std::floor(startPpq / stepPpq - 0.5));
+        const int endStep = static_cast<int>(std::floor(endPpq / stepPpq + 0.5));
 
         for (int step = startStep; step <= endStep; ++step)
         {
             const double stepTimePpq = step * stepPpq;
             const double offsetSamples = (stepTimePpq - startPpq) * samplesPerQuarter;
-            if (offsetSamples < 0.0 || offsetSamples >= numSamples)
-                continue;
+            const int stepInCycle = cycleStepOf(step);
 
-            const int stepInCycle = static_cast<int>(std::floor((stepTimePpq - cycleStartPpq) / stepPpq))
-                % Sequencer::kSteps;
+            // Advance the per-block parameter ramps to this step so automation
+            // lands between events instead of at buffer boundaries.
+            const int stepPosition = juce::jlimit(0, numSamples, static_cast<int>(offsetSamples));
+            const int advance = juce::jmax(0, stepPosition - smoothedPosition);
+            smoothedPosition += advance;
 
-            if (stepInCycle < 0)
-                continue;
+            const float swingPercent = swingSmoothed.skip(advance);
+            const float humanizeMs = humanizeSmoothed.skip(advance);
+            const float velocityRand = velocitySmoothed.skip(advance) / 100.0f;
+            const float morph = morphSmoothed.skip(advance);
 
-            if (step == startStep)
-                currentStep.store(stepInCycle, std::memory_order_relaxed);
+            const double swingSamples = stepSamples * (swingPercent / 100.0) * 0.5;
+            const double humanizeSamples = humanizeMs * samplesPerMs;
 
             double swungOffset = offsetSamples;
             if (stepInCycle % 2 == 1)
@@ -156,24 +710,42 @@ void GrooveSeqAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
 
             for (int pad = 0; pad < Sequencer::kPads; ++pad)
             {
-                if (!patternSnapshot[pad][stepInCycle])
+                PatternMorph::Hit hit { patternSnapshot.active[pad][stepInCycle],
+                                        patternSnapshot.velocity[pad][stepInCycle],
+                                        patternSnapshot.offset[pad][stepInCycle] };
+                if (morphing)
+                {
+                    const float chance = (stepNoise(step, pad, kMorphStream) + 1.0f) * 0.5f;
+                    hit = blockMorph.evaluate(pad, stepInCycle, morph, params.morphMode, chance);
+                }
+
+                if (!hit.active)
+                    continue;
+
+                // The hit belongs to the block its micro-timed grid position
+                // falls in; swing and humanize then move it within the block.
+                const double microOffset = hit.offset * stepSamples;
+                const double hitPosition = offsetSamples + microOffset;
+                if (hitPosition < 0.0 || hitPosition >= numSamples)
                     continue;
 
-                double eventOffset = swungOffset;
+                double eventOffset = swungOffset + microOffset;
 
                 if (humanizeSamples > 0.0)
                 {
-                    const double r = random.nextFloat() * 2.0 - 1.0;
+                    const double r = params.highQuality ? stepNoise(step, pad, kHumanizeTimingStream)
+                                                        : random.nextFloat() * 2.0 - 1.0;
                     eventOffset += r * humanizeSamples;
                 }
 
                 const int sampleOffset = juce::jlimit(0, numSamples - 1, static_cast<int>(std::round(eventOffset)));
                 const int midiNote = 36 + pad;
 
-                const float baseVelocity = 0.78f;
+                const float baseVelocity = hit.velocity;
                 const float randSpan = velocityRand * 0.5f;
-                const float v = juce::jlimit(0.05f, 1.0f,
-                                             baseVelocity + ((random.nextFloat() * 2.0f - 1.0f) * randSpan));
+                const float velocityNoise = params.highQuality ? stepNoise(step, pad, kHumanizeVelocityStream)
+                                                               : random.nextFloat() * 2.0f - 1.0f;
+                const float v = juce::jlimit(0.05f, 1.0f, baseVelocity + velocityNoise * randSpan);
                 const auto velocity = static_cast<juce::uint8>(juce::roundToInt(v * 127.0f));
 
                 midiOut.addEvent(juce::MidiMessage::noteOn(1, midiNote, velocity), sampleOffset);
@@ -181,136 +753,1431 @@ void GrooveSeqAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
         }
     }
 
+    const auto padChannels = computePadChannels(params);
+
+    const PadSynth::SendBuses sendBuses { &sendEffects.getBusInput(SendEffects::reverbBus),
+                                          &sendEffects.getBusInput(SendEffects::delayBus) };
+    PadSynth::SendActivity sendActivity{};
+
     {
         const juce::SpinLock::ScopedLockType lock(synthLock);
+        sendEffects.beginBlock(numSamples);
+        synth.setRenderPool(isNonRealtime() ? renderPool.get() : nullptr);
+        synth.beginBlock(numSamples, params.highQuality, bpm);
         synth.renderNextBlock(buffer, midiOut, 0, numSamples);
+        sendActivity = synth.mixPads(buffer, sendBuses, padChannels);
     }
-}
 
-bool GrooveSeqAudioProcessor::hasEditor() const
-{
-    return true;
-}
+    sendEffects.process(buffer, numSamples, params.sends, bpm, sendActivity);
 
-juce::AudioProcessorEditor* GrooveSeqAudioProcessor::createEditor()
-{
-    return new GrooveSeqAudioProcessorEditor(*this);
-}
+    // Offline renders may take as long as they like.
+    if (!params.highQuality && numSamples > 0)
+    {
+        const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - blockStart);
+        const double load = seconds * cachedSampleRate / numSamples;
 
-void GrooveSeqAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
-{
-    auto state = parameters.copyState();
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+        if (load > peakBlockLoad.load(std::memory_order_relaxed))
+            peakBlockLoad.store(load, std::memory_order_relaxed);
+
+        if (load > 1.0)
+            blockOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
-void GrooveSeqAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+GrooveSeqAudioProcessor::BlockLoad GrooveSeqAudioProcessor::takeBlockLoad()
 {
-    std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
-    if (xmlState != nullptr && xmlState->hasTagName(parameters.state.getType()))
-        parameters.replaceState(juce::ValueTree::fromXml(*xmlState));
+    return { peakBlockLoad.exchange(0.0, std::memory_order_relaxed), blockOverruns.load(std::memory_order_relaxed) };
 }
 
-bool GrooveSeqAudioProcessor::loadSample(int padIndex, const juce::File& file)
+void GrooveSeqAudioProcessor::captureRecordedNotes(const juce::MidiBuffer& midi,
+                                                   double startPpq,
+                                                   double endPpq,
+                                                   double cycleStartPpq,
+                                                   double samplesPerQuarter,
+                                                   const ParameterSnapshot& params)
 {
-    if (padIndex < 0 || padIndex >= Sequencer::kPads)
-        return false;
-
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
-    if (reader == nullptr)
-        return false;
-
+    constexpr double stepPpq = 0.25;
 
-    juce::BigInteger range;
-    const int midiNote = 36 + padIndex;
-    range.setBit(midiNote);
-
-    auto* sound = new juce::SamplerSound(
-        file.getFileNameWithoutExtension(),
-        *reader,
-        range,
-        midiNote,
-        0.0,   // attack
-        0.1,   // release
-        10.0   // max length
-    );
-    sound->setEnvelopeParameters(getPadAdsr(padIndex));
+    // How late playback puts odd steps; hits are measured against that grid.
+    const double swingSteps = params.swing / 100.0 * 0.5;
 
+    // Replace mode wipes each step as the playhead enters the window that
+    // quantizes to it, half a step early (less swing's share), so hits played
+    // slightly ahead of the step survive. Erases are queued before this
+    // block's notes.
+    if (params.recordReplace)
     {
-        const juce::SpinLock::ScopedLockType lock(synthLock);
-        removePadSound(padIndex);
-        synth.addSound(sound);
-        padSounds[padIndex] = sound;
+        const double windowStart = 0.5 - swingSteps * 0.5;
+        for (auto step = static_cast<int>(std::ceil(startPpq / stepPpq + windowStart)); (step - windowStart) * stepPpq < endPpq; ++step)
+        {
+            const int stepInCycle = static_cast<int>(std::floor((step * stepPpq - cycleStartPpq) / stepPpq));
+            recorder.eraseStep(((stepInCycle % Sequencer::kSteps) + Sequencer::kSteps) % Sequencer::kSteps);
+        }
     }
-    padNames[padIndex] = file.getFileNameWithoutExtension();
 
-    return true;
+    for (const auto metadata : midi)
+    {
+        const auto message = metadata.getMessage();
+        const int pad = message.getNoteNumber() - kFirstPadNote;
+        if (!message.isNoteOn() || pad < 0 || pad >= Sequencer::kPads)
+            continue;
+
+        const double ppq = startPpq + metadata.samplePosition / samplesPerQuarter;
+        recorder.recordHit(pad, (ppq - cycleStartPpq) / stepPpq, message.getFloatVelocity(), params.recordQuantize, swingSteps);
+    }
 }
 
-void GrooveSeqAudioProcessor::removePadSound(int padIndex)
+void GrooveSeqAudioProcessor::generateDefaultPattern()
 {
-    auto* target = padSounds[padIndex];
-    if (target == nullptr)
+    // Deferred from construction to the first prepareToPlay or editor, which
+    // come before anything can edit the pattern.
+    if (!defaultPatternPending.exchange(false))
         return;
 
-    for (int i = synth.getNumSounds(); --i >= 0;)
+    const auto generate = [](Sequencer& pattern)
     {
-        if (synth.getSound(i).get() == target)
-        {
-            synth.removeSound(i);
-            break;
-        }
-    }
+        pattern.generate(0.6f,
+                         0.15f,
+                         juce::Random::getSystemRandom().nextInt(),
+                         Sequencer::getDefaultRoles());
+    };
 
-    padSounds[padIndex] = nullptr;
-    padNames[padIndex].clear();
+    editPattern(generate, false);
 }
 
-juce::String GrooveSeqAudioProcessor::getPadName(int padIndex) const
+void GrooveSeqAudioProcessor::growVoicePool()
 {
-    if (padIndex < 0 || padIndex >= Sequencer::kPads)
-        return {};
+    if (!synth.takeVoicePressure() || synth.getNumVoices() >= PadSynth::kMaxVoices)
+        return;
 
-    return padNames[padIndex];
+    const juce::SpinLock::ScopedLockType lock(synthLock);
+    for (int i = 0; i < kVoiceGrowth && synth.getNumVoices() < PadSynth::kMaxVoices; ++i)
+        synth.addVoice(new PadVoice());
 }
 
-void GrooveSeqAudioProcessor::generatePattern()
+void GrooveSeqAudioProcessor::timerCallback()
 {
-    const float density = parameters.getRawParameterValue("density")->load() / 100.0f;
-    const float fills = parameters.getRawParameterValue("fills")->load() / 100.0f;
+    growVoicePool();
+    serviceControlSurface();
+    updateLoopStretches();
+    updateReverb();
+
+    recordedEvents.clear();
+    recorder.popAll(recordedEvents);
+    if (recordedEvents.empty())
+        return;
 
-    std::array<bool, Sequencer::kPads> activePads{};
-    bool anyPadHasSample = false;
+    const juce::ScopedLock edit(editLock);
+    beginEdit("Record", true);
+    editPattern([this](Sequencer& pattern)
     {
-        const juce::SpinLock::ScopedLockType lock(synthLock);
-        for (int i = 0; i < Sequencer::kPads; ++i)
-        {
-            const bool active = padSounds[static_cast<size_t>(i)] != nullptr;
-            activePads[static_cast<size_t>(i)] = active;
-            anyPadHasSample |= active;
-        }
-    }
-
-    if (!anyPadHasSample)
-        activePads.fill(true);
-
-    const juce::SpinLock::ScopedLockType lock(sequenceLock);
-    sequencer.generate(density,
-                       fills,
-                       juce::Random::getSystemRandom().nextInt(),
-                       activePads);
+        for (const auto& event : recordedEvents)
+            PatternRecorder::apply(event, pattern);
+    });
 }
 
-bool GrooveSeqAudioProcessor::getStepState(int pad, int step) const
+void GrooveSeqAudioProcessor::serviceControlSurface()
 {
-    const juce::SpinLock::ScopedLockType lock(sequenceLock);
-    return sequencer.isStepActive(pad, step);
+    static_assert(ControlProtocol::kPads == Sequencer::kPads && ControlProtocol::kSteps == Sequencer::kSteps,
+                  "the control segment mirrors the pattern");
+
+    if (!controlSurface.isOpen())
+        return;
+
+    controlSurface.drain([this](const ControlProtocol::Command& command)
+    {
+        const bool validPad = command.pad >= 0 && command.pad < Sequencer::kPads;
+
+        switch (command.type)
+        {
+            case ControlProtocol::CommandType::setStep:
+                if (validPad && command.step >= 0 && command.step < Sequencer::kSteps)
+                    setStepState(command.pad, command.step, command.value != 0);
+                break;
+
+            case ControlProtocol::CommandType::selectPattern:
+                selectBankPattern(command.value);
+                break;
+
+            case ControlProtocol::CommandType::loadSample:
+            {
+                const auto path = juce::String::fromUTF8(command.path);
+                if (validPad && juce::File::isAbsolutePath(path))
+                    loadSample(command.pad, juce::File(path));
+                break;
+            }
+        }
+    });
+
+    Sequencer::Pattern pattern;
+    {
+        const juce::SpinLock::ScopedLockType lock(sequenceLock);
+        currentPattern->decode(pattern);
+    }
+
+    ControlProtocol::State state;
+    state.currentStep = getCurrentStep();
+    state.bpm = static_cast<float>(hostBpm.load(std::memory_order_relaxed));
+    state.bankSize = getPatternBankSize();
+    state.selectedBankPattern = getSelectedBankPattern();
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        for (int step = 0; step < Sequencer::kSteps; ++step)
+        {
+            if (pattern.active[pad][step])
+                state.active[pad] |= 1u << step;
+
+            state.velocity[pad][step] = static_cast<std::uint8_t>(juce::roundToInt(pattern.velocity[pad][step] * ControlProtocol::kVelocitySteps));
+            state.offset[pad][step] = static_cast<std::int8_t>(juce::roundToInt(pattern.offset[pad][step] * ControlProtocol::kOffsetSteps));
+        }
+
+        getPadName(pad).copyToUTF8(state.padNames[pad], ControlProtocol::kMaxNameBytes);
+    }
+
+    controlSurface.publish(state);
+}
+
+void GrooveSeqAudioProcessor::beginEdit(const juce::String& name, bool continuing)
+{
+    const auto now = juce::Time::getMillisecondCounter();
+    const bool continues = continuing && name == continuingEdit && now - lastContinuingEditMs < kContinuingEditMs;
+
+    continuingEdit = continuing ? name : juce::String();
+    lastContinuingEditMs = now;
+
+    if (!continues)
+        undoManager.beginNewTransaction(name);
+}
+
+void GrooveSeqAudioProcessor::clearHistory()
+{
+    undoManager.clearUndoHistory();
+    continuingEdit.clear();
+}
+
+void GrooveSeqAudioProcessor::editPattern(const std::function<void(Sequencer&)>& edit, bool undoable)
+{
+    PatternSnapshot::Ptr before;
+    PatternSnapshot::Ptr after;
+
+    {
+        const juce::SpinLock::ScopedLockType lock(sequenceLock);
+        edit(sequencer);
+
+        before = currentPattern;
+        after = PatternSnapshot::make(sequencer.getPattern(), before);
+
+        // The working copy keeps the packed resolution, so it matches what plays.
+        Sequencer::Pattern packed;
+        after->decode(packed);
+        sequencer.setPattern(packed);
+
+        publishPattern(after);
+    }
+
+    if (undoable && after != before)
+        undoManager.perform(new PatternEdit(*this, std::move(before), std::move(after)));
+}
+
+void GrooveSeqAudioProcessor::restorePattern(const PatternSnapshot::Ptr& snapshot)
+{
+    const juce::SpinLock::ScopedLockType lock(sequenceLock);
+    if (snapshot == currentPattern)
+        return;
+
+    Sequencer::Pattern pattern;
+    snapshot->decode(pattern);
+    sequencer.setPattern(pattern);
+    publishPattern(snapshot);
+}
+
+void GrooveSeqAudioProcessor::publishPattern(PatternSnapshot::Ptr snapshot)
+{
+    if (snapshot == currentPattern)
+        return;
+
+    const auto previous = std::exchange(currentPattern, std::move(snapshot));
+    livePattern.store(currentPattern.get());
+
+    // Pattern A of the morph is the published pattern. publishMorph() also
+    // waits out any read still decoding previous.
+    publishMorph();
+}
+
+void GrooveSeqAudioProcessor::publishMorph()
+{
+    std::unique_ptr<const PatternMorph> morph;
+    if (morphTarget.has_value())
+    {
+        Sequencer::Pattern pattern;
+        currentPattern->decode(pattern);
+        morph = std::make_unique<PatternMorph>(pattern, *morphTarget);
+    }
+
+    const auto previous = std::exchange(currentMorph, std::move(morph));
+    liveMorph.store(currentMorph.get());
+
+    // A read that started before the stores may still be copying the old
+    // pattern or tables. Reads that start after them get the new ones, so
+    // once this one is done the old ones are free to go.
+    while (patternReadInProgress.load())
+        juce::Thread::yield();
+}
+
+bool GrooveSeqAudioProcessor::readLivePattern(Sequencer::Pattern& pattern, PatternMorph& morph)
+{
+    patternReadInProgress.store(true);
+    livePattern.load()->decode(pattern);
+
+    const auto* live = liveMorph.load();
+    if (live != nullptr)
+        morph = *live;
+
+    patternReadInProgress.store(false);
+    return live != nullptr;
+}
+
+GrooveSeqAudioProcessor::PadAssignments GrooveSeqAudioProcessor::getPadAssignments() const
+{
+    PadAssignments assignments;
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+        assignments[static_cast<size_t>(pad)] = { getPadSound(pad), getPadFile(pad), getPadRole(pad) };
+
+    return assignments;
+}
+
+void GrooveSeqAudioProcessor::recordPadAssignments(const PadAssignments& before)
+{
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto& previous = before[static_cast<size_t>(pad)];
+        auto current = PadAssignment { getPadSound(pad), getPadFile(pad), getPadRole(pad) };
+
+        if (current.sound != previous.sound)
+            undoManager.perform(new PadAssignmentEdit(*this, pad, previous, std::move(current)));
+    }
+}
+
+void GrooveSeqAudioProcessor::restorePadAssignment(int padIndex, const PadAssignment& assignment)
+{
+    if (getPadSound(padIndex) == assignment.sound)
+        return;
+
+    if (assignment.sound == nullptr)
+    {
+        const juce::SpinLock::ScopedLockType lock(synthLock);
+        removePadSound(padIndex);
+        return;
+    }
+
+    installPadSound(padIndex, assignment.sound.get(), assignment.file, assignment.role);
+    enforceSampleBudget();
+}
+
+bool GrooveSeqAudioProcessor::undo()
+{
+    const juce::ScopedLock edit(editLock);
+    continuingEdit.clear();
+    return undoManager.undo();
+}
+
+bool GrooveSeqAudioProcessor::redo()
+{
+    const juce::ScopedLock edit(editLock);
+    continuingEdit.clear();
+    return undoManager.redo();
+}
+
+bool GrooveSeqAudioProcessor::canUndo() const
+{
+    const juce::ScopedLock edit(editLock);
+    return undoManager.canUndo();
+}
+
+bool GrooveSeqAudioProcessor::canRedo() const
+{
+    const juce::ScopedLock edit(editLock);
+    return undoManager.canRedo();
+}
+
+juce::String GrooveSeqAudioProcessor::getUndoDescription() const
+{
+    const juce::ScopedLock edit(editLock);
+    return undoManager.getUndoDescription();
+}
+
+juce::String GrooveSeqAudioProcessor::getRedoDescription() const
+{
+    const juce::ScopedLock edit(editLock);
+    return undoManager.getRedoDescription();
+}
+
+void GrooveSeqAudioProcessor::addHistoryListener(juce::ChangeListener* listener)
+{
+    undoManager.addChangeListener(listener);
+}
+
+void GrooveSeqAudioProcessor::removeHistoryListener(juce::ChangeListener* listener)
+{
+    undoManager.removeChangeListener(listener);
+}
+
+bool GrooveSeqAudioProcessor::hasEditor() const
+{
+    return true;
+}
+
+juce::AudioProcessorEditor* GrooveSeqAudioProcessor::createEditor()
+{
+    generateDefaultPattern();
+    return new GrooveSeqAudioProcessorEditor(*this);
+}
+
+void GrooveSeqAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    // The session settings are added to a copy, so parameters.state is only
+    // ever touched by the value tree state itself.
+    auto state = parameters.copyState();
+    {
+        const juce::ScopedLock edit(editLock);
+        state.setProperty(sliceLoopsId, sliceMode.load(), nullptr);
+        state.setProperty(compactSamplesId, compactSamples.load(), nullptr);
+        state.setProperty(sampleBudgetId, sampleBudgetMb.load(), nullptr);
+        state.setProperty(reverbIrId, impulseResponseFile.getFullPathName(), nullptr);
+    }
+
+    std::unique_ptr<juce::XmlElement> xml(state.createXml());
+    copyXmlToBinary(*xml, destData);
+}
+
+void GrooveSeqAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+    if (xmlState == nullptr || !xmlState->hasTagName(parameters.state.getType()))
+        return;
+
+    auto state = juce::ValueTree::fromXml(*xmlState);
+    {
+        const juce::ScopedLock edit(editLock);
+        sliceMode = static_cast<bool>(state.getProperty(sliceLoopsId, false));
+        compactSamples = static_cast<bool>(state.getProperty(compactSamplesId, false));
+        sampleBudgetMb = juce::jmax(0, static_cast<int>(state.getProperty(sampleBudgetId, 0)));
+
+        const auto path = state.getProperty(reverbIrId).toString();
+        impulseResponseFile = path.isEmpty() ? juce::File() : juce::File(path);
+    }
+
+    parameters.replaceState(state);
+}
+
+bool GrooveSeqAudioProcessor::loadSample(int padIndex, const juce::File& file)
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return false;
+
+    if (isSliceMode())
+        return sliceSample(padIndex, file) > 0;
+
+    auto data = decodeSample(file, kMaxSampleLengthSeconds);
+    if (data == nullptr)
+        return false;
+
+    const juce::ScopedLock edit(editLock);
+    beginEdit("Load Sample");
+    const auto before = getPadAssignments();
+    installPadSound(padIndex,
+                    new PadSound(file.getFileNameWithoutExtension(), std::move(data), padIndex, 36 + padIndex),
+                    file);
+    recordPadAssignments(before);
+    enforceSampleBudget();
+    return true;
+}
+
+std::shared_ptr<const SampleData> GrooveSeqAudioProcessor::decodeSample(const juce::File& file, double maxLengthSeconds)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr)
+        return {};
+
+    const auto format = isCompactSampleStorage() ? SampleData::Format::int16 : SampleData::Format::float32;
+    return SampleData::fromReader(*reader, maxLengthSeconds, format);
+}
+
+int GrooveSeqAudioProcessor::sliceSample(int firstPad, const juce::File& file)
+{
+    if (firstPad < 0 || firstPad >= Sequencer::kPads)
+        return 0;
+
+    auto data = decodeSample(file, kMaxLoopLengthSeconds);
+    if (data == nullptr)
+        return 0;
+
+    const auto starts = pickSliceStarts(detectOnsets(*data), Sequencer::kPads - firstPad);
+    const auto name = file.getFileNameWithoutExtension();
+
+    const juce::ScopedLock edit(editLock);
+    beginEdit("Slice Loop");
+    const auto before = getPadAssignments();
+
+    // Every slice shares the one decoded buffer and plays its own range of it.
+    for (size_t i = 0; i < starts.size(); ++i)
+    {
+        const int pad = firstPad + static_cast<int>(i);
+        const int end = i + 1 < starts.size() ? starts[i + 1] : data->getNumFrames();
+
+        installPadSound(pad,
+                        new PadSound(name + " " + juce::String(static_cast<int>(i) + 1), data, pad, 36 + pad, { starts[i], end }),
+                        file);
+    }
+
+    recordPadAssignments(before);
+    writeSlicePattern(firstPad, starts, data->getNumFrames(), data->getSampleRate());
+    enforceSampleBudget();
+    return static_cast<int>(starts.size());
+}
+
+bool GrooveSeqAudioProcessor::addPadLayer(int padIndex, const juce::File& file, bool newVelocityZone)
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return false;
+
+    auto data = decodeSample(file, kMaxSampleLengthSeconds);
+    if (data == nullptr)
+        return false;
+
+    const juce::ScopedLock edit(editLock);
+    const auto current = getPadSound(padIndex);
+    if (current == nullptr)
+    {
+        beginEdit("Load Sample");
+        const auto before = getPadAssignments();
+        installPadSound(padIndex,
+                        new PadSound(file.getFileNameWithoutExtension(), std::move(data), padIndex, 36 + padIndex),
+                        file);
+        recordPadAssignments(before);
+        enforceSampleBudget();
+        return true;
+    }
+
+    auto layers = current->getLayers();
+    if (layers.size() >= kMaxPadLayers)
+        return false;
+
+    beginEdit(newVelocityZone ? "Add Velocity Layer" : "Add Round-Robin Sample");
+    const auto before = getPadAssignments();
+
+    if (newVelocityZone)
+    {
+        std::vector<int> tops;
+        for (const auto& layer : layers)
+        {
+            if (tops.empty() || tops.back() != layer.topVelocity)
+                tops.push_back(layer.topVelocity);
+        }
+
+        // The new zone is the loudest; all zones get an equal share of velocities.
+        const auto numZones = static_cast<int>(tops.size()) + 1;
+        for (auto& layer : layers)
+        {
+            const auto zone = static_cast<int>(std::distance(tops.begin(), std::find(tops.begin(), tops.end(), layer.topVelocity)));
+            layer.topVelocity = juce::roundToInt(127.0 * (zone + 1) / numZones);
+        }
+    }
+
+    layers.push_back({ std::move(data), {}, 127 });
+    replacePadLayers(padIndex, *current, std::move(layers), current->getCycle());
+    recordPadAssignments(before);
+    enforceSampleBudget();
+    return true;
+}
+
+void GrooveSeqAudioProcessor::clearPadLayers(int padIndex)
+{
+    const juce::ScopedLock edit(editLock);
+    const auto current = getPadSound(padIndex);
+    if (current == nullptr || current->getLayers().size() < 2)
+        return;
+
+    auto first = current->getLayers().front();
+    first.topVelocity = 127;
+
+    beginEdit("Clear Extra Layers");
+    const auto before = getPadAssignments();
+    replacePadLayers(padIndex, *current, { first }, current->getCycle());
+    recordPadAssignments(before);
+}
+
+int GrooveSeqAudioProcessor::getPadLayerCount(int padIndex) const
+{
+    const auto sound = getPadSound(padIndex);
+    return sound != nullptr ? static_cast<int>(sound->getLayers().size()) : 0;
+}
+
+PadSound::Cycle GrooveSeqAudioProcessor::getPadCycle(int padIndex) const
+{
+    const auto sound = getPadSound(padIndex);
+    return sound != nullptr ? sound->getCycle() : PadSound::Cycle::roundRobin;
+}
+
+void GrooveSeqAudioProcessor::setPadCycle(int padIndex, PadSound::Cycle cycle)
+{
+    const juce::ScopedLock edit(editLock);
+    const auto current = getPadSound(padIndex);
+    if (current == nullptr || current->getCycle() == cycle)
+        return;
+
+    beginEdit("Change Layer Cycle");
+    const auto before = getPadAssignments();
+    replacePadLayers(padIndex, *current, current->getLayers(), cycle);
+    recordPadAssignments(before);
+}
+
+int GrooveSeqAudioProcessor::getPadLoopSteps(int padIndex) const
+{
+    const auto sound = getPadSound(padIndex);
+    return sound != nullptr ? sound->getLoopSteps() : 0;
+}
+
+void GrooveSeqAudioProcessor::setPadLoop(int padIndex, bool shouldLoop)
+{
+    const juce::ScopedLock edit(editLock);
+    const auto current = getPadSound(padIndex);
+    if (current == nullptr || (current->getLoopSteps() > 0) == shouldLoop)
+        return;
+
+    int loopSteps = 0;
+    if (shouldLoop)
+    {
+        // Whole samples are taken to be loops a power of two 16ths long;
+        // slices span however many 16ths they last, up to the same 64.
+        const auto& layer = current->getLayers().front();
+        const double seconds = layer.region.getLength() / layer.data->getSampleRate();
+        const double bpm = hostBpm.load(std::memory_order_relaxed);
+        loopSteps = layer.region.getLength() < layer.data->getNumFrames()
+                        ? juce::jlimit(1, 2 * Sequencer::kSteps, juce::roundToInt(seconds * bpm / 15.0))
+                        : Sequencer::estimateLoopSteps(seconds, bpm);
+    }
+
+    beginEdit(shouldLoop ? "Loop to Tempo" : "Play as One-Shot");
+    const auto before = getPadAssignments();
+    auto* sound = copyPadSound(padIndex, *current, current->getLayers(), current->getCycle());
+    sound->setLoopSteps(loopSteps);
+    sound->setStretch({});
+    installPadSound(padIndex, sound, getPadFile(padIndex), getPadRole(padIndex));
+    recordPadAssignments(before);
+}
+
+void GrooveSeqAudioProcessor::replacePadLayers(int padIndex,
+                                               const PadSound& previous,
+                                               std::vector<PadSound::Layer> layers,
+                                               PadSound::Cycle cycle)
+{
+    installPadSound(padIndex,
+                    copyPadSound(padIndex, previous, std::move(layers), cycle),
+                    getPadFile(padIndex),
+                    getPadRole(padIndex));
+}
+
+PadSound* GrooveSeqAudioProcessor::copyPadSound(int padIndex,
+                                                const PadSound& previous,
+                                                std::vector<PadSound::Layer> layers,
+                                                PadSound::Cycle cycle) const
+{
+    auto* sound = new PadSound(previous.getName(), std::move(layers), padIndex, previous.getMidiRootNote(), cycle);
+    const auto& oldLayers = previous.getLayers();
+    const auto& newLayers = sound->getLayers();
+
+    // Layers keep their order, and new ones are added after the old.
+    const auto kept = juce::jmin(oldLayers.size(), newLayers.size());
+    for (size_t i = 0; i < kept; ++i)
+        sound->setLastUse(i, previous.getLastUse(i));
+
+    sound->setLoopSteps(previous.getLoopSteps());
+
+    const bool sameAudio = std::equal(newLayers.begin(), newLayers.end(), oldLayers.begin(), oldLayers.end(),
+                                      [](const PadSound::Layer& a, const PadSound::Layer& b)
+                                      {
+                                          return a.data == b.data && a.region == b.region;
+                                      });
+    if (sameAudio)
+        sound->setStretch(previous.getSharedStretch());
+
+    return sound;
+}
+
+void GrooveSeqAudioProcessor::updateReverb()
+{
+    bool reverbInUse = false;
+    for (const auto& padPointers : parameterPointers.pads)
+        reverbInUse = reverbInUse || padPointers.reverbSend->load(std::memory_order_relaxed) > 0.0f;
+
+    sendEffects.updateImpulseResponse(getImpulseResponseFile(), reverbInUse);
+}
+
+void GrooveSeqAudioProcessor::updateLoopStretches()
+{
+    const double bpm = hostBpm.load(std::memory_order_relaxed);
+    const auto now = juce::Time::getMillisecondCounter();
+    if (std::abs(bpm - settlingBpm) > kTempoTolerance)
+    {
+        settlingBpm = bpm;
+        settlingSinceMs = now;
+    }
+
+    if (now - settlingSinceMs < kTempoSettleMs)
+        return;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        auto& request = stretchRequests[static_cast<size_t>(pad)];
+        const auto sound = getPadSound(pad);
+        const auto* stretch = sound != nullptr ? sound->getStretch() : nullptr;
+
+        if (sound == nullptr || sound->getLoopSteps() == 0
+            || (stretch != nullptr && std::abs(stretch->bpm - settlingBpm) <= kTempoTolerance))
+        {
+            request = {};
+            continue;
+        }
+
+        // Already rendering, or delivered and waiting to be installed.
+        if (request.sound == sound && std::abs(request.bpm - settlingBpm) <= kTempoTolerance)
+            continue;
+
+        request = { sound, settlingBpm };
+        stretcher.stretch(pad, sound, settlingBpm, [this](int padIndex,
+                                                          const juce::ReferenceCountedObjectPtr<PadSound>& source,
+                                                          std::shared_ptr<const PadSound::Stretch> stretched)
+        {
+            applyLoopStretch(padIndex, source, std::move(stretched));
+        });
+    }
+}
+
+void GrooveSeqAudioProcessor::applyLoopStretch(int padIndex,
+                                               const juce::ReferenceCountedObjectPtr<PadSound>& source,
+                                               std::shared_ptr<const PadSound::Stretch> stretch)
+{
+    const juce::ScopedLock edit(editLock);
+
+    // Dropped when the pad was edited or reloaded while the stretch rendered;
+    // the next timer tick asks again for whatever it plays now. Not an undo
+    // step: undoing back to a sound without it just renders it again.
+    const auto current = getPadSound(padIndex);
+    if (current == nullptr || current != source)
+        return;
+
+    auto* sound = copyPadSound(padIndex, *current, current->getLayers(), current->getCycle());
+    sound->setStretch(std::move(stretch));
+    installPadSound(padIndex, sound, getPadFile(padIndex), getPadRole(padIndex));
+}
+
+juce::ReferenceCountedObjectPtr<PadSound> GrooveSeqAudioProcessor::getPadSound(int padIndex) const
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return {};
+
+    const juce::SpinLock::ScopedLockType lock(synthLock);
+    return padSounds[static_cast<size_t>(padIndex)];
+}
+
+void GrooveSeqAudioProcessor::writeSlicePattern(int firstPad,
+                                                const std::vector<int>& sliceStarts,
+                                                int numFrames,
+                                                double sampleRate)
+{
+    const int loopSteps = Sequencer::estimateLoopSteps(numFrames / sampleRate, hostBpm.load(std::memory_order_relaxed));
+
+    editPattern([&](Sequencer& pattern)
+    {
+        for (size_t i = 0; i < sliceStarts.size(); ++i)
+        {
+            const int pad = firstPad + static_cast<int>(i);
+            pattern.clearPad(pad);
+
+            const int sliceStep = juce::roundToInt(static_cast<double>(sliceStarts[i]) / numFrames * loopSteps);
+            if (sliceStep >= loopSteps)
+                continue;
+
+            // Short loops repeat across the pattern; loops longer than it keep their first two bars.
+            for (int step = sliceStep; step < Sequencer::kSteps; step += loopSteps)
+                pattern.setStepActive(pad, step, true);
+        }
+    });
+}
+
+void GrooveSeqAudioProcessor::transcribeLoop(const juce::File& file)
+{
+    transcriber.transcribe(file, hostBpm.load(std::memory_order_relaxed), [this](const LoopTranscriber::Result& result)
+    {
+        applyTranscription(result);
+    });
+}
+
+float GrooveSeqAudioProcessor::getTranscriptionProgress() const
+{
+    return transcriber.getProgress();
+}
+
+void GrooveSeqAudioProcessor::applyTranscription(const LoopTranscriber::Result& result)
+{
+    if (result.loopSteps <= 0)
+        return;
+
+    const juce::ScopedLock edit(editLock);
+    const auto roles = getPatternRoles();
+    auto findPad = [&roles](Sequencer::Role role)
+    {
+        const auto it = std::find(roles.begin(), roles.end(), role);
+        return it != roles.end() ? static_cast<int>(std::distance(roles.begin(), it)) : -1;
+    };
+
+    // Hats go to the closed hat pad, or the open one when no closed hat is loaded.
+    const int hatPad = findPad(Sequencer::Role::closedHat) >= 0 ? findPad(Sequencer::Role::closedHat)
+                                                                 : findPad(Sequencer::Role::openHat);
+    auto padFor = [&findPad, hatPad](Sequencer::Role role)
+    {
+        return role == Sequencer::Role::closedHat ? hatPad : findPad(role);
+    };
+
+    beginEdit("Transcribe Loop");
+    editPattern([&](Sequencer& pattern)
+    {
+        for (auto role : { Sequencer::Role::kick, Sequencer::Role::snare, Sequencer::Role::closedHat })
+        {
+            if (padFor(role) >= 0)
+                pattern.clearPad(padFor(role));
+        }
+
+        for (const auto& hit : result.hits)
+        {
+            const int pad = padFor(hit.role);
+            if (pad < 0)
+                continue;
+
+            // Short loops repeat across the pattern; loops longer than it keep their first two bars.
+            for (int step = hit.step; step < Sequencer::kSteps; step += result.loopSteps)
+            {
+                // Two hits quantized onto one step: keep the louder.
+                if (!pattern.isStepActive(pad, step) || pattern.getStepVelocity(pad, step) < hit.velocity)
+                    pattern.setStep(pad, step, hit.velocity, hit.offset);
+            }
+        }
+    });
+}
+
+void GrooveSeqAudioProcessor::setSliceMode(bool shouldSlice)
+{
+    const juce::ScopedLock edit(editLock);
+    sliceMode = shouldSlice;
+}
+
+bool GrooveSeqAudioProcessor::isSliceMode() const
+{
+    return sliceMode.load();
+}
+
+void GrooveSeqAudioProcessor::installPadSound(int padIndex, PadSound* sound, const juce::File& file, Sequencer::Role role)
+{
+    sound->setEnvelopeParameters(getPadAdsr(padIndex));
+    if (role == Sequencer::Role::none)
+        role = classifySample(*sound, featureExtractor);
+
+    const auto region = sound->getRegion();
+    const double sampleRate = sound->getData().getSampleRate();
+    const bool isWholeSample = region.getStart() == 0 && region.getEnd() == sound->getData().getNumFrames();
+    const auto regionSeconds = isWholeSample ? juce::Range<double>()
+                                             : juce::Range<double>(region.getStart() / sampleRate, region.getEnd() / sampleRate);
+
+    double longestSeconds = 0.0;
+    for (const auto& layer : sound->getLayers())
+    {
+        const int frames = layer.region.isEmpty() ? layer.data->getNumFrames() : layer.region.getLength();
+        longestSeconds = juce::jmax(longestSeconds, frames / layer.data->getSampleRate());
+    }
+
+    if (sound->getLoopSteps() > 0)
+        longestSeconds = sound->getLoopSteps() * 15.0 / hostBpm.load(std::memory_order_relaxed);
+
+    const juce::SpinLock::ScopedLockType lock(synthLock);
+    removePadSound(padIndex);
+    synth.addSound(sound);
+    padSounds[static_cast<size_t>(padIndex)] = sound;
+
+    const juce::SpinLock::ScopedLockType stateLock(padStateLock);
+    padNames[static_cast<size_t>(padIndex)] = sound->getName();
+    padFiles[static_cast<size_t>(padIndex)] = file;
+    padRoles[static_cast<size_t>(padIndex)] = role;
+    padRegions[static_cast<size_t>(padIndex)] = regionSeconds;
+    padLengths[static_cast<size_t>(padIndex)] = longestSeconds;
+    updatePadTail();
+}
+
+void GrooveSeqAudioProcessor::updatePadTail()
+{
+    // Pads are only ever triggered by note-ons, so a voice plays until its
+    // layer runs out, or until its envelope does when sustain is zero.
+    double longest = 0.0;
+    for (size_t pad = 0; pad < padLengths.size(); ++pad)
+    {
+        if (padLengths[pad] <= 0.0)
+            continue;
+
+        const auto& adsr = padAdsr[pad];
+        double seconds = padLengths[pad];
+        if (adsr.sustain <= 0.0f)
+            seconds = juce::jmin(seconds, static_cast<double>(adsr.attack + adsr.decay));
+
+        longest = juce::jmax(longest, seconds + PadInsertChain::kTailSeconds);
+    }
+
+    padTailSeconds.store(longest);
+}
+
+void GrooveSeqAudioProcessor::setCompactSampleStorage(bool shouldBeCompact)
+{
+    const juce::ScopedLock edit(editLock);
+    if (shouldBeCompact == isCompactSampleStorage())
+        return;
+
+    compactSamples = shouldBeCompact;
+
+    // Re-encode the pads that are already loaded so the switch takes effect
+    // without reloading files. Slices of one loop are converted once and keep
+    // sharing the result.
+    const auto format = shouldBeCompact ? SampleData::Format::int16 : SampleData::Format::float32;
+    std::map<const SampleData*, std::shared_ptr<const SampleData>> converted;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto sound = getPadSound(pad);
+        if (sound == nullptr)
+            continue;
+
+        auto layers = sound->getLayers();
+        for (auto& layer : layers)
+        {
+            auto& data = converted[layer.data.get()];
+            if (data == nullptr)
+                data = SampleData::convert(layer.data, format);
+
+            layer.data = data;
+        }
+
+        replacePadLayers(pad, *sound, std::move(layers), sound->getCycle());
+    }
+
+    enforceSampleBudget();
+}
+
+void GrooveSeqAudioProcessor::setSampleMemoryBudget(int megabytes)
+{
+    const juce::ScopedLock edit(editLock);
+    sampleBudgetMb = juce::jmax(0, megabytes);
+    enforceSampleBudget();
+}
+
+int GrooveSeqAudioProcessor::getSampleMemoryBudget() const
+{
+    return sampleBudgetMb.load();
+}
+
+void GrooveSeqAudioProcessor::enforceSampleBudget()
+{
+    // Storage replaced below may still be read by a block already rendering.
+    std::vector<std::shared_ptr<const void>> replaced;
+    streamLeastRecentlyPlayed(replaced);
+    updatePlaybackHeads(replaced);
+
+    // Wait that block out before it is freed.
+    if (!replaced.empty())
+    {
+        const juce::SpinLock::ScopedLockType lock(synthLock);
+    }
+}
+
+void GrooveSeqAudioProcessor::streamLeastRecentlyPlayed(std::vector<std::shared_ptr<const void>>& replaced)
+{
+    const auto budget = static_cast<size_t>(getSampleMemoryBudget()) * 1024 * 1024;
+    if (budget == 0)
+        return;
+
+    struct Resident
+    {
+        std::shared_ptr<const SampleData> data;
+        juce::uint32 lastUse = 0;
+        std::vector<int> playbackStarts;
+    };
+
+    // Data shared between slices or layers is counted once, as recent as its most recent use.
+    std::map<const SampleData*, Resident> resident;
+    size_t total = 0;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto sound = getPadSound(pad);
+        if (sound == nullptr)
+            continue;
+
+        const auto& layers = sound->getLayers();
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            if (layers[i].data->isMapped())
+                continue;
+
+            auto& entry = resident[layers[i].data.get()];
+            if (entry.data == nullptr)
+            {
+                entry.data = layers[i].data;
+                total += entry.data->getMemoryBytes();
+            }
+
+            entry.lastUse = juce::jmax(entry.lastUse, sound->getLastUse(i));
+            entry.playbackStarts.push_back(layers[i].region.getStart());
+        }
+    }
+
+    if (total <= budget)
+        return;
+
+    std::vector<Resident> oldestFirst;
+    for (const auto& entry : resident)
+        oldestFirst.push_back(entry.second);
+
+    // The counter wraps after ~49 days; compare ages rather than raw values.
+    const auto now = juce::Time::getMillisecondCounter();
+    std::sort(oldestFirst.begin(), oldestFirst.end(), [now](const Resident& a, const Resident& b)
+    {
+        return now - a.lastUse > now - b.lastUse;
+    });
+
+    // Data moves to disk in place, so slices, layers and undo history that
+    // share it all stream from then on.
+    const auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("GrooveSeq");
+
+    for (const auto& entry : oldestFirst)
+    {
+        if (total <= budget)
+            break;
+
+        if (auto heap = entry.data->moveToTemporaryFile(directory, entry.playbackStarts))
+        {
+            replaced.push_back(std::move(heap));
+            total -= entry.data->getMemoryBytes();
+        }
+    }
+}
+
+void GrooveSeqAudioProcessor::updatePlaybackHeads(std::vector<std::shared_ptr<const void>>& replaced)
+{
+    std::map<const SampleData*, std::pair<std::shared_ptr<const SampleData>, std::vector<int>>> streamed;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto sound = getPadSound(pad);
+        if (sound == nullptr)
+            continue;
+
+        for (const auto& layer : sound->getLayers())
+        {
+            if (!layer.data->isMapped())
+                continue;
+
+            auto& entry = streamed[layer.data.get()];
+            entry.first = layer.data;
+            entry.second.push_back(layer.region.getStart());
+        }
+    }
+
+    for (auto& entry : streamed)
+    {
+        if (auto previous = entry.second.first->setPlaybackStarts(std::move(entry.second.second)))
+            replaced.push_back(std::move(previous));
+    }
+}
+
+bool GrooveSeqAudioProcessor::saveKit(const juce::File& file)
+{
+    const juce::ScopedLock edit(editLock);
+    KitBundle::Kit kit;
+    std::map<const SampleData*, int> sampleIndices;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto sound = getPadSound(pad);
+        if (sound == nullptr)
+            continue;
+
+        KitBundle::Pad entry;
+        entry.index = pad;
+        entry.name = sound->getName();
+        entry.sourceFile = getPadFile(pad);
+        entry.cycle = sound->getCycle();
+        entry.loopSteps = sound->getLoopSteps();
+
+        // Slices of one loop store its audio once.
+        for (const auto& layer : sound->getLayers())
+        {
+            const auto inserted = sampleIndices.emplace(layer.data.get(), static_cast<int>(kit.samples.size()));
+            if (inserted.second)
+                kit.samples.push_back(layer.data);
+
+            entry.layers.push_back({ inserted.first->second, layer.region, layer.topVelocity });
+        }
+
+        entry.adsr = getPadAdsr(pad);
+        entry.polyphony = getPadPolyphony(pad);
+        entry.chokeGroup = getPadChokeGroup(pad);
+        entry.role = getPadRole(pad);
+        kit.pads.push_back(entry);
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock(sequenceLock);
+        kit.pattern = sequencer.getPattern();
+    }
+
+    kit.bank = patternBank;
+    kit.selectedBankPattern = selectedBankPattern;
+    if (selectedBankPattern >= 0)
+        kit.bank[static_cast<size_t>(selectedBankPattern)] = kit.pattern;
+
+    return KitBundle::write(kit, file);
+}
+
+bool GrooveSeqAudioProcessor::loadKit(const juce::File& file)
+{
+    KitBundle::Kit kit;
+    if (!KitBundle::read(file, kit))
+        return false;
+
+    // Read the mapped pages once here, so the read-ahead finds them in the
+    // page cache. For a bundle another instance already has open this only
+    // maps pages that are there already.
+    float sink = 0.0f;
+    for (const auto& sample : kit.samples)
+        sink += sample->touchPages();
+
+    volatile float touched = sink;
+    juce::ignoreUnused(touched);
+
+    // Every sample gets its heads before a pad can play it.
+    std::vector<std::vector<int>> playbackStarts(kit.samples.size());
+    for (const auto& pad : kit.pads)
+    {
+        for (const auto& layer : pad.layers)
+            playbackStarts[static_cast<size_t>(layer.sample)].push_back(layer.region.getStart());
+    }
+
+    for (size_t i = 0; i < kit.samples.size(); ++i)
+        kit.samples[i]->setPlaybackStarts(std::move(playbackStarts[i]));
+
+    const juce::ScopedLock edit(editLock);
+    {
+        const juce::SpinLock::ScopedLockType lock(synthLock);
+        for (int pad = 0; pad < Sequencer::kPads; ++pad)
+            removePadSound(pad);
+    }
+
+    for (const auto& pad : kit.pads)
+    {
+        applyPadAdsr(pad.index, pad.adsr);
+        setPadPolyphony(pad.index, pad.polyphony);
+        setPadChokeGroup(pad.index, pad.chokeGroup);
+
+        std::vector<PadSound::Layer> layers;
+        for (const auto& layer : pad.layers)
+            layers.push_back({ kit.samples[static_cast<size_t>(layer.sample)], layer.region, layer.topVelocity });
+
+        auto* sound = new PadSound(pad.name, std::move(layers), pad.index, 36 + pad.index, pad.cycle);
+        sound->setLoopSteps(pad.loopSteps);
+        installPadSound(pad.index, sound, pad.sourceFile, pad.role);
+    }
+
+    patternBank = std::move(kit.bank);
+    selectedBankPattern = kit.selectedBankPattern;
+    clearMorphTarget();
+
+    editPattern([&kit](Sequencer& pattern) { pattern.setPattern(kit.pattern); }, false);
+    clearHistory();
+    return true;
+}
+
+void GrooveSeqAudioProcessor::loadImpulseResponse(const juce::File& file)
+{
+    const juce::ScopedLock edit(editLock);
+    impulseResponseFile = file;
+}
+
+juce::File GrooveSeqAudioProcessor::getImpulseResponseFile() const
+{
+    const juce::ScopedLock edit(editLock);
+    return impulseResponseFile;
+}
+
+bool GrooveSeqAudioProcessor::isCompactSampleStorage() const
+{
+    return compactSamples.load();
+}
+
+size_t GrooveSeqAudioProcessor::getSampleMemoryBytes() const
+{
+    // Count data shared between slices or layers once.
+    std::vector<const SampleData*> counted;
+    size_t total = 0;
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto sound = getPadSound(pad);
+        if (sound == nullptr)
+            continue;
+
+        for (const auto& layer : sound->getLayers())
+        {
+            const auto* data = layer.data.get();
+            if (data->isMapped() || std::find(counted.begin(), counted.end(), data) != counted.end())
+                continue;
+
+            counted.push_back(data);
+            total += data->getMemoryBytes();
+        }
+    }
+
+    return total;
+}
+
+void GrooveSeqAudioProcessor::removePadSound(int padIndex)
+{
+    auto* target = padSounds[padIndex];
+    if (target == nullptr)
+        return;
+
+    for (int i = synth.getNumSounds(); --i >= 0;)
+    {
+        if (synth.getSound(i).get() == target)
+        {
+            synth.removeSound(i);
+            break;
+        }
+    }
+
+    padSounds[padIndex] = nullptr;
+
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
+    padNames[padIndex].clear();
+    padFiles[padIndex] = juce::File();
+    padRoles[padIndex] = Sequencer::Role::none;
+    padRegions[padIndex] = {};
+    padLengths[padIndex] = 0.0;
+    updatePadTail();
+}
+
+juce::String GrooveSeqAudioProcessor::getPadName(int padIndex) const
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return {};
+
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
+    return padNames[padIndex];
+}
+
+juce::File GrooveSeqAudioProcessor::getPadFile(int padIndex) const
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return {};
+
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
+    return padFiles[static_cast<size_t>(padIndex)];
+}
+
+juce::Range<double> GrooveSeqAudioProcessor::getPadRegion(int padIndex) const
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return {};
+
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
+    return padRegions[static_cast<size_t>(padIndex)];
+}
+
+Sequencer::Role GrooveSeqAudioProcessor::getPadRole(int padIndex) const
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return Sequencer::Role::none;
+
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
+    return padRoles[static_cast<size_t>(padIndex)];
+}
+
+void GrooveSeqAudioProcessor::generatePattern()
+{
+    const juce::ScopedLock edit(editLock);
+    const auto params = readParameters();
+    const float density = params.density / 100.0f;
+    const float fills = params.fills / 100.0f;
+    const auto roles = getPatternRoles();
+
+    beginEdit("Generate Pattern");
+    editPattern([&](Sequencer& pattern)
+    {
+        pattern.generate(density,
+                         fills,
+                         juce::Random::getSystemRandom().nextInt(),
+                         roles);
+    });
+}
+
+bool GrooveSeqAudioProcessor::exportPatternMidi(const juce::File& file) const
+{
+    Sequencer::Pattern pattern;
+    {
+        const juce::SpinLock::ScopedLockType lock(sequenceLock);
+        pattern = sequencer.getPattern();
+    }
+
+    return PatternMidi::writeMidiFile(pattern,
+                                      parameterPointers.swing->load(std::memory_order_relaxed),
+                                      hostBpm.load(std::memory_order_relaxed),
+                                      file);
+}
+
+int GrooveSeqAudioProcessor::importPatternMidi(const juce::File& file)
+{
+    juce::FileInputStream in(file);
+    if (!in.openedOk())
+        return 0;
+
+    auto patterns = PatternMidi::readPatterns(in, kMaxBankPatterns);
+    if (patterns.empty())
+        return 0;
+
+    const juce::ScopedLock edit(editLock);
+    patternBank = std::move(patterns);
+    selectedBankPattern = 0;
+    clearMorphTarget();
+
+    editPattern([this](Sequencer& pattern) { pattern.setPattern(patternBank.front()); }, false);
+    clearHistory();
+    return static_cast<int>(patternBank.size());
+}
+
+int GrooveSeqAudioProcessor::getPatternBankSize() const
+{
+    const juce::ScopedLock edit(editLock);
+    return static_cast<int>(patternBank.size());
+}
+
+int GrooveSeqAudioProcessor::getSelectedBankPattern() const
+{
+    const juce::ScopedLock edit(editLock);
+    return selectedBankPattern;
+}
+
+void GrooveSeqAudioProcessor::selectBankPattern(int index)
+{
+    const juce::ScopedLock edit(editLock);
+    if (index < 0 || index >= getPatternBankSize() || index == selectedBankPattern)
+        return;
+
+    const auto switchPattern = [this, index](Sequencer& pattern)
+    {
+        // Edits made since the pattern was loaded stay with it in the bank.
+        if (selectedBankPattern >= 0)
+            patternBank[static_cast<size_t>(selectedBankPattern)] = pattern.getPattern();
+
+        pattern.setPattern(patternBank[static_cast<size_t>(index)]);
+    };
+
+    editPattern(switchPattern, false);
+
+    selectedBankPattern = index;
+    clearHistory();
+}
+
+void GrooveSeqAudioProcessor::setMorphTarget(int bankIndex)
+{
+    const juce::ScopedLock edit(editLock);
+    if (bankIndex >= getPatternBankSize())
+        return;
+
+    const juce::SpinLock::ScopedLockType lock(sequenceLock);
+
+    // The selected bank pattern's latest edits are in the working copy.
+    if (bankIndex < 0 || bankIndex == selectedBankPattern)
+        morphTarget = sequencer.getPattern();
+    else
+        morphTarget = patternBank[static_cast<size_t>(bankIndex)];
+
+    morphTargetBankPattern = juce::jmax(-1, bankIndex);
+    publishMorph();
+}
+
+void GrooveSeqAudioProcessor::clearMorphTarget()
+{
+    const juce::ScopedLock edit(editLock);
+    morphTargetBankPattern = -1;
+
+    const juce::SpinLock::ScopedLockType lock(sequenceLock);
+    if (!morphTarget.has_value())
+        return;
+
+    morphTarget.reset();
+    publishMorph();
+}
+
+bool GrooveSeqAudioProcessor::hasMorphTarget() const
+{
+    const juce::SpinLock::ScopedLockType lock(sequenceLock);
+    return morphTarget.has_value();
+}
+
+int GrooveSeqAudioProcessor::getMorphTargetBankPattern() const
+{
+    const juce::ScopedLock edit(editLock);
+    return morphTargetBankPattern;
+}
+
+Sequencer::Roles GrooveSeqAudioProcessor::getPatternRoles() const
+{
+    // Loaded pads play the part their sample was classified as; with nothing
+    // loaded, fall back to the fixed kick/snare/hat layout.
+    Sequencer::Roles roles;
+    {
+        const juce::SpinLock::ScopedLockType lock(padStateLock);
+        roles = padRoles;
+    }
+
+    const bool anyPadHasSample = std::any_of(roles.begin(), roles.end(), [](Sequencer::Role role)
+    {
+        return role != Sequencer::Role::none;
+    });
+
+    return anyPadHasSample ? roles : Sequencer::getDefaultRoles();
+}
+
+bool GrooveSeqAudioProcessor::getStepState(int pad, int step) const
+{
+    const juce::SpinLock::ScopedLockType lock(sequenceLock);
+    return sequencer.isStepActive(pad, step);
 }
 
 void GrooveSeqAudioProcessor::setStepState(int pad, int step, bool enabled)
+{
+    const juce::ScopedLock edit(editLock);
+    beginEdit(enabled ? "Add Step" : "Remove Step");
+    editPattern([=](Sequencer& pattern) { pattern.setStepActive(pad, step, enabled); });
+}
+
+float GrooveSeqAudioProcessor::getStepVelocity(int pad, int step) const
+{
+    const juce::SpinLock::ScopedLockType lock(sequenceLock);
+    return sequencer.getStepVelocity(pad, step);
+}
+
+float GrooveSeqAudioProcessor::getStepOffset(int pad, int step) const
 {
     const juce::SpinLock::ScopedLockType lock(sequenceLock);
-    sequencer.setStepActive(pad, step, enabled);
+    return sequencer.getStepOffset(pad, step);
 }
 
 int GrooveSeqAudioProcessor::getCurrentStep() const
@@ -337,14 +2204,105 @@ juce::AudioProcessorValueTreeState::ParameterLayout GrooveSeqAudioProcessor::cre
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
         "velocity", "Velocity Random", juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 20.0f));
 
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "record", "Record", false));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "recordMode", "Record Mode",
+        juce::StringArray { "Overdub", "Replace" }, 0));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "recordQuantize", "Record Quantize", juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 100.0f));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "morph", "Morph", juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 0.0f));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "morphMode", "Morph Mode",
+        juce::StringArray { "Density", "Probability" }, 0));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "reverbReturn", "Reverb Return",
+        juce::NormalisableRange<float>(SendEffects::kMinReturnDb, 6.0f, 0.1f), -6.0f));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "delayReturn", "Delay Return",
+        juce::NormalisableRange<float>(SendEffects::kMinReturnDb, 6.0f, 0.1f), -6.0f));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "delayTime", "Delay Time",
+        juce::StringArray { "1/4", "1/8", "1/8 Dotted", "1/8 Triplet", "1/16" }, 2));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        "delayFeedback", "Delay Feedback",
+        juce::NormalisableRange<float>(0.0f, 90.0f, 0.1f), 35.0f));
+
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+    {
+        const auto prefix = "Pad " + juce::String(pad + 1) + " ";
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "level"), prefix + "Level",
+            juce::NormalisableRange<float>(kMinPadLevelDb, 6.0f, 0.1f), 0.0f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "pan"), prefix + "Pan",
+            juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f), 0.0f));
+
+        params.push_back(std::make_unique<juce::AudioParameterBool>(
+            padParamId(pad, "mute"), prefix + "Mute", false));
+
+        params.push_back(std::make_unique<juce::AudioParameterBool>(
+            padParamId(pad, "solo"), prefix + "Solo", false));
+
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            padParamId(pad, "filter"), prefix + "Filter Type",
+            juce::StringArray { "Low-pass", "High-pass", "Band-pass" }, 0));
+
+        juce::NormalisableRange<float> cutoffRange(PadInsertChain::kMinCutoffHz, PadInsertChain::kMaxCutoffHz, 1.0f);
+        cutoffRange.setSkewForCentre(1000.0f);
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "cutoff"), prefix + "Cutoff", cutoffRange, PadInsertChain::kMaxCutoffHz));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "reso"), prefix + "Resonance",
+            juce::NormalisableRange<float>(0.5f, 10.0f, 0.01f, 0.5f), 0.707f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "drive"), prefix + "Drive",
+            juce::NormalisableRange<float>(0.0f, 24.0f, 0.1f), 0.0f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "attack"), prefix + "Transient Attack",
+            juce::NormalisableRange<float>(-100.0f, 100.0f, 0.1f), 0.0f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "sustain"), prefix + "Transient Sustain",
+            juce::NormalisableRange<float>(-100.0f, 100.0f, 0.1f), 0.0f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "reverb"), prefix + "Reverb Send",
+            juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 0.0f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            padParamId(pad, "delay"), prefix + "Delay Send",
+            juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 0.0f));
+    }
+
     return { params.begin(), params.end() };
 }
 
+juce::String GrooveSeqAudioProcessor::padParamId(int padIndex, const juce::String& name)
+{
+    return "pad" + juce::String(padIndex + 1) + "_" + name;
+}
+
 juce::ADSR::Parameters GrooveSeqAudioProcessor::getPadAdsr(int padIndex) const
 {
     if (padIndex < 0 || padIndex >= Sequencer::kPads)
         return juce::ADSR::Parameters { 0.002f, 0.12f, 0.7f, 0.12f };
 
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
     return padAdsr[static_cast<size_t>(padIndex)];
 }
 
@@ -353,13 +2311,75 @@ void GrooveSeqAudioProcessor::setPadAdsr(int padIndex, const juce::ADSR::Paramet
     if (padIndex < 0 || padIndex >= Sequencer::kPads)
         return;
 
-    padAdsr[static_cast<size_t>(padIndex)] = params;
+    const juce::ScopedLock edit(editLock);
+
+    // A drag on one envelope control is one undo step, not one per value.
+    beginEdit("Pad " + juce::String(padIndex + 1) + " Envelope", true);
+    undoManager.perform(new EnvelopeEdit(*this, padIndex, getPadAdsr(padIndex), params));
+}
+
+void GrooveSeqAudioProcessor::applyPadAdsr(int padIndex, const juce::ADSR::Parameters& params)
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return;
+
+    {
+        const juce::SpinLock::ScopedLockType lock(padStateLock);
+        padAdsr[static_cast<size_t>(padIndex)] = params;
+        updatePadTail();
+    }
 
     const juce::SpinLock::ScopedLockType lock(synthLock);
     if (auto* sound = padSounds[static_cast<size_t>(padIndex)])
         sound->setEnvelopeParameters(params);
 }
 
+int GrooveSeqAudioProcessor::getPadPolyphony(int padIndex) const
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return PadSynth::kDefaultPadPolyphony;
+
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
+    return padPolyphony[static_cast<size_t>(padIndex)];
+}
+
+void GrooveSeqAudioProcessor::setPadPolyphony(int padIndex, int maxVoices)
+{
+    const juce::ScopedLock edit(editLock);
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return;
+
+    {
+        const juce::SpinLock::ScopedLockType lock(padStateLock);
+        padPolyphony[static_cast<size_t>(padIndex)] = maxVoices;
+    }
+
+    synth.setPadPolyphony(padIndex, maxVoices);
+}
+
+int GrooveSeqAudioProcessor::getPadChokeGroup(int padIndex) const
+{
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return 0;
+
+    const juce::SpinLock::ScopedLockType lock(padStateLock);
+    return padChokeGroup[static_cast<size_t>(padIndex)];
+}
+
+void GrooveSeqAudioProcessor::setPadChokeGroup(int padIndex, int group)
+{
+    const juce::ScopedLock edit(editLock);
+    if (padIndex < 0 || padIndex >= Sequencer::kPads)
+        return;
+
+    {
+        const juce::SpinLock::ScopedLockType lock(padStateLock);
+        padChokeGroup[static_cast<size_t>(padIndex)] = group;
+    }
+
+    synth.setPadChokeGroup(padIndex, group);
+}
+
 void GrooveSeqAudioProcessor::triggerPadPreview(int padIndex)
 {
     if (padIndex < 0 || padIndex >= Sequencer::kPads)
@@ -3,10 +3,26 @@
 #include <juce_audio_utils/juce_audio_utils.h>
 
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
 
+#include "ControlSurface.h"
+#include "KitBundle.h"
+#include "LoopStretcher.h"
+#include "LoopTranscriber.h"
+#include "PadSampler.h"
+#include "PatternMidi.h"
+#include "PatternMorph.h"
+#include "PatternRecorder.h"
+#include "PatternSnapshot.h"
+#include "RenderPool.h"
+#include "SampleAnalysis.h"
+#include "SendEffects.h"
 #include "Sequencer.h"
 
-class GrooveSeqAudioProcessor : public juce::AudioProcessor
+class GrooveSeqAudioProcessor : public juce::AudioProcessor,
+                                private juce::Timer
 {
 public:
     GrooveSeqAudioProcessor();
@@ -38,39 +54,389 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
+    // Worst processBlock time since the last call, as a fraction of the
+    // block's duration, and how many realtime blocks have overrun so far.
+    struct BlockLoad
+    {
+        double peak = 0.0;
+        int overruns = 0;
+    };
+
+    BlockLoad takeBlockLoad();
+
+    // N in the controller segment /grooveseq-N, or 0 when none could be opened.
+    int getControllerInstance() const noexcept { return controlSurface.getInstanceNumber(); }
+
+    // The editing methods below may be called from any thread. They are
+    // serialized with each other, so each one lands in the undo history as a
+    // whole, and none of them holds up processBlock for longer than a
+    // pointer swap or a sound install.
+
+    // Loads file onto padIndex, or slices it from padIndex onwards in slice mode.
     bool loadSample(int padIndex, const juce::File& file);
+
+    // Cuts a loop at its transients onto consecutive pads starting at
+    // firstPad and writes the hits into the pattern. Returns the slice count.
+    int sliceSample(int firstPad, const juce::File& file);
+    void setSliceMode(bool shouldSlice);
+    bool isSliceMode() const;
+
+    // Velocity layers and round-robin samples. A velocity layer opens a new,
+    // louder zone and spreads the pad's zones evenly over the velocity range;
+    // a round-robin sample joins the loudest zone. On an empty pad either one
+    // becomes its first layer.
+    bool addPadLayer(int padIndex, const juce::File& file, bool newVelocityZone);
+    // Drops every layer but the first.
+    void clearPadLayers(int padIndex);
+    int getPadLayerCount(int padIndex) const;
+    PadSound::Cycle getPadCycle(int padIndex) const;
+    void setPadCycle(int padIndex, PadSound::Cycle cycle);
+
+    // Loop pads play each hit stretched over a whole number of 16ths at the
+    // host tempo, guessed from the sample's length when the mode is switched
+    // on. A stretch is rendered in the background whenever the tempo
+    // settles; until it arrives the pad is varispeeded.
+    void setPadLoop(int padIndex, bool shouldLoop);
+    // 16ths a loop pad spans, 0 for a one-shot.
+    int getPadLoopSteps(int padIndex) const;
+
+    // Transcribes a drum loop in the background and writes its kick, snare and
+    // hat hits onto the pads playing those roles.
+    void transcribeLoop(const juce::File& file);
+    // 0..1 while a loop is being transcribed, -1 otherwise.
+    float getTranscriptionProgress() const;
+
     juce::String getPadName(int padIndex) const;
+    juce::File getPadFile(int padIndex) const;
+    // Part of the pad's file it plays, in seconds; empty for the whole file.
+    juce::Range<double> getPadRegion(int padIndex) const;
+    Sequencer::Role getPadRole(int padIndex) const;
+    void setCompactSampleStorage(bool shouldBeCompact);
+    bool isCompactSampleStorage() const;
+    // RAM held by decoded samples; mapped kits and streamed layers aren't counted.
+    size_t getSampleMemoryBytes() const;
+    // Megabytes of decoded audio kept in RAM, 0 for no limit. Past it the
+    // least recently played layers move to memory-mapped temporary files and
+    // stream from disk.
+    void setSampleMemoryBudget(int megabytes);
+    int getSampleMemoryBudget() const;
+    void loadImpulseResponse(const juce::File& file);
+
+    // .gsqkit bundles: every loaded pad's audio and settings plus the pattern
+    // and pattern bank. Loading maps the file instead of decoding it.
+    bool saveKit(const juce::File& file);
+    bool loadKit(const juce::File& file);
+
+    juce::File getImpulseResponseFile() const;
 
     void generatePattern();
+
+    // Writes the current pattern, with its swing, to a Standard MIDI File.
+    bool exportPatternMidi(const juce::File& file) const;
+    // Replaces the pattern bank with the patterns in a MIDI file and selects
+    // the first one. Returns how many were read.
+    int importPatternMidi(const juce::File& file);
+    int getPatternBankSize() const;
+    int getSelectedBankPattern() const;
+    // Stores the current pattern back into the bank and loads another.
+    void selectBankPattern(int index);
+
+    // Pattern B of the morph control: a bank pattern, or a copy of the current
+    // pattern for bankIndex -1. The morph parameter then blends the pattern
+    // being played into it. Loading a kit or importing MIDI clears it.
+    void setMorphTarget(int bankIndex);
+    void clearMorphTarget();
+    bool hasMorphTarget() const;
+    // The bank pattern B was taken from, or -1 for a copy or no target.
+    int getMorphTargetBankPattern() const;
+
     bool getStepState(int pad, int step) const;
     void setStepState(int pad, int step, bool enabled);
+    float getStepVelocity(int pad, int step) const;
+    float getStepOffset(int pad, int step) const;
     int getCurrentStep() const;
     juce::ADSR::Parameters getPadAdsr(int padIndex) const;
     void setPadAdsr(int padIndex, const juce::ADSR::Parameters& params);
+    int getPadPolyphony(int padIndex) const;
+    void setPadPolyphony(int padIndex, int maxVoices);
+    int getPadChokeGroup(int padIndex) const;
+    void setPadChokeGroup(int padIndex, int group);
     void triggerPadPreview(int padIndex);
 
+    // Undo history for step edits, generated patterns, recording, transcribed
+    // and sliced loops, pad envelopes and sample assignment. Loading a kit,
+    // importing MIDI and switching bank patterns start a new history, since
+    // they replace what earlier steps refer to.
+    bool undo();
+    bool redo();
+    bool canUndo() const;
+    bool canRedo() const;
+    juce::String getUndoDescription() const;
+    juce::String getRedoDescription() const;
+    // Told after every edit, undo and redo.
+    void addHistoryListener(juce::ChangeListener* listener);
+    void removeHistoryListener(juce::ChangeListener* listener);
+
     juce::AudioProcessorValueTreeState& getValueTreeState() { return parameters; }
 
+    // Parameter ID of a per-pad mixer control, e.g. padParamId(0, "level") -> "pad1_level".
+    static juce::String padParamId(int padIndex, const juce::String& name);
+
 private:
+    // All automatable values for one block, read once from cached atomics.
+    struct PadSnapshot
+    {
+        float levelDb = 0.0f;
+        float pan = 0.0f;
+        bool mute = false;
+        bool solo = false;
+        float reverbSend = 0.0f;
+        float delaySend = 0.0f;
+        PadInsertChain::Settings inserts;
+    };
+
+    struct ParameterSnapshot
+    {
+        float swing = 0.0f;
+        float humanize = 0.0f;
+        float fills = 0.0f;
+        float density = 0.0f;
+        float velocity = 0.0f;
+        bool record = false;
+        bool recordReplace = false;
+        float recordQuantize = 0.0f;
+        float morph = 0.0f;
+        PatternMorph::Mode morphMode = PatternMorph::Mode::density;
+        bool highQuality = false; // offline bounce: quality over speed
+        SendEffects::Settings sends;
+        std::array<PadSnapshot, Sequencer::kPads> pads{};
+    };
+
+    struct PadParameterPointers
+    {
+        std::atomic<float>* level = nullptr;
+        std::atomic<float>* pan = nullptr;
+        std::atomic<float>* mute = nullptr;
+        std::atomic<float>* solo = nullptr;
+        std::atomic<float>* filterType = nullptr;
+        std::atomic<float>* cutoff = nullptr;
+        std::atomic<float>* resonance = nullptr;
+        std::atomic<float>* drive = nullptr;
+        std::atomic<float>* attack = nullptr;
+        std::atomic<float>* sustain = nullptr;
+        std::atomic<float>* reverbSend = nullptr;
+        std::atomic<float>* delaySend = nullptr;
+    };
+
+    struct ParameterPointers
+    {
+        std::atomic<float>* swing = nullptr;
+        std::atomic<float>* humanize = nullptr;
+        std::atomic<float>* fills = nullptr;
+        std::atomic<float>* density = nullptr;
+        std::atomic<float>* velocity = nullptr;
+        std::atomic<float>* record = nullptr;
+        std::atomic<float>* recordMode = nullptr;
+        std::atomic<float>* recordQuantize = nullptr;
+        std::atomic<float>* morph = nullptr;
+        std::atomic<float>* morphMode = nullptr;
+        std::atomic<float>* reverbReturn = nullptr;
+        std::atomic<float>* delayReturn = nullptr;
+        std::atomic<float>* delayTime = nullptr;
+        std::atomic<float>* delayFeedback = nullptr;
+        std::array<PadParameterPointers, Sequencer::kPads> pads{};
+    };
+
+    class PatternEdit;
+    class EnvelopeEdit;
+    class PadAssignmentEdit;
+
+    // What a pad plays, as the undo history records it.
+    struct PadAssignment
+    {
+        juce::ReferenceCountedObjectPtr<PadSound> sound;
+        juce::File file;
+        Sequencer::Role role = Sequencer::Role::none;
+    };
+
+    using PadAssignments = std::array<PadAssignment, Sequencer::kPads>;
+
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
+    ParameterSnapshot readParameters() const;
+    static std::array<PadSynth::PadChannel, Sequencer::kPads> computePadChannels(const ParameterSnapshot& params);
+
     void removePadSound(int padIndex);
+    juce::ReferenceCountedObjectPtr<PadSound> getPadSound(int padIndex) const;
+    std::shared_ptr<const SampleData> decodeSample(const juce::File& file, double maxLengthSeconds);
+    // Reinstalls a loaded pad with new layers, keeping how recently each was played.
+    void replacePadLayers(int padIndex, const PadSound& previous, std::vector<PadSound::Layer> layers, PadSound::Cycle cycle);
+    // The sound replacePadLayers installs. Loop steps carry over, and so does
+    // the stretch when the layers are unchanged.
+    PadSound* copyPadSound(int padIndex, const PadSound& previous, std::vector<PadSound::Layer> layers, PadSound::Cycle cycle) const;
+    void enforceSampleBudget();
+    // Moves the least recently played heap samples to disk until under budget.
+    void streamLeastRecentlyPlayed(std::vector<std::shared_ptr<const void>>& replaced);
+    // Keeps the heads of streamed samples in step with where the pads start them.
+    void updatePlaybackHeads(std::vector<std::shared_ptr<const void>>& replaced);
+    // A role of none has the sound classified.
+    void installPadSound(int padIndex, PadSound* sound, const juce::File& file, Sequencer::Role role = Sequencer::Role::none);
+    // Recomputes padTailSeconds from the pad lengths and envelopes; call with padStateLock held.
+    void updatePadTail();
+    void prewarmVoices(int samplesPerBlock);
+    // processBlock's work for a block no longer than the prepared size.
+    // hostMidi is the host's input alone, for recording; midiOut also holds
+    // auditions and gets the sequencer's notes.
+    void renderBlock(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& hostMidi, juce::MidiBuffer& midiOut,
+                     const juce::AudioPlayHead::CurrentPositionInfo& posInfo, bool canPlay);
+    void captureRecordedNotes(const juce::MidiBuffer& midi, double startPpq, double endPpq,
+                              double cycleStartPpq, double samplesPerQuarter, const ParameterSnapshot& params);
+    void timerCallback() override;
+    // Applies commands queued by a local controller and republishes what it reads.
+    void serviceControlSurface();
+    // Once the host tempo has settled, asks for a stretch of every loop pad
+    // that lacks one at that tempo.
+    void updateLoopStretches();
+    // Hands the reverb its IR once any pad sends to it, and again on changes.
+    void updateReverb();
+    void applyLoopStretch(int padIndex,
+                          const juce::ReferenceCountedObjectPtr<PadSound>& source,
+                          std::shared_ptr<const PadSound::Stretch> stretch);
+    void writeSlicePattern(int firstPad, const std::vector<int>& sliceStarts, int numFrames, double sampleRate);
+    void applyTranscription(const LoopTranscriber::Result& result);
+    Sequencer::Roles getPatternRoles() const;
+    void generateDefaultPattern();
+    void growVoicePool();
+
+    // Starts the undo step the following changes are recorded in. Continuing
+    // edits, like envelope drags and recorded notes, keep adding to the last
+    // step of the same name while they arrive close together.
+    void beginEdit(const juce::String& name, bool continuing = false);
+    void clearHistory();
+    // Runs edit on the working pattern, then publishes the result to the
+    // audio thread and, when undoable, records it in the current undo step.
+    void editPattern(const std::function<void(Sequencer&)>& edit, bool undoable = true);
+    void restorePattern(const PatternSnapshot::Ptr& snapshot);
+    // Call with sequenceLock held.
+    void publishPattern(PatternSnapshot::Ptr snapshot);
+    // Rebuilds the morph tables from the published pattern and morphTarget;
+    // call with sequenceLock held.
+    void publishMorph();
+    // Audio thread. Copies the morph tables too when a target is set, and
+    // returns whether one is.
+    bool readLivePattern(Sequencer::Pattern& pattern, PatternMorph& morph);
+    PadAssignments getPadAssignments() const;
+    // Records every pad whose sound changed since before in the current undo step.
+    void recordPadAssignments(const PadAssignments& before);
+    void restorePadAssignment(int padIndex, const PadAssignment& assignment);
+    void applyPadAdsr(int padIndex, const juce::ADSR::Parameters& params);
+
+    // The pool starts small and grows while the synth reports it running
+    // out of free voices, so idle instances stay cheap to create.
+    static constexpr int kInitialVoices = 8;
+    static constexpr int kVoiceGrowth = 8;
+    static constexpr size_t kMidiReserveBytes = 4096;
+    // Undo history is sized in kilobytes of sample audio it keeps alive; the
+    // oldest edits go once it passes this, leaving at least the newest few.
+    static constexpr int kUndoHistoryKb = 256 * 1024;
+    static constexpr int kMinUndoTransactions = 8;
 
     juce::AudioProcessorValueTreeState parameters;
+    ParameterPointers parameterPointers;
+    juce::SmoothedValue<float> swingSmoothed;
+    juce::SmoothedValue<float> humanizeSmoothed;
+    juce::SmoothedValue<float> velocitySmoothed;
+    juce::SmoothedValue<float> morphSmoothed;
     juce::AudioFormatManager formatManager;
-    juce::Synthesiser synth;
-    juce::SpinLock synthLock;
+    PadSynth synth;
+    // Renders pads across cores while the host bounces offline. Created on
+    // the first offline prepareToPlay, so realtime-only instances start no threads.
+    std::unique_ptr<RenderPool> renderPool;
+    SendEffects sendEffects;
+    mutable juce::SpinLock synthLock;
     juce::SpinLock previewLock;
 
-    Sequencer sequencer;
+    Sequencer sequencer; // the message thread's working copy
     mutable juce::SpinLock sequenceLock;
+    // The published pattern. currentPattern keeps it alive; the audio thread
+    // reads it through livePattern, flagging the read so a publish can tell
+    // when the snapshot it replaced is no longer in use.
+    PatternSnapshot::Ptr currentPattern;
+    std::atomic<const PatternSnapshot*> livePattern { nullptr };
+    // The same for the morph tables, which are null without a morph target.
+    std::unique_ptr<const PatternMorph> currentMorph;
+    std::atomic<const PatternMorph*> liveMorph { nullptr };
+    std::atomic<bool> patternReadInProgress { false };
+    std::optional<Sequencer::Pattern> morphTarget; // under sequenceLock
+    int morphTargetBankPattern = -1;               // under editLock
+    PatternMorph blockMorph;                       // audio thread only
+    juce::UndoManager undoManager { kUndoHistoryKb, kMinUndoTransactions };
+    juce::String continuingEdit;
+    juce::uint32 lastContinuingEditMs = 0;
+    // Held by every editing method, and re-entered by the ones they call.
+    mutable juce::CriticalSection editLock;
+    // Session settings saved with the plugin state. Kept out of
+    // parameters.state, which isn't safe to touch off the message thread;
+    // written under editLock and readable from any thread.
+    std::atomic<bool> sliceMode { false };
+    std::atomic<bool> compactSamples { false };
+    std::atomic<int> sampleBudgetMb { 0 };
+    juce::File impulseResponseFile; // under editLock
+    std::atomic<bool> defaultPatternPending { true };
     juce::Random random;
     std::atomic<int> currentStep { -1 };
+    std::atomic<double> hostBpm { 120.0 };
+    PatternRecorder recorder;
+    std::vector<Sequencer::Pattern> patternBank; // under editLock
+    int selectedBankPattern = -1;
+    std::vector<PatternRecorder::Event> recordedEvents; // message thread only
+    ControlSurface controlSurface;                       // message thread only
+
+    // Loop stretching, message thread only: the tempo being watched for
+    // settling, and the render last asked for on each pad.
+    struct StretchRequest
+    {
+        juce::ReferenceCountedObjectPtr<PadSound> sound;
+        double bpm = 0.0;
+    };
+
+    double settlingBpm = 0.0;
+    juce::uint32 settlingSinceMs = 0;
+    std::array<StretchRequest, Sequencer::kPads> stretchRequests{};
 
-    std::array<juce::SamplerSound*, Sequencer::kPads> padSounds{};
+    // Per-sample-rate constants, re-derived in prepareToPlay.
+    double cachedSampleRate = 44100.0;
+    double samplesPerMs = 44.1;
+    int preparedBlockSize = 512;
+
+    // Written only by the audio thread; takeBlockLoad() resets the peak.
+    std::atomic<double> peakBlockLoad { 0.0 };
+    std::atomic<int> blockOverruns { 0 };
+
+    std::array<PadSound*, Sequencer::kPads> padSounds{}; // under synthLock
+    // Guards the per-pad arrays below; the audio thread never takes it.
+    mutable juce::SpinLock padStateLock;
     std::array<juce::String, Sequencer::kPads> padNames{};
+    std::array<juce::File, Sequencer::kPads> padFiles{};
+    std::array<juce::Range<double>, Sequencer::kPads> padRegions{};
+    Sequencer::Roles padRoles{};
     std::array<juce::ADSR::Parameters, Sequencer::kPads> padAdsr;
+    std::array<int, Sequencer::kPads> padPolyphony{};
+    std::array<int, Sequencer::kPads> padChokeGroup{};
+    std::array<double, Sequencer::kPads> padLengths{}; // longest layer, in seconds
+    // How long the pads can sound after their last note-on; see updatePadTail().
+    std::atomic<double> padTailSeconds { 0.0 };
+    SampleAnalysis::FeatureExtractor featureExtractor; // under editLock
     juce::MidiBuffer previewMidi;
+    juce::MidiBuffer blockMidi;
+    // Oversized host blocks are rendered in pieces; see processBlock.
+    juce::MidiBuffer subBlockHostMidi;
+    juce::MidiBuffer subBlockMidi;
+    juce::AudioBuffer<float> scratchBuffer;
+
+    // Last members, so their threads stop before anything they call back into is destroyed.
+    LoopTranscriber transcriber;
+    LoopStretcher stretcher;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrooveSeqAudioProcessor)
 };
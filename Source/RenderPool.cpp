@@ -0,0 +1,92 @@
+#include "RenderPool.h"
+
+class RenderPool::Worker : public juce::Thread
+{
+public:
+    Worker(RenderPool& ownerPool, int index)
+        : juce::Thread("GrooveSeq render " + juce::String(index + 1))
+        , owner(ownerPool)
+    {
+    }
+
+    void wake() { wakeUp.signal(); }
+
+    void run() override
+    {
+        for (;;)
+        {
+            wakeUp.wait(-1);
+            if (threadShouldExit())
+                return;
+
+            owner.workOnBatch();
+
+            if (owner.busyWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                owner.batchDone.signal();
+        }
+    }
+
+private:
+    RenderPool& owner;
+    juce::WaitableEvent wakeUp;
+};
+
+RenderPool::RenderPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(*this, i));
+        workers.back()->startThread(juce::Thread::Priority::high);
+    }
+}
+
+RenderPool::~RenderPool()
+{
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wake();
+    }
+
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+}
+
+void RenderPool::runJobs(int numJobs, Invoker invoker, void* context)
+{
+    if (numJobs <= 0)
+        return;
+
+    batchInvoker = invoker;
+    batchContext = context;
+    batchSize = numJobs;
+    nextJob.store(0, std::memory_order_relaxed);
+
+    // Waking more workers than there are jobs beyond the caller's first
+    // only costs them a failed claim.
+    const int helpers = juce::jmin(static_cast<int>(workers.size()), numJobs - 1);
+    if (helpers > 0)
+    {
+        busyWorkers.store(helpers, std::memory_order_release);
+        batchDone.reset();
+
+        for (int i = 0; i < helpers; ++i)
+            workers[static_cast<size_t>(i)]->wake();
+    }
+
+    workOnBatch();
+
+    if (helpers > 0)
+        batchDone.wait(-1);
+}
+
+void RenderPool::workOnBatch()
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    for (int job = nextJob.fetch_add(1, std::memory_order_relaxed); job < batchSize;
+         job = nextJob.fetch_add(1, std::memory_order_relaxed))
+    {
+        batchInvoker(batchContext, job);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Runs batches of independent jobs on worker threads plus the calling thread.
+// Jobs are claimed one at a time from a shared counter, so a thread that
+// finishes early takes the next job instead of idling while a slow one runs.
+//
+// Meant for offline rendering: run() blocks the caller until the batch is
+// done, which a realtime audio thread must never do.
+class RenderPool
+{
+public:
+    // numWorkers threads in addition to the caller.
+    explicit RenderPool(int numWorkers);
+    ~RenderPool();
+
+    // Threads that take part in a batch, including the caller.
+    int getNumThreads() const noexcept { return static_cast<int>(workers.size()) + 1; }
+
+    // Calls job(i) once for every i in [0, numJobs) and returns when all have
+    // finished. Jobs run with denormals flushed, as on the audio thread.
+    template <typename Job>
+    void run(int numJobs, Job&& job)
+    {
+        using JobType = std::remove_reference_t<Job>;
+        runJobs(numJobs,
+                [](void* context, int index) { (*static_cast<JobType*>(context))(index); },
+                const_cast<void*>(static_cast<const void*>(&job)));
+    }
+
+private:
+    using Invoker = void (*)(void*, int);
+
+    class Worker;
+
+    void runJobs(int numJobs, Invoker invoker, void* context);
+    void workOnBatch();
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // The current batch, published to workers by waking them.
+    Invoker batchInvoker = nullptr;
+    void* batchContext = nullptr;
+    int batchSize = 0;
+    std::atomic<int> nextJob { 0 };
+    std::atomic<int> busyWorkers { 0 };
+    juce::WaitableEvent batchDone;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderPool)
+};
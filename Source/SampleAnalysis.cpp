@@ -0,0 +1,209 @@
+#include "SampleAnalysis.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr float kRiseDb = 9.0f;
+constexpr float kFloorDb = -50.0f;
+constexpr double kMinGapSeconds = 0.05;
+
+constexpr float kLowBandHz = 200.0f;
+constexpr float kHighBandHz = 4000.0f;
+
+// Spectrum frames averaged per sample: the attack and early body. Frames
+// overlap by half, so eight span 9216 samples, ~209 ms at 44.1 kHz.
+constexpr int kMaxSpectrumFrames = 8;
+
+constexpr int kEnvelopeWindow = 256;
+constexpr float kDecayRangeDb = 24.0f;
+
+float toDb(float energy)
+{
+    return 10.0f * std::log10(energy + 1.0e-12f);
+}
+} // namespace
+
+namespace SampleAnalysis
+{
+OnsetDetector::OnsetDetector(double sampleRate, int hop)
+    : hopSize(juce::jmax(1, hop))
+    , previousLogEnergy(kFloorDb)
+    , minGapSamples(static_cast<juce::int64>(kMinGapSeconds * sampleRate))
+{
+}
+
+void OnsetDetector::process(const float* mono, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        hopEnergy += mono[i] * mono[i];
+
+        if (++hopFill == hopSize)
+            finishHop();
+    }
+}
+
+void OnsetDetector::finishHop()
+{
+    const float logEnergy = toDb(hopEnergy / static_cast<float>(hopSize));
+
+    const bool loudEnough = logEnergy > kFloorDb;
+    const float rise = logEnergy - previousLogEnergy;
+    const bool rising = rise > kRiseDb;
+    const bool spaced = lastOnset < 0 || hopStart - lastOnset >= minGapSamples;
+
+    if (loudEnough && rising && spaced)
+    {
+        onsets.push_back(hopStart);
+        strengths.push_back(rise);
+        levels.push_back(logEnergy);
+        lastOnset = hopStart;
+    }
+
+    // Track the floor so a slow fade-in isn't counted as one long onset.
+    previousLogEnergy = juce::jmax(kFloorDb, logEnergy);
+    hopStart += hopSize;
+    hopFill = 0;
+    hopEnergy = 0.0f;
+}
+
+void LevelStats::add(const float* samples, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        peak = juce::jmax(peak, std::abs(samples[i]));
+        sumOfSquares += static_cast<double>(samples[i]) * samples[i];
+    }
+
+    count += numSamples;
+}
+
+float LevelStats::getRms() const noexcept
+{
+    return count > 0 ? static_cast<float>(std::sqrt(sumOfSquares / static_cast<double>(count))) : 0.0f;
+}
+
+FeatureExtractor::FeatureExtractor()
+    : fft(kFftOrder)
+    , window(static_cast<size_t>(kFftSize), juce::dsp::WindowingFunction<float>::hann, false)
+    , fftData(static_cast<size_t>(kFftSize * 2))
+    , power(static_cast<size_t>(kFftSize / 2 + 1))
+{
+}
+
+SpectralFeatures FeatureExtractor::extract(const float* mono, int numSamples, double sampleRate)
+{
+    SpectralFeatures features;
+    if (numSamples <= 0 || sampleRate <= 0.0)
+        return features;
+
+    std::fill(power.begin(), power.end(), 0.0f);
+
+    // Half-overlapping frames from the start; short samples get one zero-padded frame.
+    const int hop = kFftSize / 2;
+    for (int frame = 0; frame < kMaxSpectrumFrames; ++frame)
+    {
+        const int start = frame * hop;
+        if (start >= numSamples)
+            break;
+
+        const int count = juce::jmin(kFftSize, numSamples - start);
+        std::fill(fftData.begin(), fftData.end(), 0.0f);
+        std::copy(mono + start, mono + start + count, fftData.begin());
+
+        window.multiplyWithWindowingTable(fftData.data(), static_cast<size_t>(kFftSize));
+        fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+        for (size_t bin = 0; bin < power.size(); ++bin)
+            power[bin] += fftData[bin] * fftData[bin];
+    }
+
+    const float binHz = static_cast<float>(sampleRate) / static_cast<float>(kFftSize);
+    double total = 0.0;
+    double low = 0.0;
+    double high = 0.0;
+    double weightedFrequency = 0.0;
+
+    for (size_t bin = 1; bin < power.size(); ++bin)
+    {
+        const float frequency = static_cast<float>(bin) * binHz;
+        const double energy = power[bin];
+
+        total += energy;
+        weightedFrequency += energy * frequency;
+
+        if (frequency < kLowBandHz)
+            low += energy;
+        else if (frequency >= kHighBandHz)
+            high += energy;
+    }
+
+    if (total > 0.0)
+    {
+        features.lowEnergy = static_cast<float>(low / total);
+        features.highEnergy = static_cast<float>(high / total);
+        features.midEnergy = 1.0f - features.lowEnergy - features.highEnergy;
+        features.centroidHz = static_cast<float>(weightedFrequency / total);
+    }
+
+    features.decaySeconds = measureDecay(mono, numSamples, sampleRate);
+    return features;
+}
+
+float FeatureExtractor::measureDecay(const float* mono, int numSamples, double sampleRate)
+{
+    // RMS envelope in short windows; decay is measured from its loudest window.
+    float peakLevel = 0.0f;
+    int peakWindow = 0;
+    const int windows = numSamples / kEnvelopeWindow;
+
+    auto windowLevel = [mono](int index)
+    {
+        float sum = 0.0f;
+        for (int i = index * kEnvelopeWindow; i < (index + 1) * kEnvelopeWindow; ++i)
+            sum += mono[i] * mono[i];
+
+        return sum / static_cast<float>(kEnvelopeWindow);
+    };
+
+    for (int w = 0; w < windows; ++w)
+    {
+        const float level = windowLevel(w);
+        if (level > peakLevel)
+        {
+            peakLevel = level;
+            peakWindow = w;
+        }
+    }
+
+    if (peakLevel <= 0.0f)
+        return 0.0f;
+
+    const float threshold = peakLevel * std::pow(10.0f, -kDecayRangeDb / 10.0f);
+    int endWindow = peakWindow;
+    while (endWindow + 1 < windows && windowLevel(endWindow + 1) > threshold)
+        ++endWindow;
+
+    return static_cast<float>((endWindow - peakWindow + 1) * kEnvelopeWindow / sampleRate);
+}
+
+Sequencer::Role classify(const SpectralFeatures& features)
+{
+    if (features.lowEnergy + features.midEnergy + features.highEnergy <= 0.0f)
+        return Sequencer::Role::other;
+
+    if (features.lowEnergy > 0.5f && features.centroidHz < 600.0f)
+        return Sequencer::Role::kick;
+
+    if (features.highEnergy > 0.45f && features.centroidHz > 4000.0f)
+        return features.decaySeconds < 0.15f ? Sequencer::Role::closedHat : Sequencer::Role::openHat;
+
+    // Snares and claps: broadband noise with most of its energy above the low band.
+    if (features.centroidHz > 1000.0f && features.lowEnergy < 0.35f && features.decaySeconds < 0.6f)
+        return Sequencer::Role::snare;
+
+    return Sequencer::Role::percussion;
+}
+} // namespace SampleAnalysis
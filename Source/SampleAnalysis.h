@@ -0,0 +1,92 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+#include <vector>
+
+#include "Sequencer.h"
+
+namespace SampleAnalysis
+{
+// Streaming transient detector. Feed mono audio in any block size; onsets are
+// reported as sample positions from the start of the stream, where the
+// short-term energy jumps by more than kRiseDb within one hop.
+class OnsetDetector
+{
+public:
+    static constexpr int kDefaultHopSize = 256;
+
+    explicit OnsetDetector(double sampleRate, int hopSize = kDefaultHopSize);
+
+    void process(const float* mono, int numSamples);
+
+    const std::vector<juce::int64>& getOnsets() const noexcept { return onsets; }
+
+    // Energy rise in dB for each onset, in the same order.
+    const std::vector<float>& getStrengths() const noexcept { return strengths; }
+
+    // Short-term level in dBFS of the hop each onset was found in.
+    const std::vector<float>& getLevels() const noexcept { return levels; }
+
+private:
+    void finishHop();
+
+    std::vector<juce::int64> onsets;
+    std::vector<float> strengths;
+    std::vector<float> levels;
+    int hopSize = kDefaultHopSize;
+    juce::int64 hopStart = 0;
+    int hopFill = 0;
+    float hopEnergy = 0.0f;
+    float previousLogEnergy = 0.0f;
+    juce::int64 minGapSamples = 0;
+    juce::int64 lastOnset = -1;
+};
+
+// Peak and RMS accumulated over every sample passed to add().
+struct LevelStats
+{
+    void add(const float* samples, int numSamples) noexcept;
+    float getRms() const noexcept;
+
+    float peak = 0.0f;
+    double sumOfSquares = 0.0;
+    juce::int64 count = 0;
+};
+
+struct SpectralFeatures
+{
+    // Share of spectral energy below 200 Hz, 200 Hz-4 kHz and above 4 kHz.
+    float lowEnergy = 0.0f;
+    float midEnergy = 0.0f;
+    float highEnergy = 0.0f;
+    float centroidHz = 0.0f;
+    float decaySeconds = 0.0f; // envelope peak to 24 dB below it
+};
+
+// Computes SpectralFeatures from the start of a mono sample. Keeps its FFT and
+// scratch buffers between calls, so one extractor can be reused across a
+// whole library scan without reallocating.
+class FeatureExtractor
+{
+public:
+    static constexpr int kFftOrder = 11;
+    static constexpr int kFftSize = 1 << kFftOrder;
+
+    FeatureExtractor();
+
+    SpectralFeatures extract(const float* mono, int numSamples, double sampleRate);
+
+private:
+    static float measureDecay(const float* mono, int numSamples, double sampleRate);
+
+    juce::dsp::FFT fft;
+    juce::dsp::WindowingFunction<float> window;
+    std::vector<float> fftData;
+    std::vector<float> power;
+};
+
+// Maps features to the rhythmic role the pattern generator should give the pad.
+Sequencer::Role classify(const SpectralFeatures& features);
+} // namespace SampleAnalysis
@@ -0,0 +1,165 @@
+#include "SampleBrowser.h"
+
+namespace
+{
+// Samples shorter than this count as one-shots for the length filter.
+constexpr double kOneShotMaxSeconds = 2.0;
+} // namespace
+
+SampleBrowser::SampleBrowser()
+{
+    searchBox.setTextToShowWhenEmpty("Search samples", juce::Colour(0xff9aa0a6));
+    searchBox.onTextChange = [this] { refreshResults(); };
+
+    lengthBox.addItem("Any length", anyLength);
+    lengthBox.addItem("One-shots", oneShots);
+    lengthBox.addItem("Loops", loops);
+    lengthBox.setSelectedId(anyLength, juce::dontSendNotification);
+    lengthBox.onChange = [this] { refreshResults(); };
+
+    addFolderButton.onClick = [this] { chooseRoot(); };
+    rescanButton.onClick = [this] { library->rescan(); };
+
+    statusLabel.setColour(juce::Label::textColourId, juce::Colour(0xff9aa0a6));
+    statusLabel.setJustificationType(juce::Justification::centredRight);
+
+    resultsList.setRowHeight(22);
+    resultsList.setColour(juce::ListBox::backgroundColourId, juce::Colour(0xff232329));
+
+    addAndMakeVisible(searchBox);
+    addAndMakeVisible(lengthBox);
+    addAndMakeVisible(addFolderButton);
+    addAndMakeVisible(rescanButton);
+    addAndMakeVisible(statusLabel);
+    addAndMakeVisible(resultsList);
+
+    library->addChangeListener(this);
+    refreshResults();
+}
+
+SampleBrowser::~SampleBrowser()
+{
+    library->removeChangeListener(this);
+}
+
+void SampleBrowser::setOnSampleChosen(std::function<void(const juce::File&)> callback)
+{
+    onSampleChosen = std::move(callback);
+}
+
+void SampleBrowser::resized()
+{
+    auto area = getLocalBounds();
+    auto toolbar = area.removeFromTop(28);
+
+    searchBox.setBounds(toolbar.removeFromLeft(260).reduced(2));
+    lengthBox.setBounds(toolbar.removeFromLeft(120).reduced(2));
+    addFolderButton.setBounds(toolbar.removeFromLeft(100).reduced(2));
+    rescanButton.setBounds(toolbar.removeFromLeft(80).reduced(2));
+    statusLabel.setBounds(toolbar.reduced(2));
+
+    resultsList.setBounds(area.withTrimmedTop(4));
+}
+
+int SampleBrowser::getNumRows()
+{
+    return static_cast<int>(results.size());
+}
+
+void SampleBrowser::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
+{
+    if (rowNumber < 0 || rowNumber >= getNumRows())
+        return;
+
+    const auto& entry = *results[static_cast<size_t>(rowNumber)];
+
+    if (rowIsSelected)
+        g.fillAll(juce::Colour(0xff2f3c54));
+
+    auto area = juce::Rectangle<int>(0, 0, width, height).reduced(6, 0);
+    auto details = area.removeFromRight(360);
+
+    g.setFont(13.0f);
+    g.setColour(juce::Colour(0xfff1f1f1));
+    g.drawText(entry.file.getFileNameWithoutExtension(), area, juce::Justification::centredLeft, true);
+
+    const auto peakDb = juce::Decibels::gainToDecibels(entry.peak);
+    const auto text = juce::String(entry.durationSeconds, 2) + " s   "
+        + juce::String(entry.sampleRate / 1000.0, 1) + " kHz "
+        + (entry.numChannels > 1 ? "stereo" : "mono") + "   "
+        + juce::String(peakDb, 1) + " dB pk   "
+        + juce::String(entry.onsetCount) + " hits   "
+        + Sequencer::getRoleName(entry.role);
+
+    g.setColour(juce::Colour(0xff9aa0a6));
+    g.drawText(text, details, juce::Justification::centredRight, false);
+}
+
+void SampleBrowser::listBoxItemClicked(int row, const juce::MouseEvent&)
+{
+    if (row >= 0 && row < getNumRows() && onSampleChosen)
+        onSampleChosen(results[static_cast<size_t>(row)]->file);
+}
+
+void SampleBrowser::listBoxItemDoubleClicked(int row, const juce::MouseEvent& event)
+{
+    listBoxItemClicked(row, event);
+}
+
+void SampleBrowser::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    if (library->getEntries() != entries)
+        refreshResults();
+    else
+        updateStatus();
+}
+
+void SampleBrowser::refreshResults()
+{
+    SampleLibrary::Query query;
+    query.text = searchBox.getText();
+
+    switch (lengthBox.getSelectedId())
+    {
+        case oneShots: query.maxSeconds = kOneShotMaxSeconds; break;
+        case loops:    query.minSeconds = kOneShotMaxSeconds; break;
+        default:       break;
+    }
+
+    // Hold the snapshot so the result pointers stay valid until the next refresh.
+    entries = library->getEntries();
+    results = library->search(entries, query);
+
+    resultsList.updateContent();
+    resultsList.repaint();
+    updateStatus();
+}
+
+void SampleBrowser::updateStatus()
+{
+    auto text = juce::String(static_cast<int>(results.size())) + " of "
+        + juce::String(entries != nullptr ? static_cast<int>(entries->size()) : 0) + " samples";
+
+    if (library->isScanning())
+        text << " - scanning (" << library->getFilesScanned() << " files)";
+    else if (library->getRoots().isEmpty())
+        text = "Add a folder to index your samples";
+
+    statusLabel.setText(text, juce::dontSendNotification);
+}
+
+void SampleBrowser::chooseRoot()
+{
+    folderChooser = std::make_unique<juce::FileChooser>(
+        "Add a sample folder to the library",
+        juce::File::getSpecialLocation(juce::File::userMusicDirectory));
+
+    const auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories;
+
+    folderChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+    {
+        const auto directory = chooser.getResult();
+        if (directory.isDirectory())
+            library->addRoot(directory);
+    });
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "SampleLibrary.h"
+
+// Searchable view of the shared SampleLibrary index. Typing filters the
+// indexed entries in place; folders are scanned by the library's own thread,
+// so nothing here touches the file system on the message thread.
+class SampleBrowser : public juce::Component,
+                      private juce::ListBoxModel,
+                      private juce::ChangeListener
+{
+public:
+    SampleBrowser();
+    ~SampleBrowser() override;
+
+    // Called when a result is clicked or double-clicked.
+    void setOnSampleChosen(std::function<void(const juce::File&)> callback);
+
+    void resized() override;
+
+private:
+    enum LengthFilter
+    {
+        anyLength = 1,
+        oneShots,
+        loops
+    };
+
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void listBoxItemClicked(int row, const juce::MouseEvent&) override;
+    void listBoxItemDoubleClicked(int row, const juce::MouseEvent&) override;
+
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
+
+    void refreshResults();
+    void updateStatus();
+    void chooseRoot();
+
+    juce::SharedResourcePointer<SampleLibrary> library;
+
+    juce::TextEditor searchBox;
+    juce::ComboBox lengthBox;
+    juce::TextButton addFolderButton { "Add Folder" };
+    juce::TextButton rescanButton { "Rescan" };
+    juce::Label statusLabel;
+    juce::ListBox resultsList { "Samples", this };
+
+    SampleLibrary::EntriesPtr entries;
+    std::vector<const SampleLibrary::Entry*> results;
+    std::unique_ptr<juce::FileChooser> folderChooser;
+    std::function<void(const juce::File&)> onSampleChosen;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleBrowser)
+};
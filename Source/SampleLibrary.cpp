@@ -0,0 +1,355 @@
+#include "SampleLibrary.h"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+const juce::String sampleWildcard { "*.wav;*.wave;*.aif;*.aiff;*.flac" };
+
+constexpr int kIndexMagic = 0x47535149; // "GSQI"
+constexpr int kIndexVersion = 2;
+
+// Long loops are analysed from their start only; duration still comes from the header.
+constexpr double kMaxAnalysisSeconds = 30.0;
+constexpr int kAnalysisChunkFrames = 32768;
+
+// Checkpoints are where a scan shows and saves its progress, so an
+// interrupted scan keeps what it has analysed. Each one rewrites the whole
+// index, so they come after the entry count doubles, starting at the first
+// kFirstCheckpoint, or after kCheckpointSeconds of slow analysis.
+constexpr size_t kFirstCheckpoint = 2000;
+constexpr double kCheckpointSeconds = 60.0;
+} // namespace
+
+SampleLibrary::SampleLibrary()
+    : juce::Thread("GrooveSeq sample indexer")
+    , entries(std::make_shared<Entries>())
+{
+    formatManager.registerBasicFormats();
+    rescanRequested = true;
+    startThread(juce::Thread::Priority::low);
+}
+
+SampleLibrary::~SampleLibrary()
+{
+    stopThread(4000);
+}
+
+juce::File SampleLibrary::getIndexFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("GrooveSeq")
+        .getChildFile("SampleIndex.dat");
+}
+
+juce::Array<juce::File> SampleLibrary::getRoots() const
+{
+    const std::lock_guard<std::mutex> lock(mutex);
+    return roots;
+}
+
+void SampleLibrary::addRoot(const juce::File& directory)
+{
+    if (!directory.isDirectory())
+        return;
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!roots.addIfNotAlreadyThere(directory))
+            return;
+    }
+
+    rescan();
+}
+
+void SampleLibrary::removeRoot(const juce::File& directory)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        roots.removeFirstMatchingValue(directory);
+    }
+
+    rescan();
+}
+
+void SampleLibrary::rescan()
+{
+    rescanRequested = true;
+    notify();
+}
+
+SampleLibrary::EntriesPtr SampleLibrary::getEntries() const
+{
+    const std::lock_guard<std::mutex> lock(mutex);
+    return entries;
+}
+
+std::vector<const SampleLibrary::Entry*> SampleLibrary::search(const EntriesPtr& snapshot, const Query& query) const
+{
+    std::vector<const Entry*> results;
+    if (snapshot == nullptr)
+        return results;
+
+    const auto words = juce::StringArray::fromTokens(query.text.toLowerCase(), true);
+
+    for (const auto& entry : *snapshot)
+    {
+        if (entry.durationSeconds < query.minSeconds)
+            continue;
+
+        if (query.maxSeconds > 0.0 && entry.durationSeconds > query.maxSeconds)
+            continue;
+
+        const bool matches = std::all_of(words.begin(), words.end(), [&entry](const juce::String& word)
+        {
+            return entry.searchKey.contains(word);
+        });
+
+        if (matches)
+            results.push_back(&entry);
+    }
+
+    return results;
+}
+
+void SampleLibrary::run()
+{
+    loadIndex();
+    sendChangeMessage();
+
+    while (!threadShouldExit())
+    {
+        if (rescanRequested.exchange(false))
+            scan();
+        else
+            wait(-1);
+    }
+}
+
+void SampleLibrary::scan()
+{
+    scanning = true;
+    filesScanned = 0;
+    sendChangeMessage();
+
+    const auto previous = getEntries();
+    std::map<juce::String, const Entry*> known;
+    for (const auto& entry : *previous)
+        known[entry.file.getFullPathName()] = &entry;
+
+    // Previous entries this scan hasn't reached yet; checkpoints keep them.
+    auto unvisited = known;
+
+    Entries found;
+    found.reserve(previous->size());
+    size_t nextCheckpoint = kFirstCheckpoint;
+    auto lastCheckpointMs = juce::Time::getMillisecondCounterHiRes();
+
+    for (const auto& root : getRoots())
+    {
+        for (const auto& item : juce::RangedDirectoryIterator(root, true, sampleWildcard, juce::File::findFiles))
+        {
+            if (threadShouldExit())
+            {
+                scanning = false;
+                return;
+            }
+
+            Entry entry;
+            entry.file = item.getFile();
+            entry.modificationTime = item.getModificationTime().toMilliseconds();
+            entry.fileSize = item.getFileSize();
+
+            // Unchanged since the last scan: keep the indexed metadata
+            // instead of opening the file again.
+            const auto path = entry.file.getFullPathName();
+            unvisited.erase(path);
+
+            const auto existing = known.find(path);
+            if (existing != known.end()
+                && existing->second->modificationTime == entry.modificationTime
+                && existing->second->fileSize == entry.fileSize)
+            {
+                found.push_back(*existing->second);
+            }
+            else if (analyse(entry))
+            {
+                found.push_back(std::move(entry));
+            }
+
+            ++filesScanned;
+
+            const auto now = juce::Time::getMillisecondCounterHiRes();
+            if (found.size() >= nextCheckpoint
+                || (found.size() >= kFirstCheckpoint && now - lastCheckpointMs >= kCheckpointSeconds * 1000.0))
+            {
+                nextCheckpoint = found.size() * 2;
+                lastCheckpointMs = now;
+
+                auto checkpoint = found;
+                for (const auto& entry : unvisited)
+                    checkpoint.push_back(*entry.second);
+
+                publish(std::move(checkpoint));
+                saveIndex();
+                sendChangeMessage();
+            }
+        }
+    }
+
+    publish(std::move(found));
+    saveIndex();
+
+    scanning = false;
+    sendChangeMessage();
+}
+
+bool SampleLibrary::analyse(Entry& entry)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(entry.file));
+    if (reader == nullptr || reader->sampleRate <= 0.0)
+        return false;
+
+    entry.sampleRate = reader->sampleRate;
+    entry.numChannels = static_cast<int>(reader->numChannels);
+    entry.durationSeconds = static_cast<double>(reader->lengthInSamples) / reader->sampleRate;
+
+    const auto framesToRead = juce::jmin(reader->lengthInSamples,
+                                         static_cast<juce::int64>(kMaxAnalysisSeconds * reader->sampleRate));
+    const int channels = juce::jlimit(1, 2, entry.numChannels);
+
+    juce::AudioBuffer<float> chunk(channels, kAnalysisChunkFrames);
+    SampleAnalysis::LevelStats levels;
+    SampleAnalysis::OnsetDetector onsets(reader->sampleRate);
+
+    for (juce::int64 position = 0; position < framesToRead; position += kAnalysisChunkFrames)
+    {
+        if (threadShouldExit())
+            return false;
+
+        const int count = static_cast<int>(juce::jmin<juce::int64>(kAnalysisChunkFrames, framesToRead - position));
+        reader->read(&chunk, 0, count, position, true, true);
+
+        for (int ch = 0; ch < channels; ++ch)
+            levels.add(chunk.getReadPointer(ch), count);
+
+        if (channels > 1)
+        {
+            chunk.applyGain(0, count, 0.5f);
+            chunk.addFrom(0, 0, chunk, 1, 0, count);
+        }
+
+        onsets.process(chunk.getReadPointer(0), count);
+
+        // The opening chunk covers the hit and its decay, which is all the
+        // classifier looks at.
+        if (position == 0)
+            entry.role = SampleAnalysis::classify(featureExtractor.extract(chunk.getReadPointer(0), count, reader->sampleRate));
+    }
+
+    entry.peak = levels.peak;
+    entry.rms = levels.getRms();
+    entry.onsetCount = static_cast<int>(onsets.getOnsets().size());
+    entry.searchKey = makeSearchKey(entry);
+    return true;
+}
+
+juce::String SampleLibrary::makeSearchKey(const Entry& entry)
+{
+    return (entry.file.getFileName() + " " + Sequencer::getRoleName(entry.role)).toLowerCase();
+}
+
+void SampleLibrary::publish(Entries newEntries)
+{
+    std::sort(newEntries.begin(), newEntries.end(), [](const Entry& a, const Entry& b)
+    {
+        return a.searchKey < b.searchKey;
+    });
+
+    auto snapshot = std::make_shared<const Entries>(std::move(newEntries));
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    entries = std::move(snapshot);
+}
+
+void SampleLibrary::loadIndex()
+{
+    juce::FileInputStream in(getIndexFile());
+    if (!in.openedOk() || in.readInt() != kIndexMagic || in.readInt() != kIndexVersion)
+        return;
+
+    juce::Array<juce::File> loadedRoots;
+    for (int i = in.readInt(); --i >= 0 && !in.isExhausted();)
+        loadedRoots.add(juce::File(in.readString()));
+
+    Entries loaded;
+    const int numEntries = in.readInt();
+    loaded.reserve(static_cast<size_t>(juce::jmax(0, numEntries)));
+
+    for (int i = 0; i < numEntries && !in.isExhausted(); ++i)
+    {
+        Entry entry;
+        entry.file = juce::File(in.readString());
+        entry.modificationTime = in.readInt64();
+        entry.fileSize = in.readInt64();
+        entry.durationSeconds = in.readDouble();
+        entry.sampleRate = in.readDouble();
+        entry.numChannels = in.readInt();
+        entry.peak = in.readFloat();
+        entry.rms = in.readFloat();
+        entry.onsetCount = in.readInt();
+        entry.role = static_cast<Sequencer::Role>(juce::jlimit(0, static_cast<int>(Sequencer::Role::other), in.readInt()));
+        entry.searchKey = makeSearchKey(entry);
+        loaded.push_back(std::move(entry));
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& root : loadedRoots)
+            roots.addIfNotAlreadyThere(root);
+    }
+
+    publish(std::move(loaded));
+}
+
+void SampleLibrary::saveIndex() const
+{
+    const auto indexFile = getIndexFile();
+    indexFile.getParentDirectory().createDirectory();
+
+    const auto rootsToSave = getRoots();
+    const auto entriesToSave = getEntries();
+
+    // Written beside the index and swapped in, so a crash never leaves a torn file.
+    juce::TemporaryFile temp(indexFile);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return;
+
+        out.writeInt(kIndexMagic);
+        out.writeInt(kIndexVersion);
+
+        out.writeInt(rootsToSave.size());
+        for (const auto& root : rootsToSave)
+            out.writeString(root.getFullPathName());
+
+        out.writeInt(static_cast<int>(entriesToSave->size()));
+        for (const auto& entry : *entriesToSave)
+        {
+            out.writeString(entry.file.getFullPathName());
+            out.writeInt64(entry.modificationTime);
+            out.writeInt64(entry.fileSize);
+            out.writeDouble(entry.durationSeconds);
+            out.writeDouble(entry.sampleRate);
+            out.writeInt(entry.numChannels);
+            out.writeFloat(entry.peak);
+            out.writeFloat(entry.rms);
+            out.writeInt(entry.onsetCount);
+            out.writeInt(static_cast<int>(entry.role));
+        }
+    }
+
+    temp.overwriteTargetFileWithTemporary();
+}
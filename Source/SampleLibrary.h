@@ -0,0 +1,89 @@
+#pragma once
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "SampleAnalysis.h"
+#include "Sequencer.h"
+
+// Process-wide index of the user's sample folders. A background thread walks
+// the library roots, analyses new or modified files and keeps the result in
+// an on-disk index, so large (or network-mounted) libraries are searchable
+// immediately and rescans only decode what changed since the last one.
+class SampleLibrary : private juce::Thread,
+                      public juce::ChangeBroadcaster
+{
+public:
+    struct Entry
+    {
+        juce::File file;
+        juce::String searchKey; // lower-case file name and role, matched by search()
+        juce::int64 modificationTime = 0;
+        juce::int64 fileSize = 0;
+        double durationSeconds = 0.0;
+        double sampleRate = 0.0;
+        int numChannels = 0;
+        float peak = 0.0f;
+        float rms = 0.0f;
+        int onsetCount = 0;
+        Sequencer::Role role = Sequencer::Role::other;
+    };
+
+    using Entries = std::vector<Entry>;
+    using EntriesPtr = std::shared_ptr<const Entries>;
+
+    struct Query
+    {
+        juce::String text;
+        double minSeconds = 0.0;
+        double maxSeconds = 0.0; // 0 for no upper limit
+    };
+
+    SampleLibrary();
+    ~SampleLibrary() override;
+
+    juce::Array<juce::File> getRoots() const;
+    void addRoot(const juce::File& directory);
+    void removeRoot(const juce::File& directory);
+
+    // Walks every root again; unchanged files keep their indexed metadata.
+    void rescan();
+
+    bool isScanning() const noexcept { return scanning.load(); }
+    int getFilesScanned() const noexcept { return filesScanned.load(); }
+
+    // Current index. The returned list is immutable and stays valid while held.
+    EntriesPtr getEntries() const;
+
+    // Entries whose file name contains every whitespace-separated word of the
+    // query text and whose duration is in range. Runs on the caller's thread
+    // against an immutable snapshot, so it never waits for a scan.
+    std::vector<const Entry*> search(const EntriesPtr& entries, const Query& query) const;
+
+    static juce::File getIndexFile();
+
+private:
+    void run() override;
+    void scan();
+    bool analyse(Entry& entry);
+    void publish(Entries entries);
+    void loadIndex();
+    void saveIndex() const;
+
+    static juce::String makeSearchKey(const Entry& entry);
+
+    juce::AudioFormatManager formatManager;
+    SampleAnalysis::FeatureExtractor featureExtractor; // indexer thread only
+
+    mutable std::mutex mutex;
+    juce::Array<juce::File> roots;
+    EntriesPtr entries;
+
+    std::atomic<bool> scanning { false };
+    std::atomic<bool> rescanRequested { false };
+    std::atomic<int> filesScanned { 0 };
+};
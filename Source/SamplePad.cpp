@@ -2,6 +2,8 @@
 
 namespace
 {
+constexpr int kSourceSamplesPerThumbnailSample = 512;
+
 std::unique_ptr<juce::Drawable> createMagnifierIcon(juce::Colour colour)
 {
     auto drawable = std::make_unique<juce::DrawablePath>();
@@ -28,33 +30,47 @@ std::unique_ptr<juce::Drawable> createPlayIcon(juce::Colour colour)
     return drawable;
 }
 
-void configureIconButton(juce::DrawableButton& button,
-                         const std::function<std::unique_ptr<juce::Drawable>(juce::Colour)>& factory)
+void configureIconButton(juce::DrawableButton& button, const std::array<std::unique_ptr<juce::Drawable>, 3>& images)
 {
-    const auto base = juce::Colour(0xffd7d7d7);
-    button.setImages(factory(base).release(),
-                     factory(base.brighter(0.25f)).release(),
-                     factory(base.brighter(0.5f)).release(),
-                     nullptr,
-                     nullptr,
-                     nullptr,
-                     nullptr,
-                     nullptr);
+    // The button keeps its own copies of the shared drawables.
+    button.setImages(images[0].get(), images[1].get(), images[2].get());
     button.setColour(juce::DrawableButton::backgroundColourId, juce::Colour(0xff2c2c33));
     button.setColour(juce::DrawableButton::backgroundOnColourId, juce::Colour(0xff35353c));
     button.setClickingTogglesState(false);
 }
 } // namespace
 
+struct SamplePad::Icons
+{
+    Icons()
+    {
+        const auto base = juce::Colour(0xffd7d7d7);
+        const std::array<juce::Colour, 3> colours { base, base.brighter(0.25f), base.brighter(0.5f) };
+
+        for (size_t i = 0; i < colours.size(); ++i)
+        {
+            browse[i] = createMagnifierIcon(colours[i]);
+            play[i] = createPlayIcon(colours[i]);
+        }
+    }
+
+    // Normal, mouse-over and pressed.
+    std::array<std::unique_ptr<juce::Drawable>, 3> browse;
+    std::array<std::unique_ptr<juce::Drawable>, 3> play;
+};
+
 SamplePad::SamplePad(int index)
     : padIndex(index)
+    , thumbnail(kSourceSamplesPerThumbnailSample, thumbnailResources->formatManager, thumbnailResources->cache)
 {
+    thumbnail.addChangeListener(this);
+
     nameLabel.setText("Pad " + juce::String(padIndex + 1), juce::dontSendNotification);
     nameLabel.setJustificationType(juce::Justification::centred);
     nameLabel.setColour(juce::Label::textColourId, juce::Colour(0xfff1f1f1));
 
-    configureIconButton(browseButton, createMagnifierIcon);
-    configureIconButton(playButton, createPlayIcon);
+    configureIconButton(browseButton, icons->browse);
+    configureIconButton(playButton, icons->play);
 
     browseButton.setTooltip("Buscar sample (abre el explorador)");
     playButton.setTooltip("Reproducir sample cargado");
@@ -88,6 +104,55 @@ void SamplePad::setPadName(const juce::String& name)
     playButton.setAlpha(hasSample ? 1.0f : 0.4f);
 }
 
+SamplePad::~SamplePad()
+{
+    thumbnail.removeChangeListener(this);
+}
+
+void SamplePad::setSampleFile(const juce::File& file, juce::Range<double> region)
+{
+    if (region != sampleRegion)
+    {
+        sampleRegion = region;
+        repaint();
+    }
+
+    if (file == sampleFile)
+        return;
+
+    sampleFile = file;
+
+    // The thumbnail scans on the cache's thread, or loads straight from the
+    // on-disk cache when this file has been drawn before.
+    if (file.existsAsFile())
+        thumbnail.setSource(new juce::FileInputSource(file, true));
+    else
+        thumbnail.clear();
+
+    repaint();
+}
+
+void SamplePad::setRoleName(const juce::String& name)
+{
+    if (name == roleName)
+        return;
+
+    roleName = name;
+    repaint();
+}
+
+void SamplePad::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    repaint(getWaveformArea());
+}
+
+juce::Rectangle<int> SamplePad::getWaveformArea() const
+{
+    auto area = getLocalBounds().reduced(6);
+    area.removeFromTop(24 + 34);
+    return area.reduced(4, 2);
+}
+
 void SamplePad::setOnLoad(std::function<void(int)> callback)
 {
     onLoad = std::move(callback);
@@ -108,6 +173,11 @@ void SamplePad::setOnPlay(std::function<void(int)> callback)
     onPlay = std::move(callback);
 }
 
+void SamplePad::setOnMenu(std::function<void(int)> callback)
+{
+    onMenu = std::move(callback);
+}
+
 void SamplePad::setSelected(bool shouldSelect)
 {
     selected = shouldSelect;
@@ -124,6 +194,21 @@ void SamplePad::paint(juce::Graphics& g)
     g.fillRoundedRectangle(bounds, 8.0f);
     g.setColour(border);
     g.drawRoundedRectangle(bounds, 8.0f, 2.0f);
+
+    const auto waveformArea = getWaveformArea();
+    if (thumbnail.getTotalLength() > 0.0 && waveformArea.getHeight() > 4)
+    {
+        const auto region = sampleRegion.isEmpty() ? juce::Range<double>(0.0, thumbnail.getTotalLength()) : sampleRegion;
+        g.setColour(selected ? juce::Colour(0xff5aa9ff) : juce::Colour(0xff4fd1c5));
+        thumbnail.drawChannels(g, waveformArea, region.getStart(), region.getEnd(), 1.0f);
+    }
+
+    if (roleName.isNotEmpty())
+    {
+        g.setColour(juce::Colour(0xff9aa0a6));
+        g.setFont(11.0f);
+        g.drawText(roleName, waveformArea.removeFromTop(14), juce::Justification::topRight, false);
+    }
 }
 
 void SamplePad::resized()
@@ -139,10 +224,13 @@ void SamplePad::resized()
     browseButton.setBounds(right);
 }
 
-void SamplePad::mouseDown(const juce::MouseEvent&)
+void SamplePad::mouseDown(const juce::MouseEvent& event)
 {
     if (onSelect)
         onSelect(padIndex);
+
+    if (event.mods.isPopupMenu() && onMenu)
+        onMenu(padIndex);
 }
 
 bool SamplePad::isInterestedInFileDrag(const juce::StringArray& files)
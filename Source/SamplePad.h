@@ -2,17 +2,26 @@
 
 #include <juce_audio_utils/juce_audio_utils.h>
 
+#include "ThumbnailCache.h"
+
 class SamplePad : public juce::Component,
-                  public juce::FileDragAndDropTarget
+                  public juce::FileDragAndDropTarget,
+                  private juce::ChangeListener
 {
 public:
     SamplePad(int index);
+    ~SamplePad() override;
 
     void setPadName(const juce::String& name);
+    // Draws the waveform of file, or of just the region (in seconds) when it isn't empty.
+    void setSampleFile(const juce::File& file, juce::Range<double> region = {});
+    void setRoleName(const juce::String& name);
     void setOnLoad(std::function<void(int)> callback);
     void setOnFileDropped(std::function<void(int, const juce::File&)> callback);
     void setOnSelect(std::function<void(int)> callback);
     void setOnPlay(std::function<void(int)> callback);
+    // Right-click, for the pad's layer menu.
+    void setOnMenu(std::function<void(int)> callback);
     void setSelected(bool shouldSelect);
 
     void paint(juce::Graphics& g) override;
@@ -23,13 +32,27 @@ public:
     void filesDropped(const juce::StringArray& files, int x, int y) override;
 
 private:
+    // Button icons, built once and shared by every pad in the process.
+    struct Icons;
+
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+    juce::Rectangle<int> getWaveformArea() const;
+
     int padIndex = 0;
     juce::Label nameLabel;
+    juce::String roleName;
     juce::DrawableButton browseButton { "Browse", juce::DrawableButton::ImageOnButtonBackground };
     juce::DrawableButton playButton { "Play", juce::DrawableButton::ImageOnButtonBackground };
     std::function<void(int)> onLoad;
     std::function<void(int, const juce::File&)> onFileDropped;
     std::function<void(int)> onSelect;
     std::function<void(int)> onPlay;
+    std::function<void(int)> onMenu;
     bool selected = false;
+
+    juce::SharedResourcePointer<Icons> icons;
+    juce::SharedResourcePointer<ThumbnailResources> thumbnailResources;
+    juce::AudioThumbnail thumbnail;
+    juce::File sampleFile;
+    juce::Range<double> sampleRegion;
 }; 
@@ -0,0 +1,418 @@
+#include "SendEffects.h"
+
+#include <cmath>
+
+namespace
+{
+constexpr int kReverbHeadSamples = 256;
+constexpr double kMaxDelaySeconds = 2.5;
+constexpr double kMaxDelayTailSeconds = 10.0;
+constexpr double kDelaySmoothingSeconds = 0.05;
+
+constexpr double kDefaultRoomRate = 48000.0;
+constexpr double kDefaultRoomSeconds = 1.8;
+constexpr double kDefaultRoomRt60 = 1.2;
+
+// Ends quieter than this (-80 dB) are trimmed off prepared IRs.
+constexpr float kTrimThreshold = 1.0e-4f;
+// Loudest channel's energy after normalising; juce::dsp::Convolution's own
+// Normalise::yes level, so returns are as loud as before IRs were prepared here.
+constexpr float kNormalisedLevel = 0.125f;
+
+const juce::String defaultRoomKey { "<default room>" };
+} // namespace
+
+//==============================================================================
+ImpulseResponseLibrary::ImpulseResponseLibrary()
+    : juce::Thread("GrooveSeq IR loader")
+{
+    formatManager.registerBasicFormats();
+    startThread();
+}
+
+ImpulseResponseLibrary::~ImpulseResponseLibrary()
+{
+    stopThread(4000);
+}
+
+void ImpulseResponseLibrary::request(const juce::File& file, double sampleRate, Callback onLoaded)
+{
+    {
+        const std::lock_guard<std::mutex> lock(requestMutex);
+        pending.push_back({ file, sampleRate, std::move(onLoaded) });
+    }
+
+    notify();
+}
+
+void ImpulseResponseLibrary::run()
+{
+    while (!threadShouldExit())
+    {
+        std::vector<Request> work;
+        {
+            const std::lock_guard<std::mutex> lock(requestMutex);
+            work.swap(pending);
+        }
+
+        for (auto& item : work)
+        {
+            if (threadShouldExit())
+                return;
+
+            auto ir = prepare(item.file, item.sampleRate);
+            if (ir == nullptr || item.onLoaded == nullptr)
+                continue;
+
+            juce::MessageManager::callAsync([callback = std::move(item.onLoaded), ir]
+            {
+                callback(ir);
+            });
+        }
+
+        if (work.empty())
+            wait(-1);
+    }
+}
+
+juce::String ImpulseResponseLibrary::keyFor(const juce::File& file)
+{
+    return file == juce::File() ? defaultRoomKey : file.getFullPathName();
+}
+
+ImpulseResponseLibrary::Ptr ImpulseResponseLibrary::prepare(const juce::File& file, double sampleRate)
+{
+    const auto key = keyFor(file) + "@" + juce::String(sampleRate);
+
+    if (auto cached = cache[key].lock())
+        return cached;
+
+    const auto source = load(file);
+    if (source == nullptr)
+        return {};
+
+    const int channels = source->buffer.getNumChannels();
+    const double ratio = source->sampleRate / sampleRate;
+    const int length = static_cast<int>(std::ceil(source->buffer.getNumSamples() / ratio));
+
+    juce::AudioBuffer<float> resampled(channels, length);
+    if (ratio == 1.0)
+    {
+        resampled.makeCopyOf(source->buffer, true);
+    }
+    else
+    {
+        juce::AudioBuffer<float> copy(source->buffer);
+        juce::MemoryAudioSource memory(copy, false);
+        juce::ResamplingAudioSource resampler(&memory, false, channels);
+        resampler.setResamplingRatio(ratio);
+        resampler.prepareToPlay(length, sampleRate);
+        resampler.getNextAudioBlock(juce::AudioSourceChannelInfo(resampled));
+    }
+
+    // Trim silence off both ends, as Convolution::Trim::yes would.
+    int first = length;
+    int last = -1;
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        const auto* data = resampled.getReadPointer(ch);
+        for (int i = 0; i < length; ++i)
+        {
+            if (std::abs(data[i]) > kTrimThreshold)
+            {
+                first = juce::jmin(first, i);
+                last = juce::jmax(last, i);
+            }
+        }
+    }
+
+    if (last < first)
+        return {};
+
+    auto ir = std::make_shared<ImpulseResponse>();
+    ir->name = source->name;
+    ir->sampleRate = sampleRate;
+    ir->buffer.setSize(channels, last - first + 1);
+
+    float maxEnergy = 0.0f;
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        ir->buffer.copyFrom(ch, 0, resampled, ch, first, ir->buffer.getNumSamples());
+
+        const auto* data = ir->buffer.getReadPointer(ch);
+        float energy = 0.0f;
+        for (int i = 0; i < ir->buffer.getNumSamples(); ++i)
+            energy += data[i] * data[i];
+
+        maxEnergy = juce::jmax(maxEnergy, energy);
+    }
+
+    ir->buffer.applyGain(kNormalisedLevel / std::sqrt(maxEnergy));
+
+    cache[key] = ir;
+    return ir;
+}
+
+ImpulseResponseLibrary::Ptr ImpulseResponseLibrary::load(const juce::File& file)
+{
+    const auto key = keyFor(file);
+
+    if (auto cached = cache[key].lock())
+        return cached;
+
+    Ptr result;
+    if (file == juce::File())
+    {
+        result = createDefaultRoom();
+    }
+    else
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return {};
+
+        auto ir = std::make_shared<ImpulseResponse>();
+        ir->name = file.getFileNameWithoutExtension();
+        ir->sampleRate = reader->sampleRate;
+        ir->buffer.setSize(juce::jmin(2, static_cast<int>(reader->numChannels)),
+                           static_cast<int>(reader->lengthInSamples));
+        reader->read(&ir->buffer, 0, ir->buffer.getNumSamples(), 0, true, true);
+        result = std::move(ir);
+    }
+
+    cache[key] = result;
+    return result;
+}
+
+ImpulseResponseLibrary::Ptr ImpulseResponseLibrary::createDefaultRoom()
+{
+    // Decorrelated exponentially decaying noise: a neutral small hall that
+    // works without shipping an IR file.
+    auto ir = std::make_shared<ImpulseResponse>();
+    ir->name = "Default Room";
+    ir->sampleRate = kDefaultRoomRate;
+
+    const int length = static_cast<int>(kDefaultRoomSeconds * kDefaultRoomRate);
+    ir->buffer.setSize(2, length);
+
+    juce::Random noise(0x5eed);
+    const double decayPerSample = std::log(0.001) / (kDefaultRoomRt60 * kDefaultRoomRate);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        auto* data = ir->buffer.getWritePointer(ch);
+        for (int i = 0; i < length; ++i)
+            data[i] = (noise.nextFloat() * 2.0f - 1.0f) * static_cast<float>(std::exp(decayPerSample * i));
+    }
+
+    return ir;
+}
+
+//==============================================================================
+SendEffects::SendEffects()
+    : reverb(juce::dsp::Convolution::NonUniform { kReverbHeadSamples }, library->getMessageQueue())
+{
+}
+
+SendEffects::~SendEffects() = default;
+
+void SendEffects::prepare(double newSampleRate, int maxBlockSize)
+{
+    sampleRate = newSampleRate;
+    preparedRate.store(sampleRate);
+
+    const juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(maxBlockSize), 2 };
+    reverb.prepare(spec);
+
+    maxDelaySamples = static_cast<int>(kMaxDelaySeconds * sampleRate);
+    delay.setMaximumDelayInSamples(maxDelaySamples);
+    delay.prepare(spec);
+    delaySamples.reset(sampleRate, kDelaySmoothingSeconds);
+    delaySamples.setCurrentAndTargetValue(1.0f);
+
+    for (auto& bus : busInputs)
+        bus.setSize(2, maxBlockSize, false, true, false);
+
+    reset();
+}
+
+void SendEffects::reset()
+{
+    reverb.reset();
+    delay.reset();
+    delayTimeSet = false;
+    tailSamplesRemaining.fill(0);
+}
+
+void SendEffects::updateImpulseResponse(const juce::File& file, bool reverbInUse)
+{
+    reverbActivated = reverbActivated || reverbInUse;
+
+    const double rate = preparedRate.load();
+    if (!reverbActivated || (file == requestedFile && rate == requestedRate))
+        return;
+
+    requestedFile = file;
+    requestedRate = rate;
+
+    juce::WeakReference<SendEffects> weakThis(this);
+    library->request(file, rate, [weakThis](ImpulseResponseLibrary::Ptr ir)
+    {
+        auto* self = weakThis.get();
+        if (self == nullptr)
+            return;
+
+        // The engine partitions its own copy; the prepared source stays shared.
+        // It is already at the engine's rate, trimmed and normalised, unless
+        // the rate changed since the request; the engine resamples it then.
+        juce::AudioBuffer<float> copy(ir->buffer);
+        const auto stereo = copy.getNumChannels() > 1 ? juce::dsp::Convolution::Stereo::yes
+                                                      : juce::dsp::Convolution::Stereo::no;
+        self->reverb.loadImpulseResponse(std::move(copy),
+                                         ir->sampleRate,
+                                         stereo,
+                                         juce::dsp::Convolution::Trim::no,
+                                         juce::dsp::Convolution::Normalise::no);
+
+        self->reverbTailSeconds.store(ir->buffer.getNumSamples() / ir->sampleRate);
+    });
+}
+
+void SendEffects::beginBlock(int numSamples)
+{
+    jassert(numSamples <= busInputs[0].getNumSamples());
+    blockSamples = juce::jmin(numSamples, busInputs[0].getNumSamples());
+    for (auto& bus : busInputs)
+        bus.clear(0, blockSamples);
+}
+
+void SendEffects::process(juce::AudioBuffer<float>& output,
+                          int numSamples,
+                          const Settings& settings,
+                          double bpm,
+                          const std::array<bool, numBuses>& busHasInput)
+{
+    numSamples = juce::jmin(numSamples, blockSamples);
+
+    const std::array<float, numBuses> returnGains {
+        juce::Decibels::decibelsToGain(settings.reverbReturnDb, kMinReturnDb),
+        juce::Decibels::decibelsToGain(settings.delayReturnDb, kMinReturnDb)
+    };
+
+    const std::array<int, numBuses> tails {
+        static_cast<int>(reverbTailSeconds.load() * sampleRate),
+        static_cast<int>(delayTailSeconds(settings, bpm) * sampleRate)
+    };
+
+    for (size_t bus = 0; bus < busInputs.size(); ++bus)
+    {
+        const float previousGain = lastReturnGains[bus];
+        lastReturnGains[bus] = returnGains[bus];
+
+        // Nothing to convolve with until the first IR arrives.
+        if (bus == reverbBus && tails[bus] == 0)
+            continue;
+
+        if (busHasInput[bus])
+            tailSamplesRemaining[bus] = tails[bus] + numSamples;
+
+        if (tailSamplesRemaining[bus] <= 0)
+            continue;
+
+        auto& input = busInputs[bus];
+        if (bus == reverbBus)
+        {
+            juce::dsp::AudioBlock<float> block(input);
+            auto active = block.getSubBlock(0, static_cast<size_t>(numSamples));
+            reverb.process(juce::dsp::ProcessContextReplacing<float>(active));
+        }
+        else
+        {
+            processDelay(input, numSamples, settings, bpm);
+        }
+
+        addReturn(output, input, numSamples, previousGain, returnGains[bus]);
+        tailSamplesRemaining[bus] = juce::jmax(0, tailSamplesRemaining[bus] - numSamples);
+    }
+}
+
+bool SendEffects::isIdle() const noexcept
+{
+    for (const int remaining : tailSamplesRemaining)
+        if (remaining > 0)
+            return false;
+
+    return true;
+}
+
+double SendEffects::getTailSeconds(const Settings& settings, double bpm) const noexcept
+{
+    double seconds = 0.0;
+    if (settings.reverbReturnDb > kMinReturnDb)
+        seconds = reverbTailSeconds.load();
+
+    if (settings.delayReturnDb > kMinReturnDb)
+        seconds = juce::jmax(seconds, delayTailSeconds(settings, bpm));
+
+    return seconds;
+}
+
+double SendEffects::delayTailSeconds(const Settings& settings, double bpm) noexcept
+{
+    // Repeats needed for the feedback loop to fall below -80 dB.
+    const double beatSeconds = 60.0 / juce::jmax(1.0, bpm);
+    const double repeats = settings.delayFeedback > 0.0f
+        ? std::log(1.0e-4) / std::log(static_cast<double>(settings.delayFeedback))
+        : 1.0;
+    return juce::jmin(kMaxDelayTailSeconds, (repeats + 1.0) * settings.delayBeats * beatSeconds);
+}
+
+void SendEffects::processDelay(juce::AudioBuffer<float>& bus, int numSamples, const Settings& settings, double bpm)
+{
+    const double delaySeconds = settings.delayBeats * 60.0 / juce::jmax(1.0, bpm);
+    const float target = juce::jlimit(1.0f, static_cast<float>(maxDelaySamples - 1), static_cast<float>(delaySeconds * sampleRate));
+
+    // Glide only between times; the line is empty after a reset, so the
+    // first repeats start at the right time instead of sweeping up to it.
+    if (delayTimeSet)
+        delaySamples.setTargetValue(target);
+    else
+        delaySamples.setCurrentAndTargetValue(target);
+
+    delayTimeSet = true;
+
+    auto* left = bus.getWritePointer(0);
+    auto* right = bus.getWritePointer(1);
+    const float feedback = settings.delayFeedback;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float time = delaySamples.getNextValue();
+
+        const float delayedLeft = delay.popSample(0, time);
+        const float delayedRight = delay.popSample(1, time);
+        delay.pushSample(0, left[i] + delayedLeft * feedback);
+        delay.pushSample(1, right[i] + delayedRight * feedback);
+
+        left[i] = delayedLeft;
+        right[i] = delayedRight;
+    }
+}
+
+void SendEffects::addReturn(juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& bus,
+                            int numSamples, float previousGain, float gain)
+{
+    if (previousGain == 0.0f && gain == 0.0f)
+        return;
+
+    if (output.getNumChannels() > 1)
+    {
+        output.addFromWithRamp(0, 0, bus.getReadPointer(0), numSamples, previousGain, gain);
+        output.addFromWithRamp(1, 0, bus.getReadPointer(1), numSamples, previousGain, gain);
+    }
+    else
+    {
+        output.addFromWithRamp(0, 0, bus.getReadPointer(0), numSamples, previousGain * 0.5f, gain * 0.5f);
+        output.addFromWithRamp(0, 0, bus.getReadPointer(1), numSamples, previousGain * 0.5f, gain * 0.5f);
+    }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <juce_audio_utils/juce_audio_utils.h>
+#include <juce_dsp/juce_dsp.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Impulse responses shared by every GrooveSeq instance in the process. Files
+// are decoded, resampled, trimmed and normalised on a background thread and
+// handed out as shared buffers ready for the convolution engine, so instances
+// using the same IR at the same rate share that work and one copy of it.
+class ImpulseResponseLibrary : private juce::Thread
+{
+public:
+    struct ImpulseResponse
+    {
+        juce::String name;
+        juce::AudioBuffer<float> buffer;
+        double sampleRate = 44100.0;
+    };
+
+    using Ptr = std::shared_ptr<const ImpulseResponse>;
+    using Callback = std::function<void(Ptr)>;
+
+    ImpulseResponseLibrary();
+    ~ImpulseResponseLibrary() override;
+
+    // Prepares file (or the default room when file is empty) for convolution
+    // at sampleRate off the message thread, then calls onLoaded on the
+    // message thread.
+    void request(const juce::File& file, double sampleRate, Callback onLoaded);
+
+    // One background queue for all instances' convolution engines.
+    juce::dsp::ConvolutionMessageQueue& getMessageQueue() noexcept { return messageQueue; }
+
+private:
+    struct Request
+    {
+        juce::File file;
+        double sampleRate = 44100.0;
+        Callback onLoaded;
+    };
+
+    void run() override;
+    Ptr prepare(const juce::File& file, double sampleRate);
+    Ptr load(const juce::File& file);
+    static Ptr createDefaultRoom();
+    static juce::String keyFor(const juce::File& file);
+
+    juce::dsp::ConvolutionMessageQueue messageQueue;
+    juce::AudioFormatManager formatManager;
+
+    std::mutex requestMutex;
+    std::vector<Request> pending;
+
+    // Weak so an IR no instance uses any more is released. Decoded files are
+    // keyed by path, prepared ones by path and rate.
+    std::map<juce::String, std::weak_ptr<const ImpulseResponse>> cache;
+};
+
+// The two internal send buses: a convolution reverb and a tempo-synced delay.
+// Pads are mixed into the bus inputs by PadSynth; process() renders the returns
+// into the main output.
+class SendEffects
+{
+public:
+    enum Bus
+    {
+        reverbBus = 0,
+        delayBus,
+        numBuses
+    };
+
+    struct Settings
+    {
+        float reverbReturnDb = 0.0f;
+        float delayReturnDb = 0.0f;
+        float delayBeats = 0.5f;
+        float delayFeedback = 0.35f;
+    };
+
+    static constexpr float kMinReturnDb = -60.0f;
+
+    SendEffects();
+    ~SendEffects();
+
+    void prepare(double sampleRate, int maxBlockSize);
+    void reset();
+
+    // Message thread only. Loads file's impulse response (the built-in room
+    // when empty) through the shared library once reverbInUse has been true,
+    // and again whenever the file or the sample rate changes after that, so
+    // an instance that never sends to the reverb never builds it.
+    void updateImpulseResponse(const juce::File& file, bool reverbInUse);
+
+    // Clears the bus inputs for a new block of at most the prepared size.
+    void beginBlock(int numSamples);
+    juce::AudioBuffer<float>& getBusInput(Bus bus) noexcept { return busInputs[static_cast<size_t>(bus)]; }
+
+    // Runs both buses and adds their returns into output. busHasInput says
+    // which buses were fed this block, so idle buses with no tail are skipped.
+    void process(juce::AudioBuffer<float>& output,
+                 int numSamples,
+                 const Settings& settings,
+                 double bpm,
+                 const std::array<bool, numBuses>& busHasInput);
+
+    // True when neither bus has a tail left to play out.
+    bool isIdle() const noexcept;
+
+    // Longest either return keeps sounding after its input stops, at these
+    // settings. Safe to call from any thread.
+    double getTailSeconds(const Settings& settings, double bpm) const noexcept;
+
+private:
+    static double delayTailSeconds(const Settings& settings, double bpm) noexcept;
+    void processDelay(juce::AudioBuffer<float>& bus, int numSamples, const Settings& settings, double bpm);
+    static void addReturn(juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& bus,
+                          int numSamples, float previousGain, float gain);
+
+    juce::SharedResourcePointer<ImpulseResponseLibrary> library;
+    juce::dsp::Convolution reverb;
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delay;
+    juce::SmoothedValue<float> delaySamples;
+    bool delayTimeSet = false; // false until processDelay runs after a reset
+
+    std::array<juce::AudioBuffer<float>, numBuses> busInputs;
+    std::array<float, numBuses> lastReturnGains{};
+    std::array<int, numBuses> tailSamplesRemaining{};
+
+    // Message thread only.
+    bool reverbActivated = false;
+    juce::File requestedFile;
+    double requestedRate = 0.0;
+
+    std::atomic<double> reverbTailSeconds { 0.0 }; // 0 until an IR is loaded
+    std::atomic<double> preparedRate { 44100.0 };
+    double sampleRate = 44100.0;
+    int blockSamples = 0;
+    int maxDelaySamples = 0;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(SendEffects)
+};
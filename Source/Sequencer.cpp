@@ -1,5 +1,6 @@
 #include "Sequencer.h"
 
+#include <algorithm>
 #include <random>
 
 Sequencer::Sequencer()
@@ -9,14 +10,21 @@ Sequencer::Sequencer()
 
 void Sequencer::clear()
 {
-    for (auto& pad : pattern)
-        pad.fill(false);
+    for (int pad = 0; pad < kPads; ++pad)
+        clearPad(pad);
+}
+
+void Sequencer::clearPad(int pad)
+{
+    pattern.active[pad].fill(false);
+    pattern.velocity[pad].fill(kDefaultVelocity);
+    pattern.offset[pad].fill(0.0f);
 }
 
 void Sequencer::generate(float density,
                          float fills,
                          unsigned int seed,
-                         const std::array<bool, kPads>& activePads)
+                         const Roles& roles)
 {
     clear();
 
@@ -32,9 +40,30 @@ void Sequencer::generate(float density,
         return dist(rng) < p;
     };
 
-    auto padIsActive = [&](int pad)
+    // The first pad with each role plays that role's part; any further pads
+    // with the same role are treated as extra layers.
+    auto leadPadFor = [&](Role role)
     {
-        return pad >= 0 && pad < kPads && activePads[pad];
+        for (int pad = 0; pad < kPads; ++pad)
+        {
+            if (roles[static_cast<size_t>(pad)] == role)
+                return pad;
+        }
+
+        return -1;
+    };
+
+    const int kickPad = leadPadFor(Role::kick);
+    const int snarePad = leadPadFor(Role::snare);
+    const int closedHatPad = leadPadFor(Role::closedHat);
+    const int openHatPad = leadPadFor(Role::openHat);
+    const int percPad = leadPadFor(Role::percussion);
+
+    auto isLayer = [&](int pad)
+    {
+        return roles[static_cast<size_t>(pad)] != Role::none
+            && pad != kickPad && pad != snarePad && pad != closedHatPad
+            && pad != openHatPad && pad != percPad;
     };
 
     const float hatProb = 0.25f + 0.65f * density;
@@ -42,47 +71,47 @@ void Sequencer::generate(float density,
     const float openHatProb = 0.10f + 0.35f * density;
     const float extraLayerProb = 0.08f + 0.5f * density;
 
-    // Kick (pad 0) - four on the floor
-    if (padIsActive(0))
+    // Kick - four on the floor
+    if (kickPad >= 0)
     {
         for (int step : { 0, 8, 16, 24 })
-            setStepActive(0, step, true);
+            setStepActive(kickPad, step, true);
     }
 
-    // Clap/Snare (pad 1) - backbeats
-    if (padIsActive(1))
+    // Clap/Snare - backbeats
+    if (snarePad >= 0)
     {
         for (int step : { 4, 12, 20, 28 })
-            setStepActive(1, step, true);
+            setStepActive(snarePad, step, true);
     }
 
-    // Closed hat (pad 2) - offbeat 8ths
-    if (padIsActive(2))
+    // Closed hat - offbeat 8ths
+    if (closedHatPad >= 0)
     {
         for (int step = 2; step < kSteps; step += 4)
         {
             if (chance(hatProb))
-                setStepActive(2, step, true);
+                setStepActive(closedHatPad, step, true);
         }
     }
 
-    // Open hat (pad 3) - occasional lift
-    if (padIsActive(3))
+    // Open hat - occasional lift
+    if (openHatPad >= 0)
     {
         for (int step : { 6, 22 })
         {
             if (chance(openHatProb))
-                setStepActive(3, step, true);
+                setStepActive(openHatPad, step, true);
         }
     }
 
-    // Percs (pad 4) - sparse 16ths
-    if (padIsActive(4))
+    // Percs - sparse 16ths
+    if (percPad >= 0)
     {
         for (int step = 1; step < kSteps; ++step)
         {
             if (chance(percProb))
-                setStepActive(4, step, true);
+                setStepActive(percPad, step, true);
         }
     }
 
@@ -90,7 +119,7 @@ void Sequencer::generate(float density,
     int layerIndex = 0;
     for (int pad = 0; pad < kPads; ++pad)
     {
-        if (!padIsActive(pad) || pad <= 4)
+        if (!isLayer(pad))
             continue;
 
         const bool emphasiseDownbeats = (layerIndex++ % 2 == 0);
@@ -110,7 +139,7 @@ void Sequencer::generate(float density,
 
     auto applyFills = [&](int padIndex, float weight)
     {
-        if (!padIsActive(padIndex))
+        if (padIndex < 0)
             return;
 
         for (int step = 28; step < kSteps; ++step)
@@ -120,13 +149,13 @@ void Sequencer::generate(float density,
         }
     };
 
-    applyFills(2, 1.0f);
-    applyFills(4, 0.6f);
+    applyFills(closedHatPad, 1.0f);
+    applyFills(percPad, 0.6f);
 
     // Liven up any other active pads with fills toward the end of bar two
     for (int pad = 0; pad < kPads; ++pad)
     {
-        if (!padIsActive(pad) || pad <= 4)
+        if (!isLayer(pad))
             continue;
 
         for (int step = 28; step < kSteps; ++step)
@@ -137,12 +166,75 @@ void Sequencer::generate(float density,
     }
 }
 
+Sequencer::Roles Sequencer::getDefaultRoles()
+{
+    Roles roles;
+    roles.fill(Role::other);
+    roles[0] = Role::kick;
+    roles[1] = Role::snare;
+    roles[2] = Role::closedHat;
+    roles[3] = Role::openHat;
+    roles[4] = Role::percussion;
+    return roles;
+}
+
+const char* Sequencer::getRoleName(Role role)
+{
+    switch (role)
+    {
+        case Role::none:       return "";
+        case Role::kick:       return "Kick";
+        case Role::snare:      return "Snare";
+        case Role::closedHat:  return "Closed Hat";
+        case Role::openHat:    return "Open Hat";
+        case Role::percussion: return "Perc";
+        case Role::other:      return "Other";
+    }
+
+    return "";
+}
+
+int Sequencer::estimateLoopSteps(double loopSeconds, double bpm)
+{
+    const double stepsAtTempo = loopSeconds * bpm / 15.0;
+
+    int loopSteps = 4;
+    while (loopSteps < kSteps * 2 && stepsAtTempo > loopSteps * 1.41421356)
+        loopSteps *= 2;
+
+    return loopSteps;
+}
+
 bool Sequencer::isStepActive(int pad, int step) const
 {
-    return pattern[pad][step];
+    return pattern.active[pad][step];
 }
 
 void Sequencer::setStepActive(int pad, int step, bool active)
 {
-    pattern[pad][step] = active;
+    pattern.active[pad][step] = active;
+
+    // A cleared cell comes back as a plain on-grid hit.
+    if (!active)
+    {
+        pattern.velocity[pad][step] = kDefaultVelocity;
+        pattern.offset[pad][step] = 0.0f;
+    }
+}
+
+void Sequencer::setStep(int pad, int step, float velocity, float offset)
+{
+    pattern.active[pad][step] = true;
+    pattern.velocity[pad][step] = std::clamp(velocity, 0.0f, 1.0f);
+    pattern.offset[pad][step] = std::clamp(offset, -0.5f, 0.5f);
+}
+
+float Sequencer::getStepVelocity(int pad, int step) const
+{
+    return pattern.velocity[pad][step];
+}
+
+float Sequencer::getStepOffset(int pad, int step) const
+{
+    return pattern.offset[pad][step];
 }
@@ -8,18 +8,54 @@ public:
     static constexpr int kPads = 16;
     static constexpr int kSteps = 32; // 2 bars of 16th notes
 
+    // Rhythmic role of a pad in generated patterns; none leaves the pad empty.
+    enum class Role
+    {
+        none = 0,
+        kick,
+        snare,
+        closedHat,
+        openHat,
+        percussion,
+        other
+    };
+
+    using Roles = std::array<Role, kPads>;
+
+    static constexpr float kDefaultVelocity = 0.78f;
+
+    struct Pattern
+    {
+        std::array<std::array<bool, kSteps>, kPads> active{};
+        // Per-step hit level (0..1) and timing offset from the grid, in steps (-0.5..0.5).
+        std::array<std::array<float, kSteps>, kPads> velocity{};
+        std::array<std::array<float, kSteps>, kPads> offset{};
+    };
+
     Sequencer();
 
     void clear();
     void generate(float density,
                   float fills,
                   unsigned int seed,
-                  const std::array<bool, kPads>& activePads);
+                  const Roles& roles);
+
+    // Kick, snare, closed hat, open hat, perc on pads 1-5; extra layers on the rest.
+    static Roles getDefaultRoles();
+    static const char* getRoleName(Role role);
+
+    // Power-of-two number of 16ths (4-64) closest to a loop's length at bpm.
+    static int estimateLoopSteps(double loopSeconds, double bpm);
 
     bool isStepActive(int pad, int step) const;
     void setStepActive(int pad, int step, bool active);
-    const std::array<std::array<bool, kSteps>, kPads>& getPattern() const { return pattern; }
+    void setStep(int pad, int step, float velocity, float offset);
+    void clearPad(int pad);
+    float getStepVelocity(int pad, int step) const;
+    float getStepOffset(int pad, int step) const;
+    const Pattern& getPattern() const { return pattern; }
+    void setPattern(const Pattern& newPattern) { pattern = newPattern; }
 
 private:
-    std::array<std::array<bool, kSteps>, kPads> pattern{};
+    Pattern pattern;
 };
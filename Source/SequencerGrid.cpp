@@ -37,50 +37,146 @@ void SequencerGrid::paint(juce::Graphics& g)
             if (isPlayhead)
                 fill = active ? juce::Colour(0xfff7b500) : juce::Colour(0xff3a2f1a);
 
+            // Quieter hits are drawn dimmer, over the empty cell colour.
+            if (active)
+                fill = juce::Colour(0xff26262c).interpolatedWith(fill, 0.35f + 0.65f * data.getStepVelocity(row, col));
+
             g.setColour(fill);
             g.fillRect(cell.reduced(1.0f));
+
+            // Micro-timing: a tick where the hit lands relative to the cell centre.
+            const float offset = active ? data.getStepOffset(row, col) : 0.0f;
+            if (offset != 0.0f)
+            {
+                const float x = cell.getCentreX() + offset * cellW;
+                g.setColour(juce::Colour(0xff1b1b1f));
+                g.drawLine(x, cell.getY() + 2.0f, x, cell.getBottom() - 2.0f, 1.0f);
+            }
         }
     }
 
-    g.setColour(juce::Colour(0xff3f3f46));
-    g.drawRect(bounds, 1.0f);
+    g.setColour(dragHighlight ? juce::Colour(0xff4fd1c5) : juce::Colour(0xff3f3f46));
+    g.drawRect(bounds, dragHighlight ? 2.0f : 1.0f);
+
+    const float progress = data.getTranscriptionProgress();
+    if (progress >= 0.0f)
+    {
+        g.setColour(juce::Colour(0xc01b1b1f));
+        g.fillRect(bounds);
+
+        auto bar = bounds.withSizeKeepingCentre(juce::jmin(320.0f, bounds.getWidth() - 20.0f), 6.0f);
+        g.setColour(juce::Colour(0xff26262c));
+        g.fillRect(bar);
+        g.setColour(juce::Colour(0xff4fd1c5));
+        g.fillRect(bar.withWidth(bar.getWidth() * progress));
+
+        g.setColour(juce::Colour(0xfff1f1f1));
+        g.setFont(13.0f);
+        g.drawText("Transcribing loop...", bar.translated(0.0f, -24.0f).withHeight(18.0f),
+                   juce::Justification::centred, false);
+    }
 }
 
 void SequencerGrid::mouseDown(const juce::MouseEvent& event)
 {
-    const int pads = data.getPadCount();
-    const int steps = data.getStepCount();
-    if (pads <= 0 || steps <= 0)
+    // Steps toggle on release, so a press that turns into a drag-out leaves the pattern alone.
+    pressedCell = getCellAt(event.position);
+    draggingOut = false;
+}
+
+void SequencerGrid::mouseDrag(const juce::MouseEvent& event)
+{
+    if (draggingOut || getLocalBounds().contains(event.getPosition()))
         return;
 
-    auto bounds = getLocalBounds().toFloat().reduced(2.0f);
-    if (!bounds.contains(event.position))
+    const auto file = data.exportPatternForDrag();
+    if (!file.existsAsFile())
         return;
 
+    draggingOut = true;
+    juce::DragAndDropContainer::performExternalDragDropOfFiles({ file.getFullPathName() }, false, this);
+}
+
+void SequencerGrid::mouseUp(const juce::MouseEvent& event)
+{
+    if (draggingOut || pressedCell.x < 0 || getCellAt(event.position) != pressedCell)
+        return;
+
+    const bool current = data.getStepState(pressedCell.y, pressedCell.x);
+    data.setStepState(pressedCell.y, pressedCell.x, !current);
+    repaint();
+}
+
+juce::Point<int> SequencerGrid::getCellAt(juce::Point<float> position) const
+{
+    const int pads = data.getPadCount();
+    const int steps = data.getStepCount();
+    auto bounds = getLocalBounds().toFloat().reduced(2.0f);
+    if (pads <= 0 || steps <= 0 || !bounds.contains(position))
+        return { -1, -1 };
+
     const float cellW = bounds.getWidth() / static_cast<float>(steps);
     const float cellH = bounds.getHeight() / static_cast<float>(pads);
 
-    const int col = static_cast<int>((event.position.x - bounds.getX()) / cellW);
-    const int row = static_cast<int>((event.position.y - bounds.getY()) / cellH);
+    const int col = static_cast<int>((position.x - bounds.getX()) / cellW);
+    const int row = static_cast<int>((position.y - bounds.getY()) / cellH);
 
     if (row < 0 || row >= pads || col < 0 || col >= steps)
-        return;
+        return { -1, -1 };
 
-    const bool current = data.getStepState(row, col);
-    data.setStepState(row, col, !current);
-    repaint();
+    return { col, row };
 }
 
 void SequencerGrid::resized()
 {
 }
 
+bool SequencerGrid::isInterestedInFileDrag(const juce::StringArray& files)
+{
+    if (files.isEmpty())
+        return false;
+
+    juce::File file(files[0]);
+    return file.hasFileExtension("wav;wave;aiff;aif;flac;mid;midi");
+}
+
+void SequencerGrid::fileDragEnter(const juce::StringArray&, int, int)
+{
+    dragHighlight = true;
+    repaint();
+}
+
+void SequencerGrid::fileDragExit(const juce::StringArray&)
+{
+    dragHighlight = false;
+    repaint();
+}
+
+void SequencerGrid::filesDropped(const juce::StringArray& files, int, int)
+{
+    dragHighlight = false;
+    repaint();
+
+    juce::File file(files[0]);
+    if (!file.existsAsFile())
+        return;
+
+    if (file.hasFileExtension("mid;midi"))
+        data.midiFileDropped(file);
+    else
+        data.loopDropped(file);
+}
+
 void SequencerGrid::timerCallback()
 {
     const int step = data.getCurrentStep();
-    if (step != lastStep)
+    const float progress = data.getTranscriptionProgress();
+
+    // Also repaints once after a transcription finishes, to show its hits.
+    if (step != lastStep || progress != lastProgress)
     {
         lastStep = step;
+        lastProgress = progress;
         repaint();
     }
 }
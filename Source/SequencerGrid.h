@@ -2,7 +2,12 @@
 
 #include <juce_audio_utils/juce_audio_utils.h>
 
+// Step grid. Dropping a drum loop onto it asks the provider to transcribe the
+// loop into the pattern; a progress bar covers the grid until that finishes.
+// Dropping a MIDI file imports it, and dragging out of the grid exports the
+// pattern as a MIDI file.
 class SequencerGrid : public juce::Component,
+                      public juce::FileDragAndDropTarget,
                       private juce::Timer
 {
 public:
@@ -11,20 +16,39 @@ public:
         virtual ~DataProvider() = default;
         virtual bool getStepState(int pad, int step) const = 0;
         virtual void setStepState(int pad, int step, bool enabled) = 0;
+        virtual float getStepVelocity(int pad, int step) const = 0;
+        virtual float getStepOffset(int pad, int step) const = 0; // in steps, -0.5..0.5
         virtual int getCurrentStep() const = 0;
         virtual int getPadCount() const = 0;
         virtual int getStepCount() const = 0;
+        virtual void loopDropped(const juce::File& file) = 0;
+        virtual void midiFileDropped(const juce::File& file) = 0;
+        // Writes the pattern to a MIDI file for dragging out; returns it, or {} on failure.
+        virtual juce::File exportPatternForDrag() = 0;
+        virtual float getTranscriptionProgress() const = 0; // -1 when idle
     };
 
     explicit SequencerGrid(DataProvider& provider);
 
     void paint(juce::Graphics& g) override;
     void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+    void mouseUp(const juce::MouseEvent& event) override;
     void resized() override;
 
+    bool isInterestedInFileDrag(const juce::StringArray& files) override;
+    void fileDragEnter(const juce::StringArray& files, int x, int y) override;
+    void fileDragExit(const juce::StringArray& files) override;
+    void filesDropped(const juce::StringArray& files, int x, int y) override;
+
 private:
     void timerCallback() override;
+    juce::Point<int> getCellAt(juce::Point<float> position) const;
 
     DataProvider& data;
     int lastStep = -1;
+    float lastProgress = -1.0f;
+    bool dragHighlight = false;
+    juce::Point<int> pressedCell { -1, -1 }; // x = step, y = pad
+    bool draggingOut = false;
 };
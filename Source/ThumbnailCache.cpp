@@ -0,0 +1,102 @@
+#include "ThumbnailCache.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+constexpr int kMaxThumbsInMemory = 64;
+// Thumbnails unused for this long go, then the oldest until the rest fit.
+constexpr int kMaxThumbAgeDays = 90;
+constexpr juce::int64 kMaxCacheBytes = 64 * 1024 * 1024;
+} // namespace
+
+PersistentThumbnailCache::PersistentThumbnailCache(const juce::File& directory)
+    : juce::AudioThumbnailCache(kMaxThumbsInMemory)
+    , cacheDirectory(directory)
+{
+    cacheDirectory.createDirectory();
+    prune();
+}
+
+void PersistentThumbnailCache::prune() const
+{
+    struct Entry
+    {
+        juce::File file;
+        juce::Time lastUse;
+        juce::int64 bytes = 0;
+    };
+
+    const auto cutoff = juce::Time::getCurrentTime() - juce::RelativeTime::days(kMaxThumbAgeDays);
+    std::vector<Entry> entries;
+    juce::int64 total = 0;
+
+    for (const auto& item : juce::RangedDirectoryIterator(cacheDirectory, false, "*.thumb", juce::File::findFiles))
+    {
+        if (item.getModificationTime() < cutoff)
+        {
+            item.getFile().deleteFile();
+            continue;
+        }
+
+        entries.push_back({ item.getFile(), item.getModificationTime(), item.getFileSize() });
+        total += item.getFileSize();
+    }
+
+    if (total <= kMaxCacheBytes)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+    for (const auto& entry : entries)
+    {
+        if (total <= kMaxCacheBytes)
+            break;
+
+        if (entry.file.deleteFile())
+            total -= entry.bytes;
+    }
+}
+
+juce::File PersistentThumbnailCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("GrooveSeq")
+        .getChildFile("Thumbnails");
+}
+
+juce::File PersistentThumbnailCache::getThumbFile(juce::int64 hashCode) const
+{
+    return cacheDirectory.getChildFile(juce::String::toHexString(hashCode) + ".thumb");
+}
+
+void PersistentThumbnailCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    const auto file = getThumbFile(hashCode);
+    juce::FileOutputStream out(file);
+    if (!out.openedOk())
+        return;
+
+    out.setPosition(0);
+    out.truncate();
+    thumb.saveTo(out);
+}
+
+bool PersistentThumbnailCache::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    const auto file = getThumbFile(hashCode);
+    if (!file.existsAsFile())
+        return false;
+
+    // The modification time records the last use, for prune().
+    file.setLastModificationTime(juce::Time::getCurrentTime());
+
+    juce::FileInputStream in(file);
+    return in.openedOk() && thumb.loadFrom(in);
+}
+
+ThumbnailResources::ThumbnailResources()
+    : cache(PersistentThumbnailCache::getDefaultDirectory())
+{
+    formatManager.registerBasicFormats();
+}
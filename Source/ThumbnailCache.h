@@ -0,0 +1,35 @@
+#pragma once
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+// AudioThumbnailCache that also keeps finished thumbnails on disk, so loading
+// a file that was drawn before draws its waveform without re-reading it.
+class PersistentThumbnailCache : public juce::AudioThumbnailCache
+{
+public:
+    explicit PersistentThumbnailCache(const juce::File& directory);
+
+    static juce::File getDefaultDirectory();
+
+protected:
+    void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+    bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+private:
+    juce::File getThumbFile(juce::int64 hashCode) const;
+    // Drops thumbnails that haven't been used in months, then the least
+    // recently used until the directory fits its size cap.
+    void prune() const;
+
+    juce::File cacheDirectory;
+};
+
+// Format manager and thumbnail cache shared by every pad of every editor.
+// Thumbnails are built on the cache's background thread.
+struct ThumbnailResources
+{
+    ThumbnailResources();
+
+    juce::AudioFormatManager formatManager;
+    PersistentThumbnailCache cache;
+};
@@ -0,0 +1,224 @@
+// grooveseq-ctl: a command-line stand-in for a companion app, talking to
+// running GrooveSeq instances through their shared-memory control segments.
+//
+//   grooveseq-ctl list
+//   grooveseq-ctl [-i N] status
+//   grooveseq-ctl [-i N] watch
+//   grooveseq-ctl [-i N] step PAD STEP on|off
+//   grooveseq-ctl [-i N] pattern INDEX
+//   grooveseq-ctl [-i N] load PAD FILE
+//
+// Pads, steps and bank patterns are numbered from 1, as in the UI. N is the
+// instance number from "list" and defaults to 1.
+
+#include "ControlProtocol.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+using ControlProtocol::Segment;
+using ControlProtocol::State;
+
+Segment* attach(int instance)
+{
+    const int fd = shm_open(ControlProtocol::segmentName(instance).c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info {};
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(Segment))
+        mapped = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return nullptr;
+
+    auto* segment = static_cast<Segment*>(mapped);
+    if (segment->magic.load(std::memory_order_acquire) != ControlProtocol::kMagic
+        || segment->version != ControlProtocol::kVersion)
+    {
+        munmap(mapped, sizeof(Segment));
+        return nullptr;
+    }
+
+    return segment;
+}
+
+void detach(Segment* segment)
+{
+    munmap(segment, sizeof(Segment));
+}
+
+State readState(const Segment& segment)
+{
+    State state;
+    for (;;)
+    {
+        const auto before = segment.stateSequence.load(std::memory_order_acquire);
+        if (before % 2 == 0)
+        {
+            std::memcpy(&state, &segment.state, sizeof(State));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment.stateSequence.load(std::memory_order_relaxed) == before)
+                return state;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+bool push(Segment& segment, const ControlProtocol::Command& command)
+{
+    const auto write = segment.writeIndex.load(std::memory_order_relaxed);
+    if (write - segment.readIndex.load(std::memory_order_acquire) >= ControlProtocol::kRingSize)
+    {
+        std::fprintf(stderr, "command queue full; is the instance's host still running?\n");
+        return false;
+    }
+
+    segment.commands[write & (ControlProtocol::kRingSize - 1)] = command;
+    segment.writeIndex.store(write + 1, std::memory_order_release);
+    return true;
+}
+
+void printStatus(const State& state)
+{
+    std::printf("tempo %.1f bpm, step %d, bank pattern %d of %d\n",
+                state.bpm,
+                state.currentStep + 1,
+                state.selectedBankPattern + 1,
+                state.bankSize);
+
+    for (int pad = 0; pad < ControlProtocol::kPads; ++pad)
+    {
+        std::printf("%2d ", pad + 1);
+        for (int step = 0; step < ControlProtocol::kSteps; ++step)
+            std::putchar((state.active[pad] >> step) & 1u ? 'x' : (step % 4 == 0 ? '|' : '.'));
+
+        std::printf("  %s\n", state.padNames[pad]);
+    }
+}
+
+int usage()
+{
+    std::fprintf(stderr,
+                 "usage: grooveseq-ctl list\n"
+                 "       grooveseq-ctl [-i N] status | watch\n"
+                 "       grooveseq-ctl [-i N] step PAD STEP on|off\n"
+                 "       grooveseq-ctl [-i N] pattern INDEX\n"
+                 "       grooveseq-ctl [-i N] load PAD FILE\n");
+    return 2;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int arg = 1;
+    int instance = 1;
+    if (arg + 1 < argc && std::strcmp(argv[arg], "-i") == 0)
+    {
+        instance = std::atoi(argv[arg + 1]);
+        arg += 2;
+    }
+
+    if (arg >= argc)
+        return usage();
+
+    const std::string verb = argv[arg++];
+
+    if (verb == "list")
+    {
+        for (int n = 1; n <= ControlProtocol::kMaxInstances; ++n)
+        {
+            if (auto* segment = attach(n))
+            {
+                std::printf("%d  pid %d\n", n, static_cast<int>(segment->ownerPid));
+                detach(segment);
+            }
+        }
+
+        return 0;
+    }
+
+    auto* segment = attach(instance);
+    if (segment == nullptr)
+    {
+        std::fprintf(stderr, "no GrooveSeq instance %d\n", instance);
+        return 1;
+    }
+
+    ControlProtocol::Command command;
+    bool ok = true;
+
+    if (verb == "status" && arg == argc)
+    {
+        printStatus(readState(*segment));
+    }
+    else if (verb == "watch" && arg == argc)
+    {
+        int lastStep = -2;
+        for (;;)
+        {
+            const auto state = readState(*segment);
+            if (state.currentStep != lastStep)
+            {
+                std::printf("step %d\n", state.currentStep + 1);
+                std::fflush(stdout);
+                lastStep = state.currentStep;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    else if (verb == "step" && arg + 3 == argc)
+    {
+        command.type = ControlProtocol::CommandType::setStep;
+        command.pad = std::atoi(argv[arg]) - 1;
+        command.step = std::atoi(argv[arg + 1]) - 1;
+        command.value = std::strcmp(argv[arg + 2], "on") == 0 ? 1 : 0;
+        ok = push(*segment, command);
+    }
+    else if (verb == "pattern" && arg + 1 == argc)
+    {
+        command.type = ControlProtocol::CommandType::selectPattern;
+        command.value = std::atoi(argv[arg]) - 1;
+        ok = push(*segment, command);
+    }
+    else if (verb == "load" && arg + 2 == argc)
+    {
+        char* resolved = realpath(argv[arg + 1], nullptr);
+        if (resolved == nullptr || std::strlen(resolved) >= sizeof(command.path))
+        {
+            std::fprintf(stderr, "can't use %s\n", argv[arg + 1]);
+            std::free(resolved);
+            detach(segment);
+            return 1;
+        }
+
+        command.type = ControlProtocol::CommandType::loadSample;
+        command.pad = std::atoi(argv[arg]) - 1;
+        std::strcpy(command.path, resolved);
+        std::free(resolved);
+        ok = push(*segment, command);
+    }
+    else
+    {
+        detach(segment);
+        return usage();
+    }
+
+    detach(segment);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+// grooveseq-startup: times how long processors and editors take to construct,
+// the way a session template with many instances opens them: all processors
+// first, then an editor for each, with everything kept alive so shared state
+// stays warm between instances.
+//
+//   grooveseq-startup [instances]
+//
+// Defaults to 40 instances. Prints min, median and max for each.
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "PluginProcessor.h"
+
+namespace
+{
+constexpr int kDefaultInstances = 40;
+
+void printTimes(const char* label, std::vector<double> ms)
+{
+    std::sort(ms.begin(), ms.end());
+    std::printf("%-10s min %.2f ms, median %.2f ms, max %.2f ms\n", label, ms.front(), ms[ms.size() / 2], ms.back());
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int instances = argc > 1 ? juce::jlimit(1, 1000, std::atoi(argv[1])) : kDefaultInstances;
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    std::vector<std::unique_ptr<GrooveSeqAudioProcessor>> processors;
+    std::vector<double> processorMs;
+    for (int i = 0; i < instances; ++i)
+    {
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        processors.push_back(std::make_unique<GrooveSeqAudioProcessor>());
+        processorMs.push_back(juce::Time::getMillisecondCounterHiRes() - start);
+    }
+
+    std::vector<std::unique_ptr<juce::AudioProcessorEditor>> editors;
+    std::vector<double> editorMs;
+    for (auto& processor : processors)
+    {
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        editors.emplace_back(processor->createEditorIfNeeded());
+        editorMs.push_back(juce::Time::getMillisecondCounterHiRes() - start);
+    }
+
+    std::printf("%d instances\n", instances);
+    printTimes("processor", processorMs);
+    printTimes("editor", editorMs);
+
+    // Editors go first; they hold references to their processors.
+    editors.clear();
+    processors.clear();
+    return 0;
+}
@@ -0,0 +1,324 @@
+// grooveseq-stress: a headless stand-in for a host under editing load. A host
+// thread plays the processor in real time while worker threads keep loading
+// samples, toggling steps, generating patterns, dragging envelopes and
+// previewing pads, and the main thread runs the message loop the processor's
+// timer needs. Prints the worst and 99th-percentile block time at the end,
+// and the first block against the median. The pads are loaded before
+// prepareToPlay, as when a host restores a session, so that line shows
+// whether the pre-warm left anything cold for the audio thread.
+//
+//   grooveseq-stress [--compact] [--no-edits] [seconds] [block size] [sample rate]
+//   grooveseq-stress --transcribe [audio file]
+//
+// Defaults to 10 s of 256-sample blocks at 48 kHz. --compact stores the pads
+// as 16-bit PCM instead of float, and --no-edits leaves the workers out, so
+// the two storage formats' render cost can be compared on a quiet run. Build
+// with -DGROOVESEQ_TSAN=ON as well to have ThreadSanitizer watch the run.
+//
+// --transcribe instead times loop transcription of the file, or of a
+// generated minute-long loop when none is given.
+
+#include <juce_audio_utils/juce_audio_utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "LoopTranscriber.h"
+#include "PluginProcessor.h"
+
+namespace
+{
+constexpr double kDefaultSeconds = 10.0;
+constexpr int kDefaultBlockSize = 256;
+constexpr double kDefaultSampleRate = 48000.0;
+constexpr double kBpm = 120.0;
+
+// Pause between one worker's edits; loads are paced by their own decode time.
+constexpr int kEditPauseMs = 1;
+
+// The transcriber's target is a minute of audio in well under a second.
+constexpr double kTranscribeSeconds = 60.0;
+constexpr double kTranscribeTimeoutMs = 30000.0;
+
+class HostPlayHead : public juce::AudioPlayHead
+{
+public:
+    juce::Optional<PositionInfo> getPosition() const override { return info; }
+
+    PositionInfo info;
+};
+
+bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& audio, double sampleRate)
+{
+    file.deleteFile();
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        wav.createWriterFor(new juce::FileOutputStream(file), sampleRate, 2, 16, {}, 0));
+    return writer != nullptr && writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples());
+}
+
+// Noise bursts on every 8th note, decaying like hats.
+juce::AudioBuffer<float> makeLoop(double seconds, double sampleRate)
+{
+    juce::Random random(1);
+    juce::AudioBuffer<float> loop(2, static_cast<int>(seconds * sampleRate));
+    const int beatSamples = static_cast<int>(60.0 / kBpm * sampleRate / 2.0);
+    for (int i = 0; i < loop.getNumSamples(); ++i)
+    {
+        const auto decay = std::exp(-(i % beatSamples) / (0.05 * sampleRate));
+        for (int ch = 0; ch < 2; ++ch)
+            loop.setSample(ch, i, static_cast<float>((random.nextFloat() * 2.0f - 1.0f) * 0.5 * decay));
+    }
+
+    return loop;
+}
+
+// A short sine-burst hit and a two-bar noise loop, written as WAVs so the
+// workers go through the same decode path as a real drop.
+std::vector<juce::File> writeTestSamples(const juce::File& directory, double sampleRate)
+{
+    directory.createDirectory();
+    std::vector<juce::File> files;
+
+    juce::AudioBuffer<float> hit(2, static_cast<int>(0.3 * sampleRate));
+    for (int i = 0; i < hit.getNumSamples(); ++i)
+    {
+        const auto t = i / sampleRate;
+        const auto value = static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 60.0 * t) * std::exp(-t * 12.0));
+        hit.setSample(0, i, value);
+        hit.setSample(1, i, value);
+    }
+
+    if (writeWav(directory.getChildFile("hit.wav"), hit, sampleRate))
+        files.push_back(directory.getChildFile("hit.wav"));
+
+    if (writeWav(directory.getChildFile("loop.wav"), makeLoop(8 * 60.0 / kBpm, sampleRate), sampleRate))
+        files.push_back(directory.getChildFile("loop.wav"));
+
+    return files;
+}
+
+// Times one LoopTranscriber pass over file, from the request to the result
+// reaching the message thread. Returns a negative time when it fails.
+double timeTranscription(const juce::File& file, size_t& numHits)
+{
+    LoopTranscriber transcriber;
+    bool done = false;
+
+    const auto start = juce::Time::getMillisecondCounterHiRes();
+    double elapsed = -1.0;
+    transcriber.transcribe(file, kBpm, [&](const LoopTranscriber::Result& result)
+    {
+        elapsed = juce::Time::getMillisecondCounterHiRes() - start;
+        numHits = result.hits.size();
+        done = true;
+    });
+
+    while (!done && juce::Time::getMillisecondCounterHiRes() - start < kTranscribeTimeoutMs)
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(5);
+
+    return elapsed;
+}
+
+double percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0.0;
+
+    const auto index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+    return values[index];
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("grooveseq-stress");
+
+    if (args.contains("--transcribe"))
+    {
+        args.removeString("--transcribe");
+
+        auto file = args.isEmpty() ? juce::File() : juce::File::getCurrentWorkingDirectory().getChildFile(args[0]);
+        if (args.isEmpty())
+        {
+            directory.createDirectory();
+            file = directory.getChildFile("minute.wav");
+            if (!writeWav(file, makeLoop(kTranscribeSeconds, kDefaultSampleRate), kDefaultSampleRate))
+            {
+                std::fprintf(stderr, "can't write %s\n", file.getFullPathName().toRawUTF8());
+                return 1;
+            }
+        }
+
+        size_t numHits = 0;
+        const auto ms = timeTranscription(file, numHits);
+        if (args.isEmpty())
+            directory.deleteRecursively();
+
+        if (ms < 0.0)
+        {
+            std::fprintf(stderr, "transcription of %s failed\n", file.getFullPathName().toRawUTF8());
+            return 1;
+        }
+
+        std::printf("transcribed %s in %.1f ms, %zu hits\n", file.getFileName().toRawUTF8(), ms, numHits);
+        return 0;
+    }
+
+    const bool compact = args.contains("--compact");
+    const bool withEdits = !args.contains("--no-edits");
+    args.removeString("--compact");
+    args.removeString("--no-edits");
+
+    const double seconds = args.size() > 0 ? juce::jmax(1.0, args[0].getDoubleValue()) : kDefaultSeconds;
+    const int blockSize = args.size() > 1 ? juce::jlimit(16, 8192, args[1].getIntValue()) : kDefaultBlockSize;
+    const double sampleRate = args.size() > 2 ? juce::jlimit(8000.0, 384000.0, args[2].getDoubleValue()) : kDefaultSampleRate;
+
+    const auto samples = writeTestSamples(directory, sampleRate);
+    if (samples.empty())
+    {
+        std::fprintf(stderr, "can't write test samples to %s\n", directory.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    auto processor = std::make_unique<GrooveSeqAudioProcessor>();
+    HostPlayHead playHead;
+    processor->setPlayHead(&playHead);
+    processor->setPlayConfigDetails(0, 2, sampleRate, blockSize);
+
+    processor->setCompactSampleStorage(compact);
+
+    // Pads first, as a host restoring a session does, so prepareToPlay has
+    // loaded sounds to pre-warm and the first block shows whether it worked.
+    for (int pad = 0; pad < Sequencer::kPads; ++pad)
+        processor->loadSample(pad, samples[static_cast<size_t>(pad) % samples.size()]);
+
+    processor->prepareToPlay(sampleRate, blockSize);
+
+    std::atomic<bool> running { true };
+    std::atomic<bool> firstBlockDone { false };
+    const double blockSeconds = blockSize / sampleRate;
+    std::vector<double> blockLoads;
+    blockLoads.reserve(static_cast<size_t>(seconds / blockSeconds) + 16);
+
+    // The host: one block per block period, timed from the call to its return.
+    std::thread host([&]
+    {
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        juce::int64 position = 0;
+        auto deadline = std::chrono::steady_clock::now();
+
+        while (running.load())
+        {
+            playHead.info.setIsPlaying(true);
+            playHead.info.setBpm(kBpm);
+            playHead.info.setTimeSignature(juce::AudioPlayHead::TimeSignature { 4, 4 });
+            playHead.info.setTimeInSamples(position);
+            playHead.info.setPpqPosition(position / sampleRate * kBpm / 60.0);
+
+            midi.clear();
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor->processBlock(buffer, midi);
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            blockLoads.push_back(elapsed / blockSeconds);
+            position += blockSize;
+            firstBlockDone = true;
+
+            deadline += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(blockSeconds));
+            std::this_thread::sleep_until(deadline);
+        }
+    });
+
+    // The first block runs alone, so its time is prepareToPlay's doing and
+    // not the workers'.
+    while (!firstBlockDone.load())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::vector<std::thread> workers;
+    std::atomic<int> edits { 0 };
+
+    const auto startWorker = [&](int seed, std::function<void(juce::Random&)> edit)
+    {
+        workers.emplace_back([&running, &edits, seed, edit = std::move(edit)]
+        {
+            juce::Random random(seed);
+            while (running.load())
+            {
+                edit(random);
+                ++edits;
+                std::this_thread::sleep_for(std::chrono::milliseconds(kEditPauseMs));
+            }
+        });
+    };
+
+    if (withEdits)
+    {
+        startWorker(1, [&](juce::Random& random)
+        {
+            processor->loadSample(random.nextInt(Sequencer::kPads), samples[static_cast<size_t>(random.nextInt(static_cast<int>(samples.size())))]);
+        });
+
+        startWorker(2, [&](juce::Random& random)
+        {
+            processor->setStepState(random.nextInt(Sequencer::kPads), random.nextInt(Sequencer::kSteps), random.nextBool());
+        });
+
+        startWorker(3, [&](juce::Random&) { processor->generatePattern(); });
+
+        startWorker(4, [&](juce::Random& random)
+        {
+            const juce::ADSR::Parameters adsr { random.nextFloat() * 0.01f, 0.05f + random.nextFloat() * 0.3f,
+                                                random.nextFloat(), 0.05f + random.nextFloat() * 0.3f };
+            processor->setPadAdsr(random.nextInt(Sequencer::kPads), adsr);
+        });
+
+        startWorker(5, [&](juce::Random& random) { processor->triggerPadPreview(random.nextInt(Sequencer::kPads)); });
+    }
+
+    // The processor's timer, and anything it posts, run here.
+    juce::MessageManager::getInstance()->runDispatchLoopUntil(static_cast<int>(seconds * 1000.0));
+
+    running = false;
+    for (auto& worker : workers)
+        worker.join();
+    host.join();
+
+    processor->releaseResources();
+    processor.reset();
+    directory.deleteRecursively();
+
+    if (blockLoads.empty())
+        return 1;
+
+    const auto worst = *std::max_element(blockLoads.begin(), blockLoads.end());
+    const auto p99 = percentile(blockLoads, 0.99);
+    const auto overruns = std::count_if(blockLoads.begin(), blockLoads.end(), [](double load) { return load > 1.0; });
+
+    std::printf("%zu blocks of %d at %.0f Hz, %s pads, %d edits\n",
+                blockLoads.size(), blockSize, sampleRate, compact ? "int16" : "float", edits.load());
+    std::printf("worst block %.3f ms (%.1f%% of %.3f ms)\n", worst * blockSeconds * 1000.0, worst * 100.0, blockSeconds * 1000.0);
+    std::printf("p99 block   %.3f ms (%.1f%%)\n", p99 * blockSeconds * 1000.0, p99 * 100.0);
+    std::printf("overruns    %d\n", static_cast<int>(overruns));
+
+    const std::vector<double> steady(blockLoads.begin() + 1, blockLoads.end());
+    const auto median = percentile(steady, 0.5);
+    std::printf("first block %.3f ms against a median of %.3f ms (pads loaded, then prepareToPlay)\n", blockLoads.front() * blockSeconds * 1000.0, median * blockSeconds * 1000.0);
+    return 0;
+}